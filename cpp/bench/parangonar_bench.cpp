@@ -0,0 +1,546 @@
+#include <parangonar/matchers.hpp>
+#include <parangonar/note.hpp>
+#include <parangonar/dtw.hpp>
+#include <parangonar/preprocessors.hpp>
+#include <parangonar/match_parser.hpp>
+#include <parangonar/match_writer.hpp>
+#include <parangonar/midi_reader.hpp>
+#include <parangonar/synthetic.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace parangonar;
+
+// Allocation counting through the replaceable global operator new
+namespace {
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocated_bytes{0};
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return ::operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+// Peak resident set size of the process so far, in KiB (0 if unknown)
+long peak_rss_kb() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// Synthetic score: chords on a sixteenth grid, pitches from a random walk
+NoteArray make_score(size_t num_notes, unsigned int seed) {
+    synthetic::ScoreConfig config;
+    config.num_notes = num_notes;
+    config.seed = seed;
+    return synthetic::generate_score(config);
+}
+
+// Synthetic performance with the default tempo drift, jitter, 2% deletions
+// and 2% insertions
+synthetic::SyntheticPerformance make_performance(const NoteArray& score, unsigned int seed) {
+    synthetic::PerformanceConfig config;
+    config.seed = seed;
+    return synthetic::generate_performance(score, config);
+}
+
+// Random binary frames, as piano roll columns
+std::vector<std::vector<float>> make_frames(size_t num_frames, size_t num_features, unsigned int seed) {
+    std::mt19937 gen(seed);
+    std::bernoulli_distribution active(0.1);
+    std::vector<std::vector<float>> frames(num_frames, std::vector<float>(num_features, 0.0f));
+    for (auto& frame : frames) {
+        for (auto& value : frame) {
+            value = active(gen) ? 1.0f : 0.0f;
+        }
+    }
+    return frames;
+}
+
+// Standard MIDI File with the given notes. One track gives format 0 at
+// 500000 us per quarter; more give format 1 with a tempo track changing
+// tempo every bar, the notes split by pitch over the other tracks and a
+// sustain pedal (CC64) pressed for each bar on the first note track
+std::string make_midi(const NoteArray& notes, int ticks_per_quarter, int num_tracks = 1) {
+    struct Event {
+        int track;
+        int tick;
+        int order;  // Note-offs before other events at the same tick
+        std::string bytes;
+    };
+    num_tracks = std::max(num_tracks, 1);
+    const int num_note_tracks = std::max(num_tracks - 1, 1);
+    std::vector<Event> events;
+    events.reserve(notes.size() * 2);
+    int end_tick = 0;
+    for (const auto& note : notes) {
+        char pitch = static_cast<char>(std::clamp(note.pitch, 0, 127));
+        int track = num_tracks > 1 ? 1 + std::clamp(note.pitch, 0, 127) * num_note_tracks / 128 : 0;
+        events.push_back({track, note.onset_tick, 1, {'\x90', pitch, static_cast<char>(note.velocity)}});
+        events.push_back({track, note.onset_tick + note.duration_tick, 0, {'\x80', pitch, '\0'}});
+        end_tick = std::max(end_tick, note.onset_tick + note.duration_tick);
+    }
+    
+    auto tempo = [](int microseconds_per_quarter) {
+        return std::string("\xFF\x51\x03", 3) +
+               static_cast<char>((microseconds_per_quarter >> 16) & 0xFF) +
+               static_cast<char>((microseconds_per_quarter >> 8) & 0xFF) +
+               static_cast<char>(microseconds_per_quarter & 0xFF);
+    };
+    events.push_back({0, 0, 1, tempo(500000)});
+    if (num_tracks > 1) {
+        const int bar = 4 * ticks_per_quarter;
+        for (int tick = 0, index = 0; tick < end_tick; tick += bar, ++index) {
+            if (tick > 0) {
+                events.push_back({0, tick, 1, tempo(index % 2 ? 600000 : 500000)});
+            }
+            events.push_back({1, tick, 1, {'\xB0', '\x40', '\x7F'}});
+            events.push_back({1, tick + bar - ticks_per_quarter / 4, 0, {'\xB0', '\x40', '\0'}});
+        }
+    }
+    
+    auto put_u32 = [](std::string& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out += static_cast<char>((value >> shift) & 0xFF);
+        }
+    };
+    std::string file("MThd", 4);
+    put_u32(file, 6);
+    file += std::string(num_tracks > 1 ? "\x00\x01" : "\x00\x00", 2);  // Format
+    file += static_cast<char>((num_tracks >> 8) & 0xFF);
+    file += static_cast<char>(num_tracks & 0xFF);
+    file += static_cast<char>((ticks_per_quarter >> 8) & 0x7F);
+    file += static_cast<char>(ticks_per_quarter & 0xFF);
+    
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return std::tie(a.track, a.tick, a.order) < std::tie(b.track, b.tick, b.order);
+    });
+    auto next = events.begin();
+    for (int t = 0; t < num_tracks; ++t) {
+        std::string track;
+        auto put_vlq = [&track](uint32_t value) {
+            char bytes[4];
+            int count = 0;
+            do {
+                bytes[count++] = static_cast<char>(value & 0x7F);
+                value >>= 7;
+            } while (value);
+            while (count > 1) {
+                track += static_cast<char>(bytes[--count] | 0x80);
+            }
+            track += bytes[0];
+        };
+        int last_tick = 0;
+        for (; next != events.end() && next->track == t; ++next) {
+            put_vlq(static_cast<uint32_t>(next->tick - last_tick));
+            last_tick = next->tick;
+            track += next->bytes;
+        }
+        track += std::string("\x00\xFF\x2F\x00", 4);
+        file += "MTrk";
+        put_u32(file, static_cast<uint32_t>(track.size()));
+        file += track;
+    }
+    return file;
+}
+
+struct BenchResult {
+    std::string name;
+    size_t notes = 0;
+    size_t iterations = 0;
+    double ns_per_op = 0.0;
+    double min_ns_per_op = 0.0;
+    double allocs_per_op = 0.0;
+    double bytes_per_op = 0.0;
+    long peak_rss_kb = 0;
+};
+
+struct BenchOptions {
+    std::string filter;
+    size_t max_notes = 100000;
+    double min_time = 0.2;  // Seconds per benchmark
+    std::string output;
+};
+
+class BenchRunner {
+private:
+    BenchOptions options_;
+    std::vector<BenchResult> results_;
+    
+public:
+    explicit BenchRunner(BenchOptions options) : options_(std::move(options)) {}
+    
+    bool enabled(const std::string& name, size_t notes = 0) const {
+        return name.find(options_.filter) != std::string::npos && notes <= options_.max_notes;
+    }
+    
+    // Times body() after one warm-up call until min_time has passed
+    void run(const std::string& name, size_t notes, const std::function<void()>& body) {
+        using clock = std::chrono::steady_clock;
+        body();
+        
+        BenchResult result;
+        result.name = name;
+        result.notes = notes;
+        result.min_ns_per_op = std::numeric_limits<double>::infinity();
+        
+        uint64_t allocations_before = g_allocations.load();
+        uint64_t bytes_before = g_allocated_bytes.load();
+        double total_ns = 0.0;
+        while (result.iterations == 0 || total_ns < options_.min_time * 1e9) {
+            auto start = clock::now();
+            body();
+            double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            total_ns += ns;
+            result.min_ns_per_op = std::min(result.min_ns_per_op, ns);
+            result.iterations++;
+        }
+        
+        result.ns_per_op = total_ns / result.iterations;
+        result.allocs_per_op = static_cast<double>(g_allocations.load() - allocations_before) / result.iterations;
+        result.bytes_per_op = static_cast<double>(g_allocated_bytes.load() - bytes_before) / result.iterations;
+        result.peak_rss_kb = peak_rss_kb();
+        
+        std::fprintf(stderr, "%-40s %12.0f ns/op %10.1f ns/note %10.1f allocs/op\n", name.c_str(),
+                     result.ns_per_op, notes ? result.ns_per_op / notes : 0.0, result.allocs_per_op);
+        results_.push_back(std::move(result));
+    }
+    
+    void write_json(std::ostream& out) const {
+        out << "{\n  \"schema\": 1,\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const auto& r = results_[i];
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                "    {\"name\": \"%s\", \"notes\": %zu, \"iterations\": %zu, \"ns_per_op\": %.1f, "
+                "\"min_ns_per_op\": %.1f, \"ns_per_note\": %.3f, \"allocs_per_op\": %.2f, "
+                "\"bytes_per_op\": %.1f, \"peak_rss_kb\": %ld}%s\n",
+                r.name.c_str(), r.notes, r.iterations, r.ns_per_op, r.min_ns_per_op,
+                r.notes ? r.ns_per_op / r.notes : 0.0, r.allocs_per_op, r.bytes_per_op,
+                r.peak_rss_kb, i + 1 < results_.size() ? "," : "");
+            out << line;
+        }
+        out << "  ]\n}\n";
+    }
+};
+
+// Keeps results observable so the optimizer cannot drop the work
+template<typename T>
+void keep(const T& value) {
+    static volatile size_t sink;
+    sink = sink + reinterpret_cast<uintptr_t>(&value);
+}
+
+std::string suffix(size_t notes) {
+    return "/notes:" + std::to_string(notes);
+}
+
+void bench_pianoroll(BenchRunner& runner) {
+    for (size_t n : {1000, 10000}) {
+        if (!runner.enabled("pianoroll" + suffix(n), n)) continue;
+        auto score = make_score(n, 1);
+        runner.run("pianoroll" + suffix(n), n, [&] {
+            keep(note_array::compute_pianoroll(score, 16, false));
+        });
+    }
+}
+
+void bench_dtw(BenchRunner& runner) {
+    for (size_t frames : {128, 512}) {
+        std::string size = "/frames:" + std::to_string(frames);
+        auto X = make_frames(frames, 88, 2);
+        auto Y = make_frames(frames, 88, 3);
+        
+        if (runner.enabled("dtw_compute" + size)) {
+            DynamicTimeWarping dtw;
+            runner.run("dtw_compute" + size, 0, [&] { keep(dtw.compute(X, Y)); });
+        }
+        if (runner.enabled("dtw_compute_path" + size)) {
+            DynamicTimeWarping dtw;
+            std::vector<float> flat_x, flat_y;
+            for (const auto& row : X) flat_x.insert(flat_x.end(), row.begin(), row.end());
+            for (const auto& row : Y) flat_y.insert(flat_y.end(), row.begin(), row.end());
+            DynamicTimeWarping::Buffers buffers;
+            DTWPath path;
+            runner.run("dtw_compute_path" + size, 0, [&] {
+                dtw.compute_path(flat_x.data(), frames, 88, flat_y.data(), frames, 88, buffers, path);
+                keep(path);
+            });
+        }
+        if (runner.enabled("dtw_cosine" + size)) {
+            DynamicTimeWarping dtw(metrics::cosine_distance<float>);
+            runner.run("dtw_cosine" + size, 0, [&] { keep(dtw.compute(X, Y)); });
+        }
+        if (runner.enabled("dtw_weighted" + size)) {
+            WeightedDynamicTimeWarping dtw;
+            runner.run("dtw_weighted" + size, 0, [&] { keep(dtw.compute(X, Y)); });
+        }
+    }
+}
+
+void bench_preprocessing(BenchRunner& runner) {
+    for (size_t n : {1000, 10000}) {
+        auto score = make_score(n, 4);
+        auto performance = make_performance(score, 5).performance_notes;
+        auto times = preprocessors::alignment_times_from_dtw(score, performance);
+        
+        if (runner.enabled("cut_note_arrays" + suffix(n), n)) {
+            runner.run("cut_note_arrays" + suffix(n), n, [&] {
+                keep(preprocessors::cut_note_arrays(performance, score, times));
+            });
+        }
+        
+        if (runner.enabled("mend_note_alignments" + suffix(n), n)) {
+            auto [score_windows, performance_windows] = preprocessors::cut_note_arrays(performance, score, times);
+            SimplestGreedyMatcher greedy;
+            std::vector<AlignmentVector> window_alignments;
+            for (size_t w = 0; w < score_windows.size(); ++w) {
+                window_alignments.push_back(greedy(score_windows[w], performance_windows[w]));
+            }
+            runner.run("mend_note_alignments" + suffix(n), n, [&] {
+                keep(preprocessors::mend_note_alignments(window_alignments, performance, score, times));
+            });
+        }
+    }
+}
+
+void bench_find_best_combination(BenchRunner& runner) {
+    // Full enumeration (C(12, 4) = 495) and capped sampling (C(40, 10) > cap)
+    for (auto [n_long, n_short] : {std::pair<size_t, size_t>{12, 8}, std::pair<size_t, size_t>{40, 30}}) {
+        std::string name = "find_best_combination/long:" + std::to_string(n_long) +
+                           "/short:" + std::to_string(n_short);
+        if (!runner.enabled(name)) continue;
+        
+        std::mt19937 data_gen(6);
+        std::uniform_real_distribution<float> onset(0.0f, 10.0f);
+        std::vector<float> long_times(n_long), short_times(n_short);
+        for (auto& t : long_times) t = onset(data_gen);
+        for (auto& t : short_times) t = onset(data_gen);
+        std::sort(long_times.begin(), long_times.end());
+        std::sort(short_times.begin(), short_times.end());
+        
+        runner.run(name, 0, [&] {
+            std::mt19937 gen(0);
+            keep(SequenceAugmentedGreedyMatcher::find_best_combination(long_times, short_times, false, 10000, gen));
+        });
+    }
+}
+
+void bench_parsers(BenchRunner& runner) {
+    for (size_t n : {1000, 10000, 100000}) {
+        if (!runner.enabled("parse_match_string" + suffix(n), n) &&
+            !runner.enabled("parse_match_load_notes" + suffix(n), n) &&
+            !runner.enabled("parse_midi" + suffix(n), n) &&
+            !runner.enabled("parse_midi_multitrack" + suffix(n), n)) {
+            continue;
+        }
+        auto score = make_score(n, 7);
+        auto synthesized = make_performance(score, 8);
+        const NoteArray& performance = synthesized.performance_notes;
+        
+        MatchFileInfo info = synthesized.info;
+        info.time_signature = "4/4";
+        std::string match_text = MatchFileWriter().to_string(info, score, performance, synthesized.alignment);
+        std::string midi_bytes = make_midi(performance, info.midi_clock_units);
+        std::string multitrack_bytes = make_midi(performance, info.midi_clock_units, 3);
+        
+        if (runner.enabled("parse_match_string" + suffix(n), n)) {
+            runner.run("parse_match_string" + suffix(n), n, [&] {
+                keep(MatchFileParser::parse_string(match_text));
+            });
+        }
+        if (runner.enabled("parse_match_load_notes" + suffix(n), n)) {
+            runner.run("parse_match_load_notes" + suffix(n), n, [&] {
+                keep(MatchFileParser::load_notes_string(match_text));
+            });
+        }
+        if (runner.enabled("parse_midi" + suffix(n), n)) {
+            runner.run("parse_midi" + suffix(n), performance.size(), [&] {
+                keep(MidiFileReader::parse(midi_bytes));
+            });
+        }
+        if (runner.enabled("parse_midi_multitrack" + suffix(n), n)) {
+            runner.run("parse_midi_multitrack" + suffix(n), performance.size(), [&] {
+                keep(MidiFileReader::parse(multitrack_bytes));
+            });
+        }
+    }
+}
+
+void bench_synthetic(BenchRunner& runner) {
+    for (size_t n : {10000, 100000}) {
+        std::string name = "generate_performance" + suffix(n);
+        if (!runner.enabled(name, n)) continue;
+        auto score = make_score(n, 11);
+        runner.run(name, n, [&] { keep(make_performance(score, 12)); });
+    }
+}
+
+void bench_end_to_end(BenchRunner& runner) {
+    for (size_t n : {100, 1000, 10000, 100000}) {
+        std::string name = "automatic_note_matcher" + suffix(n);
+        std::string prepared_name = "automatic_note_matcher_prepared" + suffix(n);
+        if (!runner.enabled(name, n) && !runner.enabled(prepared_name, n)) continue;
+        auto score = make_score(n, 9);
+        auto performance = make_performance(score, 10).performance_notes;
+        
+        const AutomaticNoteMatcher matcher;
+        AlignmentWorkspace workspace;
+        if (runner.enabled(name, n)) {
+            runner.run(name, n, [&] { keep(matcher(score, performance, workspace)); });
+        }
+        if (runner.enabled(prepared_name, n)) {
+            const PreparedScore prepared = matcher.prepare_score(score);
+            runner.run(prepared_name, n, [&] { keep(matcher.align(prepared, performance, workspace)); });
+        }
+    }
+    
+    // One long piece among many short ones, the straggler case
+    const size_t num_pairs = 16, long_notes = 10000, short_notes = 500;
+    const size_t total_notes = long_notes + (num_pairs - 1) * short_notes;
+    std::string name = "align_batch/pairs:" + std::to_string(num_pairs);
+    if (!runner.enabled(name, total_notes)) return;
+    std::vector<NoteArray> scores;
+    std::vector<NoteArray> performances;
+    std::vector<AlignmentPair> pairs;
+    for (size_t i = 0; i < num_pairs; ++i) {
+        scores.push_back(make_score(i == 0 ? long_notes : short_notes, static_cast<unsigned int>(20 + i)));
+        performances.push_back(make_performance(scores.back(), static_cast<unsigned int>(40 + i)).performance_notes);
+    }
+    for (size_t i = 0; i < num_pairs; ++i) {
+        pairs.push_back({&scores[i], &performances[i]});
+    }
+    const AutomaticNoteMatcher matcher;
+    runner.run(name, total_notes, [&] {
+        matcher.align_batch(pairs, [](size_t, AlignmentVector&& alignment) { keep(alignment); });
+    });
+}
+
+void bench_sweep(BenchRunner& runner) {
+    // Fuzziness and cap grid over one piece, the shape of a tuning run
+    const size_t n = 1000;
+    sweep::Grid grid;
+    grid.sfuzziness = {2.0f, 4.0f, 8.0f};
+    grid.pfuzziness = {2.0f, 4.0f, 8.0f};
+    grid.cap_combinations = {100, 10000};
+    const auto configs = grid.configs();
+    std::string name = "sweep/configs:" + std::to_string(configs.size());
+    if (!runner.enabled(name, n)) return;
+    auto score = make_score(n, 30);
+    auto performance = make_performance(score, 31);
+    const std::vector<sweep::Piece> pieces = {{&score, &performance.performance_notes, &performance.alignment}};
+    runner.run(name, n, [&] { keep(sweep::run(pieces, configs)); });
+}
+
+void print_usage() {
+    std::cerr << "Usage: parangonar_bench [--filter TEXT] [--max-notes N] [--min-time SECONDS] [--output FILE]\n"
+              << "Writes JSON results to stdout, or to FILE with --output.\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--max-notes") {
+            options.max_notes = std::stoul(value);
+        } else if (arg == "--min-time") {
+            options.min_time = std::stod(value);
+        } else if (arg == "--output") {
+            options.output = value;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    
+    BenchRunner runner(options);
+    bench_pianoroll(runner);
+    bench_dtw(runner);
+    bench_preprocessing(runner);
+    bench_find_best_combination(runner);
+    bench_parsers(runner);
+    bench_synthetic(runner);
+    bench_end_to_end(runner);
+    bench_sweep(runner);
+    
+    if (options.output.empty()) {
+        runner.write_json(std::cout);
+    } else {
+        std::ofstream out(options.output);
+        if (!out.is_open()) {
+            std::cerr << "Cannot write file: " << options.output << std::endl;
+            return 1;
+        }
+        runner.write_json(out);
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <parangonar/note.hpp>
+#include <parangonar/match_parser.hpp>
+#include <parangonar/mapped_file.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace parangonar {
+
+/**
+ * Compact binary serialization of parsed match data
+ * 
+ * A file stores the match info, columnar score and performance note fields
+ * (the fields filled by MatchFileParser::to_note_arrays), the sustain pedal
+ * events, the alignment as (label, score index, performance index) triples
+ * and one interned string table for ids and signatures. Sections are
+ * 8-byte aligned so a memory-mapped file can be read in place.
+ */
+namespace binary_cache {
+
+constexpr uint32_t FORMAT_VERSION = 1;
+
+// Bump whenever the text parser's output changes, to invalidate caches
+constexpr uint32_t PARSER_VERSION = 1;
+
+/**
+ * Contents of a binary match file, materialized
+ */
+struct MatchBundle {
+    MatchFileInfo info;
+    NoteArray score_notes;
+    NoteArray performance_notes;
+    AlignmentVector alignment;
+    std::vector<std::pair<int, int>> sustain_pedal;
+};
+
+/**
+ * Identity of the source a binary file was built from
+ */
+struct SourceStamp {
+    int64_t mtime = 0;
+    uint64_t size = 0;
+};
+
+/**
+ * Write a binary match file. Alignment ids must refer to notes of the
+ * given arrays; throws std::invalid_argument otherwise.
+ */
+void write(const std::string& path, const MatchBundle& bundle, const SourceStamp& source = SourceStamp{});
+
+struct FileHeader;
+
+/**
+ * Read-only, memory-mapped view of a binary match file
+ * 
+ * Column accessors point straight into the mapping; nothing is copied
+ * until one of the materializing functions is called.
+ */
+class BinaryMatchView {
+private:
+    MappedFile file_;
+    const FileHeader* header_ = nullptr;
+    const float* score_onset_ = nullptr;
+    const float* score_duration_ = nullptr;
+    const int32_t* score_pitch_ = nullptr;
+    const uint32_t* score_id_ = nullptr;
+    const float* perf_onset_ = nullptr;
+    const float* perf_duration_ = nullptr;
+    const int32_t* perf_onset_tick_ = nullptr;
+    const int32_t* perf_duration_tick_ = nullptr;
+    const int32_t* perf_pitch_ = nullptr;
+    const int32_t* perf_velocity_ = nullptr;
+    const uint32_t* perf_id_ = nullptr;
+    const uint32_t* alignment_label_ = nullptr;
+    const int32_t* alignment_score_index_ = nullptr;
+    const int32_t* alignment_performance_index_ = nullptr;
+    const int32_t* sustain_ = nullptr;
+    const uint32_t* string_offsets_ = nullptr;
+    const char* string_data_ = nullptr;
+    
+public:
+    // Throws std::runtime_error if the file is not a valid binary match file
+    explicit BinaryMatchView(const std::string& path);
+    
+    uint32_t parser_version() const;
+    SourceStamp source() const;
+    MatchFileInfo info() const;
+    
+    size_t num_score_notes() const;
+    size_t num_performance_notes() const;
+    size_t num_alignments() const;
+    size_t num_sustain_events() const;
+    
+    // Score columns (onset/duration in beats)
+    const float* score_onset_beat() const { return score_onset_; }
+    const float* score_duration_beat() const { return score_duration_; }
+    const int32_t* score_pitch() const { return score_pitch_; }
+    const uint32_t* score_id() const { return score_id_; }
+    
+    // Performance columns (onset/duration in seconds and ticks)
+    const float* performance_onset_sec() const { return perf_onset_; }
+    const float* performance_duration_sec() const { return perf_duration_; }
+    const int32_t* performance_onset_tick() const { return perf_onset_tick_; }
+    const int32_t* performance_duration_tick() const { return perf_duration_tick_; }
+    const int32_t* performance_pitch() const { return perf_pitch_; }
+    const int32_t* performance_velocity() const { return perf_velocity_; }
+    const uint32_t* performance_id() const { return perf_id_; }
+    
+    // Interned strings
+    std::string_view string(uint32_t index) const;
+    
+    // Byte offset in the file of a pointer returned by a column accessor
+    size_t file_offset(const void* column) const {
+        return static_cast<size_t>(static_cast<const char*>(column) - file_.data());
+    }
+    
+    // Materialize
+    NoteArray score_notes() const;
+    NoteArray performance_notes() const;
+    AlignmentVector alignment() const;
+    MatchBundle bundle() const;
+};
+
+/**
+ * On-disk cache of parsed match files
+ * 
+ * Entries are keyed on the source path; the stored source mtime, size and
+ * parser version must match for a hit. Misses parse the text file and
+ * write a fresh entry.
+ */
+class MatchCache {
+private:
+    std::string directory_;
+    
+public:
+    explicit MatchCache(std::string directory);
+    
+    // Cache file used for a source path
+    std::string entry_path(const std::string& match_path) const;
+    
+    // Load from cache, or parse and store on a miss; hit is set accordingly
+    MatchBundle load(const std::string& match_path, bool* hit = nullptr) const;
+};
+
+} // namespace binary_cache
+} // namespace parangonar
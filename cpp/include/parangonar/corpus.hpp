@@ -0,0 +1,94 @@
+#pragma once
+
+#include <parangonar/note.hpp>
+#include <parangonar/match_parser.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace parangonar {
+
+/**
+ * One parsed match file of a corpus
+ */
+struct CorpusEntry {
+    std::string path;
+    NoteArray score_notes;
+    NoteArray performance_notes;
+    AlignmentVector alignment;
+    MatchFileData data;  // Only filled when CorpusOptions::keep_match_data is set
+};
+
+/**
+ * Outcome of loading a single file
+ */
+struct CorpusFileReport {
+    std::string path;
+    bool ok = false;
+    std::string error;
+    size_t bytes = 0;
+    size_t num_score_notes = 0;
+    size_t num_performance_notes = 0;
+    size_t skipped_lines = 0;        // Malformed lines left out of a loaded file
+    std::string first_skipped_line;  // "<line> - <error>" of the first one
+    double parse_sec = 0.0;
+};
+
+/**
+ * Summary of a corpus load
+ */
+struct CorpusSummary {
+    size_t files_total = 0;
+    size_t files_loaded = 0;
+    size_t files_failed = 0;
+    size_t bytes_total = 0;
+    double wall_sec = 0.0;
+    double parse_sec_total = 0.0;  // Sum over files (CPU time spent parsing)
+    std::vector<CorpusFileReport> files;  // In input order
+};
+
+/**
+ * Options for corpus loading
+ */
+struct CorpusOptions {
+    unsigned int num_threads = 0;       // 0 = hardware concurrency
+    std::string extension = ".match";   // Directory listing filter
+    bool recursive = false;             // Descend into subdirectories
+    bool keep_match_data = false;       // Also deliver the raw MatchFileData
+};
+
+/**
+ * Parallel loader for directories or lists of match files
+ * 
+ * Files are parsed on a pool of threads and handed to the callback as they
+ * complete. The callback is never invoked concurrently, and every worker
+ * holds at most one parsed file, so memory stays bounded by the thread
+ * count rather than the corpus size. Per-file errors do not stop the load;
+ * they are reported in the summary.
+ */
+class CorpusLoader {
+public:
+    using EntryCallback = std::function<void(CorpusEntry&&)>;
+    
+    /**
+     * List the matching files of a directory, sorted by path
+     */
+    static std::vector<std::string> list_files(const std::string& directory,
+                                               const CorpusOptions& options = CorpusOptions{});
+    
+    /**
+     * Load the given files
+     */
+    static CorpusSummary load(const std::vector<std::string>& files,
+                              const EntryCallback& on_entry,
+                              const CorpusOptions& options = CorpusOptions{});
+    
+    /**
+     * Load every matching file of a directory
+     */
+    static CorpusSummary load_directory(const std::string& directory,
+                                        const EntryCallback& on_entry,
+                                        const CorpusOptions& options = CorpusOptions{});
+};
+
+} // namespace parangonar
@@ -83,10 +83,10 @@ public:
     
 private:
     DistanceFunction distance_fn;
+    bool euclidean_ = false;  // distance_fn is metrics::euclidean_distance<float>
     
 public:
-    explicit DynamicTimeWarping(DistanceFunction dist_fn = metrics::euclidean_distance<float>)
-        : distance_fn(std::move(dist_fn)) {}
+    explicit DynamicTimeWarping(DistanceFunction dist_fn = metrics::euclidean_distance<float>);
     
     // Main DTW computation
     struct DTWResult {
@@ -104,6 +104,25 @@ public:
                      bool return_path = true,
                      bool return_cost_matrix = false) const;
     
+    /**
+     * Scratch storage for compute_path, reused across calls
+     */
+    struct Buffers {
+        std::vector<double> cost;  // Padded (M + 1) x (N + 1) cost matrix
+        std::vector<float> row_x, row_y;  // Row copies for custom distance functions
+    };
+    
+    /**
+     * Path only, for row-major matrices X (x_rows x x_cols) and Y (y_rows x y_cols)
+     * 
+     * Gives the same path as compute() without building nested vectors;
+     * distances are evaluated while the cost matrix is filled. The path is
+     * empty if either matrix has no rows.
+     */
+    void compute_path(const float* X, size_t x_rows, size_t x_cols,
+                      const float* Y, size_t y_rows, size_t y_cols,
+                      Buffers& buffers, DTWPath& path) const;
+    
 private:
     Matrix2D<double> compute_pairwise_distances(const std::vector<std::vector<float>>& X,
                                                const std::vector<std::vector<float>>& Y) const;
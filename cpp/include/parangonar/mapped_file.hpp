@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace parangonar {
+
+/**
+ * Read-only view of a whole file
+ * 
+ * Uses mmap on POSIX systems. Elsewhere (Windows, Emscripten) the file is
+ * read into an owned buffer, so callers always see one contiguous range.
+ */
+class MappedFile {
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<char> buffer_;  // Fallback storage when the file is not mapped
+    
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+    
+private:
+    void release();
+};
+
+} // namespace parangonar
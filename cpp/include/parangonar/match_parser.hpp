@@ -4,8 +4,7 @@
 #include <string>
 #include <unordered_map>
 #include <memory>
-#include <sstream>
-#include <regex>
+#include <string_view>
 #include <parangonar/note.hpp>
 
 namespace parangonar {
@@ -77,6 +76,22 @@ struct MatchFileData {
     MatchFileInfo info;
     std::vector<MatchLine> matches;
     std::vector<std::pair<int, int>> sustain_pedal; // time, value pairs
+    size_t skipped_lines = 0;        // Malformed lines left out
+    std::string first_skipped_line;  // "<line> - <error>" of the first one
+};
+
+/**
+ * Note arrays and ground-truth alignment loaded directly from a match file
+ */
+struct MatchNotes {
+    MatchFileInfo info;
+    NoteArray score_notes;
+    NoteArray performance_notes;
+    AlignmentVector alignment;
+    std::vector<std::pair<int, int>> sustain_pedal;
+    std::vector<std::vector<std::string>> score_attributes;  // Only filled if requested
+    size_t skipped_lines = 0;        // Malformed lines left out
+    std::string first_skipped_line;  // "<line> - <error>" of the first one
 };
 
 /**
@@ -86,9 +101,17 @@ class MatchFileParser {
 public:
     /**
      * Parse a match file and return the parsed data
+     * 
+     * The file is memory-mapped and tokenized in place; malformed note
+     * lines are skipped with a warning.
      */
     static MatchFileData parse_file(const std::string& filename);
     
+    /**
+     * Parse match file contents already held in memory
+     */
+    static MatchFileData parse_string(std::string_view contents);
+    
     /**
      * Parse a single line from a match file
      */
@@ -114,24 +137,18 @@ public:
      */
     static AlignmentVector to_alignment(const MatchFileData& data);
     
-private:
-    /**
-     * Parse fractional duration like "1/4" or "3/16"
-     */
-    static float parse_fraction(const std::string& fraction_str);
-    
     /**
-     * Parse measure:beat like "1:1" or "2:2"
+     * Load note arrays and alignment in a single pass, without building
+     * MatchFileData. Gives the same result as parse_file followed by
+     * to_note_arrays and to_alignment; score attributes are skipped unless
+     * with_attributes is set.
      */
-    static std::pair<int, int> parse_measure_beat(const std::string& measure_beat_str);
-    
-    /**
-     * Parse attribute list like "[staccato,grace]"
-     */
-    static std::vector<std::string> parse_attributes(const std::string& attr_str);
+    static MatchNotes load_notes(const std::string& filename, bool with_attributes = false);
+    static MatchNotes load_notes_string(std::string_view contents, bool with_attributes = false);
     
+private:
     /**
-     * Convert note name and accidental to MIDI pitch
+     * Convert note name and accidental to MIDI pitch (see match_scanner::midi_pitch)
      */
     static int note_to_midi_pitch(const std::string& note_name, const std::string& accidental, int octave);
 };
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <parangonar/match_parser.hpp>
+#include <parangonar/match_scanner.hpp>
+#include <parangonar/note_table.hpp>
+#include <cstddef>
+#include <exception>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace parangonar {
+
+/**
+ * Receives the lines of a match file one at a time
+ * 
+ * Views passed to the callbacks point into the reader's buffer and are
+ * only valid for the duration of the call. All callbacks default to no-ops.
+ */
+class MatchVisitor {
+public:
+    virtual ~MatchVisitor() = default;
+    
+    // info(key,value); value is raw, brackets included
+    virtual void on_info(std::string_view /*key*/, std::string_view /*value*/) {}
+    virtual void on_sustain(int /*time*/, int /*value*/) {}
+    virtual void on_match(const match_scanner::ScoreNoteView& /*score_note*/,
+                          const match_scanner::PerformanceNoteView& /*performance_note*/) {}
+    virtual void on_deletion(const match_scanner::ScoreNoteView& /*score_note*/) {}
+    virtual void on_insertion(const match_scanner::PerformanceNoteView& /*performance_note*/) {}
+    
+    // After the last line of a read_file, read_stream or read_string
+    virtual void on_end() {}
+    
+    // Return false to skip measure, beat, offset, duration and attributes
+    // of score notes (see match_scanner::scan_line)
+    virtual bool needs_score_details() const { return true; }
+    
+    // Malformed line; the default prints a warning and continues
+    virtual void on_error(std::string_view line, const std::exception& error);
+};
+
+/**
+ * Streaming match file reader
+ * 
+ * Reads through a fixed-size buffer, carrying partial lines over between
+ * reads, so peak memory depends on the buffer size and not on the file
+ * length. The buffer only grows when a single line does not fit.
+ */
+class MatchStreamReader {
+private:
+    std::vector<char> buffer_;
+    
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+    
+    explicit MatchStreamReader(size_t buffer_size = DEFAULT_BUFFER_SIZE);
+    
+    void read_file(const std::string& filename, MatchVisitor& visitor);
+    void read_stream(std::istream& in, MatchVisitor& visitor);
+    
+    // Visit the lines of contents already held in memory
+    static void read_string(std::string_view contents, MatchVisitor& visitor);
+    
+    // Visit complete lines without ending the input (no on_end call)
+    static void visit_lines(std::string_view contents, MatchVisitor& visitor);
+    
+    // Dispatch a single trimmed line
+    static void visit_line(std::string_view line, MatchVisitor& visitor);
+    
+    size_t buffer_capacity() const { return buffer_.size(); }
+};
+
+/**
+ * Apply an info(key,value) line to file metadata; unknown keys are ignored
+ */
+void apply_match_info(MatchFileInfo& info, std::string_view key, std::string_view value);
+
+/**
+ * Count a malformed line, keeping the first one as "<line> - <error>"
+ */
+void record_skipped_line(size_t& skipped_lines, std::string& first_skipped_line,
+                         std::string_view line, const std::exception& error);
+
+/**
+ * Visitor building score and performance NoteArrays plus the ground-truth
+ * alignment, with the same fields as MatchFileParser::to_note_arrays.
+ * Performance times are converted from ticks in on_end, with the clock
+ * info of the whole file, so info lines may follow the notes. Score
+ * attributes are only parsed when with_attributes is set.
+ */
+class NoteArrayBuilder : public MatchVisitor {
+public:
+    bool with_attributes = false;
+    
+    MatchFileInfo info;
+    NoteArray score_notes;
+    NoteArray performance_notes;
+    AlignmentVector alignment;
+    std::vector<std::pair<int, int>> sustain_pedal;
+    std::vector<std::vector<std::string>> score_attributes;  // Parallel to score_notes
+    size_t skipped_lines = 0;        // Malformed lines, also warned about
+    std::string first_skipped_line;
+    
+    bool needs_score_details() const override { return with_attributes; }
+    void on_info(std::string_view key, std::string_view value) override;
+    void on_sustain(int time, int value) override;
+    void on_match(const match_scanner::ScoreNoteView& score_note,
+                  const match_scanner::PerformanceNoteView& performance_note) override;
+    void on_deletion(const match_scanner::ScoreNoteView& score_note) override;
+    void on_insertion(const match_scanner::PerformanceNoteView& performance_note) override;
+    void on_end() override;
+    void on_error(std::string_view line, const std::exception& error) override;
+    
+private:
+    void add_score_note(const match_scanner::ScoreNoteView& view);
+    void add_performance_note(const match_scanner::PerformanceNoteView& view);
+};
+
+/**
+ * Visitor appending notes to columnar score and performance tables that
+ * share one id pool; performance times are filled in on_end, as in
+ * NoteArrayBuilder
+ */
+class NoteTableBuilder : public MatchVisitor {
+public:
+    MatchFileInfo info;
+    NoteTable score_notes;
+    NoteTable performance_notes;
+    
+    NoteTableBuilder();
+    
+    bool needs_score_details() const override { return false; }
+    void on_info(std::string_view key, std::string_view value) override;
+    void on_match(const match_scanner::ScoreNoteView& score_note,
+                  const match_scanner::PerformanceNoteView& performance_note) override;
+    void on_deletion(const match_scanner::ScoreNoteView& score_note) override;
+    void on_insertion(const match_scanner::PerformanceNoteView& performance_note) override;
+    void on_end() override;
+    
+private:
+    std::vector<int> onset_ticks_;     // Of performance notes, converted in on_end
+    std::vector<int> duration_ticks_;
+    
+    void add_score_note(const match_scanner::ScoreNoteView& view);
+    void add_performance_note(const match_scanner::PerformanceNoteView& view);
+};
+
+} // namespace parangonar
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string_view>
+
+namespace parangonar {
+
+/**
+ * Allocation-free tokenizer for .match file lines
+ * 
+ * All string fields are views into the scanned line, so they are only
+ * valid as long as the underlying buffer is. Numbers are parsed in place.
+ * Malformed note lines throw std::runtime_error.
+ */
+namespace match_scanner {
+
+/**
+ * Score note fields, e.g. "snote(n9,[C,n],3,1:1,0,1/4,0.0,1.0,[])"
+ */
+struct ScoreNoteView {
+    std::string_view id;
+    std::string_view note_name;
+    std::string_view accidental;
+    int octave = 0;
+    int measure = 0;
+    int beat = 0;
+    float offset = 0.0f;
+    float duration = 0.0f;
+    float onset_time = 0.0f;
+    float offset_time = 0.0f;
+    std::string_view attributes;  // Comma separated list without brackets
+};
+
+/**
+ * Performance note fields, e.g. "note(n0,[C,n],3,683,747,747,70)"
+ */
+struct PerformanceNoteView {
+    std::string_view id;
+    std::string_view note_name;
+    std::string_view accidental;
+    int octave = 0;
+    int onset_tick = 0;
+    int offset_tick = 0;
+    int sound_off_tick = 0;
+    int velocity = 0;
+};
+
+/**
+ * One classified line of a match file
+ */
+struct LineView {
+    enum Kind {
+        OTHER,      // empty, meta or unknown lines
+        INFO,       // info(key,value)
+        SUSTAIN,    // sustain(time,value)
+        MATCH,      // snote-note pair
+        DELETION,   // snote only
+        INSERTION   // insertion-note
+    };
+    
+    Kind kind = OTHER;
+    ScoreNoteView score_note;
+    PerformanceNoteView performance_note;
+    std::string_view info_key;
+    std::string_view info_value;  // Raw value, brackets included
+    int sustain_time = 0;
+    int sustain_value = 0;
+};
+
+/**
+ * Strip line terminators and the trailing period
+ */
+std::string_view trim_line(std::string_view line);
+
+/**
+ * Classify and tokenize a trimmed line. Note fields are only parsed for
+ * MATCH, DELETION and INSERTION lines. Without score_details, score notes
+ * only get id, spelling, octave and onset/offset times; measure, beat,
+ * offset, duration and attributes are neither parsed nor validated.
+ */
+LineView scan_line(std::string_view line, bool score_details = true);
+
+/**
+ * Parse the argument list of snote(...) / note(...), without the wrapper
+ */
+ScoreNoteView parse_score_note_args(std::string_view args, bool details = true);
+PerformanceNoteView parse_performance_note_args(std::string_view args);
+
+/**
+ * Number parsing on views (leading/trailing spaces allowed)
+ */
+int parse_int(std::string_view text);
+float parse_float(std::string_view text);
+float parse_fraction(std::string_view text);  // "1/4" or plain number
+
+/**
+ * MIDI pitch of a spelled note, e.g. ("C", "#", 4) -> 61, via a constexpr
+ * lookup table. Throws std::runtime_error for unknown note names.
+ */
+int midi_pitch(std::string_view note_name, std::string_view accidental, int octave);
+
+/**
+ * Invoke fn(line) for every trimmed line of a buffer
+ */
+template<typename Fn>
+void for_each_line(std::string_view text, Fn&& fn) {
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        fn(trim_line(line));
+        if (end == std::string_view::npos) break;
+        text.remove_prefix(end + 1);
+    }
+}
+
+} // namespace match_scanner
+} // namespace parangonar
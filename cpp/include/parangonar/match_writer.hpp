@@ -0,0 +1,93 @@
+#pragma once
+
+#include <parangonar/match_parser.hpp>
+#include <parangonar/note.hpp>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace parangonar {
+
+/**
+ * Writes alignments as .match files
+ * 
+ * Emits info lines, then one snote(...)-note(...), snote(...)-deletion or
+ * insertion-note(...) line per alignment entry, then sustain lines. Notes
+ * are spelled with sharps; score measure:beat positions are derived from
+ * onset_beat and the time signature numerator (4 if unknown). Performance
+ * notes are written from their tick fields.
+ * 
+ * Numbers are formatted with std::to_chars into a reusable buffer that is
+ * flushed to the output every flush_size bytes, so a writer can be kept
+ * around and reused for a whole corpus. Alignment ids missing from the
+ * note arrays throw std::invalid_argument.
+ */
+class MatchFileWriter {
+public:
+    using Sink = std::function<void(std::string_view)>;
+    
+    static constexpr size_t DEFAULT_FLUSH_SIZE = 64 * 1024;
+    
+    explicit MatchFileWriter(size_t flush_size = DEFAULT_FLUSH_SIZE);
+    
+    void write(std::ostream& out,
+               const MatchFileInfo& info,
+               const NoteArray& score_notes,
+               const NoteArray& performance_notes,
+               const AlignmentVector& alignment,
+               const std::vector<std::pair<int, int>>& sustain_pedal = {});
+    
+    // Write to a POSIX file descriptor (not closed afterwards)
+    void write_fd(int fd,
+                  const MatchFileInfo& info,
+                  const NoteArray& score_notes,
+                  const NoteArray& performance_notes,
+                  const AlignmentVector& alignment,
+                  const std::vector<std::pair<int, int>>& sustain_pedal = {});
+    
+    void write_file(const std::string& filename,
+                    const MatchFileInfo& info,
+                    const NoteArray& score_notes,
+                    const NoteArray& performance_notes,
+                    const AlignmentVector& alignment,
+                    const std::vector<std::pair<int, int>>& sustain_pedal = {});
+    
+    // Write loaded match notes back out, including score attributes if present
+    void write_file(const std::string& filename, const MatchNotes& notes);
+    
+    std::string to_string(const MatchFileInfo& info,
+                          const NoteArray& score_notes,
+                          const NoteArray& performance_notes,
+                          const AlignmentVector& alignment,
+                          const std::vector<std::pair<int, int>>& sustain_pedal = {});
+    
+    // Generic form; sink receives consecutive chunks of the file
+    void write(const Sink& sink,
+               const MatchFileInfo& info,
+               const NoteArray& score_notes,
+               const NoteArray& performance_notes,
+               const AlignmentVector& alignment,
+               const std::vector<std::pair<int, int>>& sustain_pedal = {},
+               const std::vector<std::vector<std::string>>* score_attributes = nullptr);
+    
+private:
+    std::string buffer_;
+    size_t flush_size_;
+    int beats_per_measure_ = 4;
+    int beat_unit_ = 4;  // Time signature denominator
+    
+    void flush(const Sink& sink);
+    void append(std::string_view text) { buffer_.append(text.data(), text.size()); }
+    void append_int(long long value);
+    void append_float(float value);
+    void append_fraction(float value);
+    void append_spelling(int pitch);
+    void append_score_note(const Note& note, const std::vector<std::string>* attributes);
+    void append_performance_note(const Note& note);
+};
+
+} // namespace parangonar
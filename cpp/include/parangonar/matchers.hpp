@@ -3,16 +3,28 @@
 #include <parangonar/note.hpp>
 #include <parangonar/dtw.hpp>
 #include <parangonar/preprocessors.hpp>
+#include <parangonar/window_cache.hpp>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <random>
+#include <string>
+#include <vector>
 
 namespace parangonar {
 
 /**
  * Simple greedy matcher for comparison
+ * 
+ * Each score note takes the first unaligned performance note of the same
+ * pitch (in array order). Candidates are served from per-pitch FIFO queues,
+ * so matching runs in linear time.
  */
 class SimplestGreedyMatcher {
 public:
-    AlignmentVector operator()(const NoteArray& score_notes, const NoteArray& performance_notes);
+    AlignmentVector operator()(const NoteArray& score_notes, const NoteArray& performance_notes) const;
+    AlignmentVector operator()(const NoteTable& score_notes, const NoteTable& performance_notes) const;
 };
 
 /**
@@ -28,20 +40,35 @@ public:
         const NoteArray& performance_notes,
         const TimeAlignmentVector& alignment_times,
         bool shift = false,
-        int cap_combinations = 10000
-    );
+        int cap_combinations = 10000,
+        unsigned int random_seed = 0
+    ) const;
+    
+    AlignmentVector operator()(
+        const NoteTable& score_notes,
+        const NoteTable& performance_notes,
+        const TimeAlignmentVector& alignment_times,
+        bool shift = false,
+        int cap_combinations = 10000,
+        unsigned int random_seed = 0
+    ) const;
     
-private:
     struct CombinationResult {
         double score;
         std::vector<size_t> omit_indices;
     };
     
-    CombinationResult find_best_combination(
+    /**
+     * Choose which entries of long_times to omit so that the remainder best
+     * fits short_times (least squares). Enumerates all combinations, or
+     * samples cap_combinations of them when there are more.
+     */
+    static CombinationResult find_best_combination(
         const std::vector<float>& long_times,
         const std::vector<float>& short_times,
         bool shift,
-        int cap_combinations
+        int cap_combinations,
+        std::mt19937& gen
     );
 };
 
@@ -59,28 +86,138 @@ struct AutomaticNoteMatcherConfig {
     bool pfuzziness_relative_to_tempo = true;
     bool shift_onsets = false;
     int cap_combinations = 10000;
+    unsigned int random_seed = 0;  // Seed for combination sampling
+};
+
+/**
+ * Measurements of one AutomaticNoteMatcher call
+ * 
+ * Filled by the operator() overloads taking an AlignmentStats. Stages follow
+ * the pipeline: coarse DTW over the whole piece, cutting into windows,
+ * per-window fine DTW and symbolic matching, and mending. Matrix bytes count
+ * the two piano rolls plus the DTW cost matrix of a single pass.
+ */
+struct AlignmentStats {
+    enum Stage {
+        COARSE_DTW,
+        CUTTING,
+        WINDOW_MATCHING,
+        MENDING,
+        NUM_STAGES
+    };
+    
+    struct StageStats {
+        int64_t wall_ns = 0;
+        uint64_t dtw_cells = 0;        // Cost matrix cells computed
+        size_t peak_matrix_bytes = 0;  // Largest single DTW pass
+    };
+    
+    std::array<StageStats, NUM_STAGES> stages;
+    
+    size_t num_windows = 0;
+    std::vector<size_t> window_score_notes;        // Notes per window
+    std::vector<size_t> window_performance_notes;
+    
+    uint64_t combinations_evaluated = 0;   // Omission candidates scored
+    size_t greedy_fallback_windows = 0;    // Windows matched greedily for lack of alignment times
+    size_t fallback_greedy_matches = 0;    // Matches added by the greedy fallback when mending
+    
+    int64_t total_ns() const;
+    static const char* stage_name(Stage stage);
+    
+    // Reset for a new call, keeping vector capacity
+    void clear();
+};
+
+/**
+ * Scratch storage for AutomaticNoteMatcher, reused across calls
+ * 
+ * Holds the note columns, flat piano rolls, DTW cost matrix, window row
+ * indices, per-window matching buffers and mending tables of an alignment.
+ * Buffers keep their capacity between calls, so once a workspace has seen
+ * inputs of a given size, aligning similar inputs again allocates little
+ * more than the returned AlignmentVector. A workspace must not be shared
+ * by concurrent calls.
+ * 
+ * The matcher overloads without a workspace use one per thread. It is
+ * released after any call that leaves it holding more than
+ * THREAD_LOCAL_MAX_BYTES, so a thread does not keep the buffers of its
+ * largest input; release_thread_local() frees it on demand.
+ */
+class AlignmentWorkspace {
+public:
+    AlignmentWorkspace();
+    ~AlignmentWorkspace();
+    AlignmentWorkspace(AlignmentWorkspace&&) noexcept;
+    AlignmentWorkspace& operator=(AlignmentWorkspace&&) noexcept;
+    
+    // Bytes currently reserved by the buffers
+    size_t capacity_bytes() const;
+    
+    // Free all buffers
+    void release();
+    
+    // Bound on what a thread-local workspace keeps between calls
+    static constexpr size_t THREAD_LOCAL_MAX_BYTES = size_t(32) << 20;
+    
+    // Free the calling thread's thread-local workspace
+    static void release_thread_local();
+    
+private:
+    friend class AutomaticNoteMatcher;
+    struct Buffers;
+    std::unique_ptr<Buffers> buffers_;
+};
+
+/**
+ * Score-side data of AutomaticNoteMatcher, computed once per score
+ * 
+ * Holds the score notes, their columns, the piano roll of the whole score
+ * at each given time division (the coarse DTW input) and the id tables used
+ * when mending, so aligning many performances of one score repeats only the
+ * performance-dependent work. Immutable once built: copies share the data,
+ * and any number of threads may align against one PreparedScore. A matcher
+ * whose s_time_div has no prepared roll builds it per call instead, with the
+ * same result. Window rolls depend on the coarse alignment and are still
+ * built per performance.
+ */
+class PreparedScore {
+public:
+    explicit PreparedScore(NoteArray score_notes, const std::vector<int>& time_divs = {16});
+    
+    const NoteArray& notes() const;
+    
+    // Bytes held by the prepared data
+    size_t capacity_bytes() const;
+    
+private:
+    friend class AutomaticNoteMatcher;
+    friend class IncrementalAlignment;
+    struct Data;
+    std::shared_ptr<const Data> data_;
+};
+
+/**
+ * One (score, performance) pair of a batch; the notes are not owned
+ */
+struct AlignmentPair {
+    const NoteArray* score_notes = nullptr;
+    const NoteArray* performance_notes = nullptr;
 };
 
 /**
  * Main automatic note matcher - equivalent to Python's PianoRollNoNodeMatcher
+ * 
+ * Alignment is const and reentrant: one configured matcher can serve
+ * concurrent calls from many threads. Overloads without a workspace use a
+ * thread-local one (see AlignmentWorkspace); set_config must not race with
+ * alignment calls.
  */
 class AutomaticNoteMatcher {
 private:
     std::unique_ptr<DynamicTimeWarping> note_matcher_;
-    std::unique_ptr<SequenceAugmentedGreedyMatcher> symbolic_note_matcher_;
-    std::unique_ptr<SimplestGreedyMatcher> greedy_symbolic_note_matcher_;
-    
-    // Configuration parameters
-    std::string alignment_type_ = "dtw";
-    float score_fine_node_length_ = 0.25f;
-    int s_time_div_ = 16;
-    int p_time_div_ = 16;
-    float sfuzziness_ = 8.0f;
-    float pfuzziness_ = 8.0f;
-    int window_size_ = 1;
-    bool pfuzziness_relative_to_tempo_ = true;
-    bool shift_onsets_ = false;
-    int cap_combinations_ = 10000;
+    AutomaticNoteMatcherConfig config_;
+    std::shared_ptr<WindowCache> window_cache_;
     
 public:
     using Config = AutomaticNoteMatcherConfig;
@@ -91,15 +228,128 @@ public:
     // Main alignment function
     AlignmentVector operator()(const NoteArray& score_notes, 
                               const NoteArray& performance_notes,
-                              bool verbose_time = false);
+                              bool verbose_time = false) const;
+    
+    // Same, with caller-provided scratch storage
+    AlignmentVector operator()(const NoteArray& score_notes,
+                              const NoteArray& performance_notes,
+                              AlignmentWorkspace& workspace,
+                              bool verbose_time = false) const;
+    
+    // Same, also reporting per-stage measurements
+    AlignmentVector operator()(const NoteArray& score_notes,
+                              const NoteArray& performance_notes,
+                              AlignmentStats& stats) const;
+    AlignmentVector operator()(const NoteArray& score_notes,
+                              const NoteArray& performance_notes,
+                              AlignmentWorkspace& workspace,
+                              AlignmentStats& stats) const;
+    
+    // Score data for this matcher's s_time_div
+    PreparedScore prepare_score(NoteArray score_notes) const;
+    
+    // Align against a prepared score; equal to operator() on its notes
+    AlignmentVector align(const PreparedScore& score,
+                          const NoteArray& performance_notes) const;
+    AlignmentVector align(const PreparedScore& score,
+                          const NoteArray& performance_notes,
+                          AlignmentWorkspace& workspace) const;
+    AlignmentVector align(const PreparedScore& score,
+                          const NoteArray& performance_notes,
+                          AlignmentWorkspace& workspace,
+                          AlignmentStats& stats) const;
+    
+    using BatchCallback = std::function<void(size_t index, AlignmentVector&& alignment)>;
+    
+    /**
+     * Align many independent pairs on one work-stealing pool
+     * 
+     * Pairs start largest first, and the windows of each pair are matched as
+     * separate tasks, so a long piece spreads over all threads instead of
+     * finishing last on one. on_result gets each alignment with its pair
+     * index as soon as it is mended, never concurrently. Alignments equal
+     * those of operator() on each pair. Pairs without notes throw
+     * std::invalid_argument; the first exception of a task or the callback
+     * stops the batch and is rethrown. num_threads 0 = automatic.
+     */
+    void align_batch(const AlignmentPair* pairs, size_t num_pairs,
+                     const BatchCallback& on_result, unsigned int num_threads = 0) const;
+    void align_batch(const std::vector<AlignmentPair>& pairs,
+                     const BatchCallback& on_result, unsigned int num_threads = 0) const;
     
     // Getter methods for configuration
     const Config& get_config() const;
     void set_config(const Config& config);
     
+    /**
+     * Use a cache of window matches (null, the default, disables it)
+     * 
+     * A window whose notes and matching config (alignment_type, time
+     * divisions, shift_onsets, cap_combinations, random_seed) were seen before
+     * reuses the cached matches, across calls and across matchers sharing the
+     * cache. Fuzziness and window_size only decide the windows, so sweeps over
+     * them hit. Alignments are unchanged; AlignmentStats count window work
+     * only for misses. Like set_config, must not race with alignment calls.
+     */
+    void set_window_cache(std::shared_ptr<WindowCache> cache);
+    const std::shared_ptr<WindowCache>& window_cache() const;
+    
 private:
+    friend class IncrementalAlignment;
+    
     void initialize_matchers();
-    void update_config(const Config& config);
+    // prepared, if given, holds score_notes
+    AlignmentVector align_impl(const NoteArray& score_notes,
+                               const PreparedScore* prepared,
+                               const NoteArray& performance_notes,
+                               AlignmentWorkspace& workspace,
+                               AlignmentStats& stats,
+                               bool window_details) const;
+};
+
+/**
+ * Alignment of one performance that follows local edits of its notes
+ * 
+ * Keeps the coarse alignment times, the windows and the matches of every
+ * window from the last run. After an edit the performance is cut again with
+ * the kept coarse times (a linear pass); windows whose score and
+ * performance notes are unchanged reuse their matches, only windows holding
+ * edited notes are matched again, and the window matches are mended into a
+ * new alignment. The result equals a full run whose coarse DTW returned the
+ * kept times; realign() also redoes the coarse DTW, which is worth it once
+ * edits have moved the tempo. Inserted notes need ids unique in the
+ * performance. The matcher must outlive this object, and one instance must
+ * not be edited concurrently.
+ */
+class IncrementalAlignment {
+public:
+    IncrementalAlignment(const AutomaticNoteMatcher& matcher, PreparedScore score, NoteArray performance_notes);
+    ~IncrementalAlignment();
+    IncrementalAlignment(IncrementalAlignment&&) noexcept;
+    IncrementalAlignment& operator=(IncrementalAlignment&&) noexcept;
+    
+    const AlignmentVector& alignment() const;
+    const NoteArray& performance_notes() const;
+    const PreparedScore& score() const;
+    
+    /**
+     * Replace num_removed performance notes starting at first_row by notes
+     * (either may be empty), then update the alignment. Rows out of range
+     * throw std::out_of_range.
+     */
+    const AlignmentVector& replace_notes(size_t first_row, size_t num_removed, const NoteArray& notes);
+    
+    // Run the whole pipeline again, coarse DTW included
+    const AlignmentVector& realign();
+    
+    size_t num_windows() const;
+    
+    // Windows matched by the last update (all of them after realign())
+    size_t last_recomputed_windows() const;
+    
+private:
+    struct State;
+    std::unique_ptr<State> state_;
 };
 
 /**
@@ -113,6 +363,7 @@ struct FScoreResult {
     double f_score;
     size_t n_predicted;
     size_t n_ground_truth;
+    size_t n_correct;  // Predictions found in the ground truth
 };
 
 FScoreResult fscore_alignments(
@@ -128,6 +379,90 @@ FScoreResult fscore_matches(
     const AlignmentVector& ground_truth
 );
 
+// Evaluate many (prediction, ground truth) pairs in parallel (0 threads = automatic)
+std::vector<FScoreResult> fscore_alignments_batch(
+    const std::vector<AlignmentVector>& predictions,
+    const std::vector<AlignmentVector>& ground_truths,
+    const std::vector<Alignment::Label>& types,
+    unsigned int num_threads = 0
+);
+
+std::vector<FScoreResult> fscore_matches_batch(
+    const std::vector<AlignmentVector>& predictions,
+    const std::vector<AlignmentVector>& ground_truths,
+    unsigned int num_threads = 0
+);
+
+// Precision, recall and F-score over the summed counts of all results
+FScoreResult micro_average(const std::vector<FScoreResult>& results);
+
 } // namespace evaluation
 
+namespace sweep {
+
+/**
+ * One piece of a parameter sweep; the notes and ground truth are not owned
+ */
+struct Piece {
+    const NoteArray* score_notes = nullptr;
+    const NoteArray* performance_notes = nullptr;
+    const AlignmentVector* ground_truth = nullptr;
+};
+
+/**
+ * A grid of configurations: every combination of the listed values, with
+ * the remaining fields (and empty lists) taken from base
+ */
+struct Grid {
+    AutomaticNoteMatcherConfig base;
+    std::vector<std::string> alignment_types;
+    std::vector<int> s_time_divs;
+    std::vector<int> p_time_divs;
+    std::vector<float> sfuzziness;
+    std::vector<float> pfuzziness;
+    std::vector<int> window_sizes;
+    std::vector<int> cap_combinations;
+    
+    // In row-major order, alignment_types varying slowest
+    std::vector<AutomaticNoteMatcherConfig> configs() const;
+};
+
+struct Result {
+    AutomaticNoteMatcherConfig config;
+    std::vector<evaluation::FScoreResult> pieces;  // Matches F-score per piece
+    evaluation::FScoreResult total;                // Micro-averaged over all matches
+};
+
+// Distinct intermediates a sweep computed, over all pieces
+struct Stats {
+    size_t score_rolls = 0;        // Per s_time_div
+    size_t performance_rolls = 0;  // Per p_time_div
+    size_t coarse_alignments = 0;  // Per time division pair
+    size_t window_cuts = 0;        // Per time divisions and window settings
+    size_t alignments = 0;         // Per configuration with distinct results
+};
+
+/**
+ * Evaluate every configuration against the ground truth of every piece
+ * 
+ * Each intermediate is computed once per piece and shared by all
+ * configurations that agree on the fields it depends on: piano rolls per
+ * time division, the coarse DTW per (s_time_div, p_time_div), windows per
+ * fuzziness and window_size setting, and the window matches per
+ * alignment_type, shift_onsets, cap_combinations and random_seed. Windows
+ * that different settings cut alike share a WindowCache. The resulting tree
+ * runs on one work-stealing pool (num_threads 0 = automatic). Results are
+ * in config order and equal evaluating AutomaticNoteMatcher(config) on each
+ * piece. Pieces without notes or ground truth and non-positive time
+ * divisions throw std::invalid_argument.
+ */
+std::vector<Result> run(const std::vector<Piece>& pieces,
+                        const std::vector<AutomaticNoteMatcherConfig>& configs,
+                        unsigned int num_threads = 0);
+std::vector<Result> run(const std::vector<Piece>& pieces,
+                        const std::vector<AutomaticNoteMatcherConfig>& configs,
+                        Stats& stats, unsigned int num_threads = 0);
+
+} // namespace sweep
+
 } // namespace parangonar
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <parangonar/note.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace parangonar {
+
+/**
+ * Tempo change from a set tempo meta event
+ */
+struct TempoChange {
+    int64_t tick = 0;
+    int microseconds_per_quarter = 500000;
+    double seconds = 0.0;  // Time of the change
+    int track = 0;  // Track of the event; only used to time format 2 files
+};
+
+/**
+ * Contents of a Standard MIDI File as performance data
+ */
+struct MidiFileData {
+    int format = 0;
+    int num_tracks = 0;
+    int ticks_per_quarter = 480;  // 0 for SMPTE time division
+    // Sorted, starts at tick 0; in format 2 one such map per track, in track order
+    std::vector<TempoChange> tempo_map;
+    NoteArray notes;  // Sorted by onset, ids "n0", "n1", ...
+    std::vector<std::pair<int, int>> sustain_pedal;  // (tick, value) of CC64, all channels
+};
+
+/**
+ * Standard MIDI File (SMF format 0/1/2) reader
+ * 
+ * Parses track chunks in place from a memory-mapped file: handles running
+ * status, meta and sysex events, tempo maps and SMPTE divisions. Formats
+ * 0 and 1 share one global tempo map; format 2 tracks are independent
+ * sequences, each timed by its own tempo changes.
+ * Note-on/note-off pairs (velocity 0 note-ons count as note-off) are
+ * matched first-in first-out per track, channel and pitch; notes still
+ * sounding at the end of their track end there. Notes get onset/duration
+ * in ticks and seconds, pitch, velocity, track and channel.
+ * Malformed files throw std::runtime_error.
+ */
+class MidiFileReader {
+public:
+    static MidiFileData read_file(const std::string& filename);
+    static MidiFileData parse(std::string_view bytes);
+    
+    // Convenience: performance notes only
+    static NoteArray read_notes(const std::string& filename);
+};
+
+} // namespace parangonar
@@ -74,9 +74,64 @@ std::vector<int> unique_pitches(const NoteArray& notes);
 std::vector<float> onset_times_beat(const NoteArray& notes);
 std::vector<float> onset_times_sec(const NoteArray& notes);
 
-// Create piano roll representation
+// Get pitches
+std::vector<int> pitches(const NoteArray& notes);
+
+// Widest pitch range of the arrays indexed by pitch; far beyond the 128 MIDI
+// pitches, it only rejects corrupt values
+constexpr size_t MAX_PITCH_RANGE = size_t(1) << 16;
+
+// Number of pitches from min_pitch to max_pitch, computed without int
+// overflow; throws std::invalid_argument above MAX_PITCH_RANGE
+size_t pitch_range(int min_pitch, int max_pitch);
+
+/**
+ * Note indices grouped by pitch, each group sorted by onset
+ */
+struct PitchPartition {
+    std::vector<int> pitches;      // Unique pitches in ascending order
+    std::vector<size_t> offsets;   // Group g spans indices[offsets[g], offsets[g + 1])
+    std::vector<size_t> indices;   // Note indices, grouped by pitch
+    std::vector<size_t> counts;    // Counting sort scratch, kept for reuse
+};
+
+// Partition note indices by pitch in a single pass (onsets give the in-group order)
+PitchPartition partition_by_pitch(const NoteArray& notes, const std::vector<float>& onsets);
+PitchPartition partition_by_pitch(const std::vector<int>& pitches, const std::vector<float>& onsets);
+
+// Same, reusing the storage of an existing partition
+void partition_by_pitch(const std::vector<int>& pitches, const std::vector<float>& onsets, PitchPartition& partition);
+
+/**
+ * Piano roll stored pitch-major: num_steps values for each pitch from
+ * min_pitch up
+ */
+struct FlatPianoroll {
+    std::vector<float> values;
+    size_t num_pitches = 0;
+    size_t num_steps = 0;
+    int min_pitch = 0;
+};
+
+/**
+ * Piano roll of the given rows of onset, duration and pitch columns (rows
+ * 0..num_rows-1 if rows is null); pitches >= 128 are left out when
+ * remove_drums is set. Every compute_pianoroll overload builds its roll
+ * here. Reuses the storage of roll.
+ */
+void compute_pianoroll(const float* onsets, const float* durations, const int* pitches,
+                       const size_t* rows, size_t num_rows, int time_div, bool remove_drums,
+                       FlatPianoroll& roll);
+
+// Time x pitch rows of a flat roll, the layout compute_pianoroll returns
+std::vector<std::vector<float>> time_major(const FlatPianoroll& roll);
+
+// Create piano roll representation (time x pitch)
 std::vector<std::vector<float>> compute_pianoroll(const NoteArray& notes, int time_div = 16, bool remove_drums = false);
 
+// Same roll, flat and pitch-major, reusing the storage of roll
+void compute_pianoroll(const NoteArray& notes, int time_div, bool remove_drums, FlatPianoroll& roll);
+
 } // namespace note_array
 
 /**
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <parangonar/note.hpp>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace parangonar {
+
+/**
+ * Interned string storage; each distinct string is kept once and
+ * referenced by a 32-bit index
+ */
+class StringPool {
+private:
+    std::deque<std::string> strings_;  // Stable storage backing the lookup keys
+    std::unordered_map<std::string_view, uint32_t> lookup_;
+    
+public:
+    // Return the index of str, adding it if not yet present
+    uint32_t intern(std::string_view str);
+    
+    const std::string& str(uint32_t index) const { return strings_[index]; }
+    size_t size() const { return strings_.size(); }
+};
+
+/**
+ * Columnar (structure-of-arrays) note storage
+ * 
+ * Holds only the fields the alignment pipeline scans: onset, duration,
+ * pitch, velocity and an interned id. Onsets and durations are in beats
+ * for score tables and in seconds for performance tables. Tables cut from
+ * the same source share one id pool, so selecting rows never copies strings.
+ */
+struct NoteTable {
+    enum class TimeBase {
+        BEAT,
+        SECONDS
+    };
+    
+    TimeBase time_base = TimeBase::BEAT;
+    std::vector<float> onset;
+    std::vector<float> duration;
+    std::vector<int> pitch;
+    std::vector<int> velocity;
+    std::vector<uint32_t> id;
+    std::shared_ptr<StringPool> id_pool;
+    
+    explicit NoteTable(TimeBase time_base = TimeBase::BEAT, std::shared_ptr<StringPool> id_pool = nullptr);
+    
+    // Converters from and to NoteArray
+    static NoteTable from_score(const NoteArray& notes, std::shared_ptr<StringPool> id_pool = nullptr);
+    static NoteTable from_performance(const NoteArray& notes, std::shared_ptr<StringPool> id_pool = nullptr);
+    NoteArray to_note_array() const;
+    
+    size_t size() const { return onset.size(); }
+    bool empty() const { return onset.empty(); }
+    void reserve(size_t n);
+    void clear();
+    
+    void push_back(float note_onset, float note_duration, int note_pitch, int note_velocity, std::string_view note_id);
+    
+    // Id string of a row
+    const std::string& id_str(size_t row) const { return id_pool->str(id[row]); }
+    
+    // Gather the given rows into a new table sharing this table's id pool
+    NoteTable select(const std::vector<size_t>& rows) const;
+};
+
+namespace note_array {
+
+// Partition table rows by pitch, each group sorted by onset
+PitchPartition partition_by_pitch(const NoteTable& notes);
+
+// Create piano roll representation from a table
+std::vector<std::vector<float>> compute_pianoroll(const NoteTable& notes, int time_div = 16, bool remove_drums = false);
+
+// Same roll, flat and pitch-major, reusing the storage of roll
+void compute_pianoroll(const NoteTable& notes, int time_div, bool remove_drums, FlatPianoroll& roll);
+
+} // namespace note_array
+
+} // namespace parangonar
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace parangonar {
+
+/**
+ * Lightweight parallel loop helpers
+ */
+namespace parallel {
+
+/**
+ * Number of threads used when a caller asks for 0 (= automatic).
+ * Single-threaded Emscripten builds always run on the calling thread.
+ */
+inline unsigned int default_thread_count() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 1;
+#else
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+#endif
+}
+
+namespace detail {
+
+/**
+ * Process-wide helper threads shared by every parallel call
+ * 
+ * Threads are started on first demand and then park on a condition
+ * variable between calls, so repeated calls neither create threads nor
+ * spin while idle. run() offers helper slots to the team while the caller
+ * works itself; slots no thread has started by the time the caller is done
+ * are dropped, so concurrent and nested calls never wait for each other.
+ */
+class WorkerTeam {
+public:
+    static WorkerTeam& instance() {
+        static WorkerTeam team;
+        return team;
+    }
+    
+    ~WorkerTeam() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+    
+    // Call helper(slot) for slots 1..num_helpers on team threads and own()
+    // on the calling thread; returns once own() and every started helper
+    // have returned. Neither function may throw.
+    template<typename Helper, typename Own>
+    void run(size_t num_helpers, const Helper& helper, const Own& own) {
+        if (num_helpers == 0) {
+            own();
+            return;
+        }
+        const std::function<void(size_t)> call_helper = helper;
+        Group group{&call_helper, 1, num_helpers + 1, 0};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (threads_.size() < num_helpers) {
+                threads_.emplace_back([this]() { serve(); });
+            }
+            groups_.push_back(&group);
+        }
+        wake_.notify_all();
+        
+        own();
+        
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = std::find(groups_.begin(), groups_.end(), &group);
+        if (it != groups_.end()) {
+            groups_.erase(it);
+        }
+        done_.wait(lock, [&group]() { return group.running == 0; });
+    }
+    
+private:
+    struct Group {
+        const std::function<void(size_t)>* helper;
+        size_t next_slot;
+        size_t end_slot;
+        size_t running;
+    };
+    
+    std::mutex mutex_;
+    std::condition_variable wake_;  // Team threads wait for groups
+    std::condition_variable done_;  // Callers wait for their started helpers
+    std::vector<std::thread> threads_;
+    std::deque<Group*> groups_;     // Groups with unstarted slots
+    bool stop_ = false;
+    
+    WorkerTeam() = default;
+    
+    void serve() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this]() { return stop_ || !groups_.empty(); });
+            if (stop_) {
+                return;
+            }
+            Group* group = groups_.front();
+            size_t slot = group->next_slot++;
+            if (group->next_slot == group->end_slot) {
+                groups_.pop_front();
+            }
+            group->running++;
+            lock.unlock();
+            (*group->helper)(slot);
+            lock.lock();
+            if (--group->running == 0) {
+                done_.notify_all();
+            }
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * Run fn(i) for every i in [0, count) on up to num_threads threads
+ * (0 = default_thread_count()). Indices are handed out dynamically, so
+ * uneven work items balance across threads. The first exception thrown
+ * by fn is rethrown on the calling thread after all workers finish.
+ */
+template<typename Fn>
+void parallel_for(size_t count, unsigned int num_threads, Fn&& fn) {
+    if (num_threads == 0) {
+        num_threads = default_thread_count();
+    }
+    num_threads = static_cast<unsigned int>(std::min<size_t>(num_threads, count));
+    
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next.store(count);
+            }
+        }
+    };
+    
+    detail::WorkerTeam::instance().run(num_threads - 1, [&worker](size_t) { worker(); }, worker);
+    
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * Work-stealing pool for trees of tasks
+ * 
+ * Root tasks wait in a shared queue in submission order. A task running on
+ * the pool can spawn() subtasks onto its worker's own deque; each worker
+ * takes its newest task first, and an idle worker steals the oldest task
+ * of another worker before it starts a new root, so work already begun is
+ * finished before more is started. run() executes on num_threads threads
+ * (0 = default_thread_count()) including the caller, borrowing the others
+ * from the process-wide detail::WorkerTeam, and returns once every task,
+ * spawned ones included, has finished. Workers without a task park until
+ * one is queued. The first exception thrown by a task stops the run and is
+ * rethrown on the calling thread.
+ */
+class TaskPool {
+public:
+    using Task = std::function<void()>;
+    
+    explicit TaskPool(unsigned int num_threads = 0)
+        : num_threads_(num_threads == 0 ? default_thread_count() : num_threads) {
+        for (unsigned int i = 0; i < num_threads_; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+    }
+    
+    unsigned int num_threads() const { return num_threads_; }
+    
+    // Slot in [0, num_threads()) of the calling thread while it runs a task
+    // of this pool; no two running tasks share a slot, so per-slot scratch
+    // needs no locking
+    size_t worker_index() const {
+        const auto& [pool, index] = current_worker();
+        return pool == this ? index : 0;
+    }
+    
+    // Add a root task
+    void submit(Task task) {
+        pending_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(roots_mutex_);
+            roots_.push_back(std::move(task));
+        }
+        signal(false);
+    }
+    
+    // Add a subtask from a task running on this pool (a root task otherwise)
+    void spawn(Task task) {
+        const auto& [pool, index] = current_worker();
+        if (pool != this) {
+            submit(std::move(task));
+            return;
+        }
+        pending_.fetch_add(1);
+        {
+            Worker& worker = *workers_[index];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        signal(false);
+    }
+    
+    void run() {
+        abort_.store(false);
+        detail::WorkerTeam::instance().run(num_threads_ - 1, [this](size_t slot) { work(slot); },
+                                           [this]() { work(0); });
+        
+        // Drop what an abort left behind
+        roots_.clear();
+        for (auto& worker : workers_) {
+            worker->tasks.clear();
+        }
+        pending_.store(0);
+        
+        if (error_) {
+            std::exception_ptr error = std::move(error_);
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+    
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    
+    unsigned int num_threads_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex roots_mutex_;
+    std::deque<Task> roots_;
+    std::atomic<size_t> pending_{0};  // Queued or running tasks
+    std::atomic<bool> abort_{false};
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+    std::mutex idle_mutex_;
+    std::condition_variable idle_;
+    uint64_t events_ = 0;  // Queued tasks, finished runs and aborts, under idle_mutex_
+    
+    static std::pair<const TaskPool*, size_t>& current_worker() {
+        thread_local std::pair<const TaskPool*, size_t> worker{nullptr, 0};
+        return worker;
+    }
+    
+    // Wake one parked worker for a new task, or all once the run is over
+    void signal(bool all) {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+            events_++;
+        }
+        if (all) {
+            idle_.notify_all();
+        } else {
+            idle_.notify_one();
+        }
+    }
+    
+    bool take(size_t self, Task& task) {
+        {
+            Worker& own = *workers_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < workers_.size(); ++k) {
+            Worker& victim = *workers_[(self + k) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        std::lock_guard<std::mutex> lock(roots_mutex_);
+        if (!roots_.empty()) {
+            task = std::move(roots_.front());
+            roots_.pop_front();
+            return true;
+        }
+        return false;
+    }
+    
+    void work(size_t self) {
+        auto previous = current_worker();
+        current_worker() = {this, self};
+        
+        while (!abort_.load()) {
+            // Events after this point are seen by take() or end the wait
+            uint64_t seen;
+            {
+                std::lock_guard<std::mutex> lock(idle_mutex_);
+                seen = events_;
+            }
+            
+            Task task;
+            if (take(self, task)) {
+                try {
+                    task();
+                } catch (...) {
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex_);
+                        if (!error_) {
+                            error_ = std::current_exception();
+                        }
+                    }
+                    abort_.store(true);
+                    signal(true);
+                }
+                if (pending_.fetch_sub(1) == 1) {
+                    signal(true);
+                }
+                continue;
+            }
+            if (pending_.load() == 0) {
+                break;
+            }
+            
+            // Running tasks may still spawn
+            std::unique_lock<std::mutex> lock(idle_mutex_);
+            idle_.wait(lock, [&]() { return events_ != seen || pending_.load() == 0 || abort_.load(); });
+        }
+        
+        current_worker() = previous;
+    }
+};
+
+} // namespace parallel
+} // namespace parangonar
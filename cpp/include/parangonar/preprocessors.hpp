@@ -1,6 +1,7 @@
 #pragma once
 
 #include <parangonar/note.hpp>
+#include <parangonar/note_table.hpp>
 #include <parangonar/dtw.hpp>
 #include <vector>
 #include <utility>
@@ -26,6 +27,9 @@ namespace preprocessors {
 
 /**
  * Compute alignment times from DTW on piano roll representations
+ * 
+ * Builds the same flat piano rolls and DTW path as the coarse pass of
+ * AutomaticNoteMatcher.
  */
 TimeAlignmentVector alignment_times_from_dtw(
     const NoteArray& score_notes,
@@ -36,6 +40,28 @@ TimeAlignmentVector alignment_times_from_dtw(
     int p_time_div = 16
 );
 
+TimeAlignmentVector alignment_times_from_dtw(
+    const NoteTable& score_notes,
+    const NoteTable& performance_notes,
+    const DynamicTimeWarping& matcher = DynamicTimeWarping(),
+    float score_fine_node_length = 1.0f,
+    int s_time_div = 16,
+    int p_time_div = 16
+);
+
+/**
+ * Alignment times from a DTW path over pitch x time piano rolls
+ * 
+ * Path steps are scaled by the time divisions, sorted by score time and
+ * deduplicated. Reuses the storage of alignment_times.
+ */
+void alignment_times_from_path(
+    const DTWPath& path,
+    int s_time_div,
+    int p_time_div,
+    TimeAlignmentVector& alignment_times
+);
+
 /**
  * Cut note arrays into windows based on alignment times
  */
@@ -49,8 +75,51 @@ std::pair<std::vector<NoteArray>, std::vector<NoteArray>> cut_note_arrays(
     bool pfuzziness_relative_to_tempo = true
 );
 
+std::pair<std::vector<NoteTable>, std::vector<NoteTable>> cut_note_arrays(
+    const NoteTable& performance_notes,
+    const NoteTable& score_notes,
+    const TimeAlignmentVector& alignment_times,
+    float sfuzziness = 4.0f,
+    float pfuzziness = 4.0f,
+    int window_size = 1,
+    bool pfuzziness_relative_to_tempo = true
+);
+
+/**
+ * Row indices of the windows cut_note_arrays would produce
+ */
+struct WindowRows {
+    std::vector<size_t> score_offsets;         // Window w spans score_rows[score_offsets[w], score_offsets[w + 1])
+    std::vector<size_t> score_rows;
+    std::vector<size_t> performance_offsets;   // Same for performance_rows
+    std::vector<size_t> performance_rows;
+    
+    size_t size() const { return score_offsets.empty() ? 0 : score_offsets.size() - 1; }
+};
+
+/**
+ * Same windows as cut_note_arrays, from onset columns (beats for the score,
+ * seconds for the performance). Reuses the storage of windows.
+ */
+void cut_note_rows(
+    const std::vector<float>& performance_onsets,
+    const std::vector<float>& score_onsets,
+    const TimeAlignmentVector& alignment_times,
+    WindowRows& windows,
+    float sfuzziness = 4.0f,
+    float pfuzziness = 4.0f,
+    int window_size = 1,
+    bool pfuzziness_relative_to_tempo = true
+);
+
 /**
  * Mend windowed alignments into a global alignment
+ * 
+ * Runs the mending of AutomaticNoteMatcher (defined with it in
+ * matchers.cpp): conflicting matches go to the earliest window, leftover
+ * notes are matched greedily by pitch, and the rest become deletions and
+ * insertions. Matches naming ids absent from the notes are skipped.
+ * node_times and max_traversal_depth are unused.
  */
 AlignmentVector mend_note_alignments(
     const std::vector<AlignmentVector>& note_alignments,
@@ -67,12 +136,18 @@ class LinearInterpolator {
 private:
     std::vector<float> x_vals;
     std::vector<float> y_vals;
+    std::vector<size_t> sort_order;
     
 public:
+    LinearInterpolator() = default;  // Empty; call assign() before interpolating
     LinearInterpolator(const std::vector<float>& x, const std::vector<float>& y);
     
+    // Replace the points, reusing storage
+    void assign(const std::vector<float>& x, const std::vector<float>& y);
+    
     float interpolate(float x) const;
     std::vector<float> interpolate(const std::vector<float>& x_points) const;
+    void interpolate(const std::vector<float>& x_points, std::vector<float>& result) const;
 };
 
 } // namespace preprocessors
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <parangonar/note.hpp>
+#include <parangonar/match_parser.hpp>
+#include <cstddef>
+
+namespace parangonar {
+namespace synthetic {
+
+/**
+ * Parameters of a synthetic score
+ */
+struct ScoreConfig {
+    size_t num_notes = 1000;
+    unsigned int seed = 0;
+    int min_pitch = 36;
+    int max_pitch = 84;
+    int max_chord_size = 3;
+    float grid = 0.25f;  // Onset grid in beats
+};
+
+/**
+ * Parameters of a synthetic performance
+ * 
+ * Rates are probabilities per score note. Deleted notes get no ornaments;
+ * a trilled note is not also repeated.
+ */
+struct PerformanceConfig {
+    unsigned int seed = 0;
+    
+    // Tempo curve: random walk of the log tempo per onset, times an
+    // optional sinusoidal rubato, clamped to the given range
+    float seconds_per_beat = 0.5f;
+    float tempo_drift = 0.004f;          // Std dev of each log tempo step
+    float rubato_depth = 0.0f;           // Relative amplitude of the sinusoid
+    float rubato_period = 16.0f;         // In beats
+    float min_seconds_per_beat = 0.2f;
+    float max_seconds_per_beat = 1.5f;
+    
+    // Timing
+    float onset_jitter = 0.015f;         // Std dev in seconds, shared by a chord
+    float chord_asynchrony = 0.01f;      // Std dev in seconds, per note of a chord
+    float articulation = 0.9f;           // Performed / notated duration
+    
+    // Errors and ornaments
+    float deletion_rate = 0.02f;         // Score note not played
+    float insertion_rate = 0.02f;        // Extra note a semitone or two away
+    float repeated_note_rate = 0.0f;     // Played note struck again halfway through
+    float trill_rate = 0.0f;             // Played note trilled with its upper neighbour
+    int trill_length = 6;                // Notes per trill, including the main note
+    float trill_note_sec = 0.06f;        // Spacing of trill notes
+    
+    int min_velocity = 40;
+    int max_velocity = 100;
+    
+    // Clock of the tick fields (480 units and 500000 us per quarter: 960 ticks/s)
+    int midi_clock_units = 480;
+    int midi_clock_rate = 500000;
+};
+
+/**
+ * Synthesized performance with its ground truth
+ */
+struct SyntheticPerformance {
+    NoteArray performance_notes;  // Sorted by onset, ids "p0", "p1", ...
+    AlignmentVector alignment;    // Match/deletion per score note in score order, then insertions
+    MatchFileInfo info;           // Clock settings of the tick fields, for writing match files
+};
+
+/**
+ * Random score: chords on the onset grid with pitches from a random walk,
+ * ids "n0", "n1", ...
+ */
+NoteArray generate_score(const ScoreConfig& config);
+
+/**
+ * Synthesize a performance of the given score
+ * 
+ * Runs in O(n log n) for n score notes with a single pass over the score, so
+ * it scales to millions of notes. Output depends only on the score and the
+ * config; random numbers are drawn from std::mt19937 directly rather than
+ * through standard library distributions, whose output varies between
+ * implementations. Onsets and durations are rounded to whole ticks and the
+ * seconds fields derived from them as the match file parser does. Score
+ * notes need unique ids; invalid rates or an empty id throw
+ * std::invalid_argument.
+ */
+SyntheticPerformance generate_performance(const NoteArray& score_notes, const PerformanceConfig& config);
+
+} // namespace synthetic
+} // namespace parangonar
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(PARANGONAR_ENABLE_TRACING)
+#include <atomic>
+#include <chrono>
+#endif
+
+namespace parangonar {
+namespace trace {
+
+/**
+ * Scoped timing spans, exported as Chrome Trace Event JSON
+ * 
+ * Tracing is compiled in only with PARANGONAR_ENABLE_TRACING defined (the
+ * CMake option of the same name). Without it Span is an empty type and the
+ * functions below do nothing, so instrumented code costs nothing. With it,
+ * spans record only between start() and stop(): a span reads the clock
+ * twice and appends one complete event to a buffer owned by its thread.
+ * Events beyond the per-thread limit are dropped and counted. Buffers of
+ * exited threads are kept for write() and freed by the next clear().
+ * 
+ * The written file loads in chrome://tracing and ui.perfetto.dev; events
+ * carry the recording thread as tid and their arguments (window id, note
+ * counts) as args.
+ */
+
+#if defined(PARANGONAR_ENABLE_TRACING)
+constexpr bool compiled_in = true;
+#else
+constexpr bool compiled_in = false;
+#endif
+
+constexpr size_t DEFAULT_MAX_EVENTS_PER_THREAD = size_t(1) << 20;
+
+// Discard previous events and start recording
+void start(size_t max_events_per_thread = DEFAULT_MAX_EVENTS_PER_THREAD);
+void stop();
+// Discard recorded events and release their memory
+void clear();
+
+size_t num_events();
+size_t num_dropped_events();
+
+// Write the recorded events; safe while other threads are recording
+void write(std::ostream& out);
+void write_file(const std::string& filename);
+
+#if defined(PARANGONAR_ENABLE_TRACING)
+
+namespace detail {
+
+extern std::atomic<bool> recording;
+
+struct Arg {
+    const char* key;
+    int64_t value;
+};
+
+constexpr int MAX_ARGS = 4;
+
+inline int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char* name, int64_t start_ns, int64_t end_ns, const Arg* args, int num_args);
+
+} // namespace detail
+
+inline bool recording() {
+    return detail::recording.load(std::memory_order_relaxed);
+}
+
+/**
+ * Records the time from construction to destruction
+ * 
+ * Names and argument keys must be string literals (they are stored as
+ * pointers). At most four arguments are kept.
+ */
+class Span {
+private:
+    const char* name_;
+    int64_t start_ns_ = 0;
+    detail::Arg args_[detail::MAX_ARGS];
+    int num_args_ = 0;
+    
+public:
+    explicit Span(const char* name) : name_(recording() ? name : nullptr) {
+        if (name_) {
+            start_ns_ = detail::now_ns();
+        }
+    }
+    
+    ~Span() {
+        if (name_) {
+            detail::record(name_, start_ns_, detail::now_ns(), args_, num_args_);
+        }
+    }
+    
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+    
+    Span& arg(const char* key, int64_t value) {
+        if (name_ && num_args_ < detail::MAX_ARGS) {
+            args_[num_args_++] = {key, value};
+        }
+        return *this;
+    }
+};
+
+#else
+
+inline bool recording() {
+    return false;
+}
+
+class Span {
+public:
+    explicit Span(const char*) {}
+    
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+    
+    Span& arg(const char*, int64_t) {
+        return *this;
+    }
+};
+
+#endif
+
+} // namespace trace
+} // namespace parangonar
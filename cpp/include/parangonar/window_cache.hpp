@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace parangonar {
+
+/**
+ * Bounded, thread-safe LRU cache of per-window matches
+ * 
+ * Entries are content-addressed: the key is a sequence of 32-bit words
+ * holding everything a window's fine alignment depends on (its notes and
+ * the relevant config fields), looked up by its 64-bit hash and compared in
+ * full, so a hash collision is a miss rather than a wrong result. Values
+ * are the window's matches as (score position, performance position) pairs
+ * within the window. Once max_entries is reached, the least recently used
+ * entry is evicted. All members may be called concurrently.
+ */
+class WindowCache {
+public:
+    using Key = std::vector<uint32_t>;
+    using Matches = std::vector<std::pair<uint32_t, uint32_t>>;
+    
+    static constexpr size_t DEFAULT_MAX_ENTRIES = 4096;
+    
+    explicit WindowCache(size_t max_entries = DEFAULT_MAX_ENTRIES);
+    
+    static uint64_t hash(const Key& key);
+    
+    // Copy the matches stored for key into matches; counts a hit or a miss
+    bool lookup(uint64_t hash, const Key& key, Matches& matches);
+    
+    // Store (or refresh) the matches of key, evicting the oldest entry if full
+    void insert(uint64_t hash, const Key& key, const Matches& matches);
+    
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    uint64_t evictions() const { return evictions_.load(std::memory_order_relaxed); }
+    size_t size() const;
+    size_t max_entries() const { return max_entries_; }
+    
+    // Drop all entries and reset the counters
+    void clear();
+    
+private:
+    struct Entry {
+        uint64_t hash;
+        Key key;
+        Matches matches;
+    };
+    
+    size_t max_entries_;
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;  // Most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+} // namespace parangonar
@@ -0,0 +1,486 @@
+#include <parangonar/binary_cache.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace parangonar {
+namespace binary_cache {
+
+namespace fs = std::filesystem;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t format_version;
+    uint32_t parser_version;
+    uint32_t num_sustain_events;
+    int64_t source_mtime;
+    uint64_t source_size;
+    float info_version;
+    int32_t midi_clock_units;
+    int32_t midi_clock_rate;
+    uint32_t key_signature;     // String index
+    uint32_t time_signature;    // String index
+    uint32_t num_score_notes;
+    uint32_t num_performance_notes;
+    uint32_t num_alignments;
+    uint32_t num_strings;
+    uint32_t string_bytes;
+};
+
+static_assert(sizeof(FileHeader) == 80, "unexpected binary header layout");
+
+namespace {
+
+constexpr char MAGIC[8] = {'P', 'R', 'G', 'N', 'B', 'I', 'N', '\0'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr int32_t NO_INDEX = -1;
+
+size_t align8(size_t offset) {
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+// Temporary file name no other process, thread or call uses: a random
+// per-process nonce, the thread id and a call counter
+std::string unique_tmp_path(const std::string& path) {
+    static const uint64_t nonce = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+    static std::atomic<uint64_t> counter{0};
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx.%zx.%llu.tmp", static_cast<unsigned long long>(nonce),
+                  std::hash<std::thread::id>{}(std::this_thread::get_id()),
+                  static_cast<unsigned long long>(counter.fetch_add(1)));
+    return path + suffix;
+}
+
+// Byte offsets of every section, derived from the counts in the header
+struct Layout {
+    size_t score_onset, score_duration, score_pitch, score_id;
+    size_t perf_onset, perf_duration, perf_onset_tick, perf_duration_tick, perf_pitch, perf_velocity, perf_id;
+    size_t alignment_label, alignment_score_index, alignment_performance_index;
+    size_t sustain;
+    size_t string_offsets, string_data;
+    size_t end;
+};
+
+Layout compute_layout(const FileHeader& header) {
+    Layout layout;
+    size_t offset = sizeof(FileHeader);
+    auto section = [&offset](size_t bytes) {
+        size_t start = offset;
+        offset = align8(offset + bytes);
+        return start;
+    };
+    
+    const size_t ns = header.num_score_notes;
+    const size_t np = header.num_performance_notes;
+    const size_t na = header.num_alignments;
+    
+    layout.score_onset = section(ns * sizeof(float));
+    layout.score_duration = section(ns * sizeof(float));
+    layout.score_pitch = section(ns * sizeof(int32_t));
+    layout.score_id = section(ns * sizeof(uint32_t));
+    layout.perf_onset = section(np * sizeof(float));
+    layout.perf_duration = section(np * sizeof(float));
+    layout.perf_onset_tick = section(np * sizeof(int32_t));
+    layout.perf_duration_tick = section(np * sizeof(int32_t));
+    layout.perf_pitch = section(np * sizeof(int32_t));
+    layout.perf_velocity = section(np * sizeof(int32_t));
+    layout.perf_id = section(np * sizeof(uint32_t));
+    layout.alignment_label = section(na * sizeof(uint32_t));
+    layout.alignment_score_index = section(na * sizeof(int32_t));
+    layout.alignment_performance_index = section(na * sizeof(int32_t));
+    layout.sustain = section(header.num_sustain_events * 2 * sizeof(int32_t));
+    layout.string_offsets = section((static_cast<size_t>(header.num_strings) + 1) * sizeof(uint32_t));
+    layout.string_data = section(header.string_bytes);
+    layout.end = offset;
+    return layout;
+}
+
+// Interning string table used while writing
+class StringTableBuilder {
+private:
+    std::unordered_map<std::string, uint32_t> lookup_;
+    std::vector<uint32_t> offsets_{0};
+    std::string data_;
+    
+public:
+    uint32_t intern(const std::string& str) {
+        auto it = lookup_.find(str);
+        if (it != lookup_.end()) {
+            return it->second;
+        }
+        uint32_t index = static_cast<uint32_t>(offsets_.size() - 1);
+        data_ += str;
+        offsets_.push_back(static_cast<uint32_t>(data_.size()));
+        lookup_.emplace(str, index);
+        return index;
+    }
+    
+    const std::vector<uint32_t>& offsets() const { return offsets_; }
+    const std::string& data() const { return data_; }
+    uint32_t size() const { return static_cast<uint32_t>(offsets_.size() - 1); }
+};
+
+template<typename T>
+void put_column(std::vector<char>& buffer, size_t offset, const std::vector<T>& column) {
+    if (!column.empty()) {
+        std::memcpy(buffer.data() + offset, column.data(), column.size() * sizeof(T));
+    }
+}
+
+SourceStamp stamp_of(const std::string& path) {
+    SourceStamp stamp;
+    stamp.mtime = static_cast<int64_t>(fs::last_write_time(path).time_since_epoch().count());
+    stamp.size = static_cast<uint64_t>(fs::file_size(path));
+    return stamp;
+}
+
+// FNV-1a, used to name cache entries
+uint64_t hash_string(const std::string& str) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : str) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+} // namespace
+
+void write(const std::string& path, const MatchBundle& bundle, const SourceStamp& source) {
+    StringTableBuilder strings;
+    
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byte_order = BYTE_ORDER_MARK;
+    header.format_version = FORMAT_VERSION;
+    header.parser_version = PARSER_VERSION;
+    header.num_sustain_events = static_cast<uint32_t>(bundle.sustain_pedal.size());
+    header.source_mtime = source.mtime;
+    header.source_size = source.size;
+    header.info_version = bundle.info.version;
+    header.midi_clock_units = bundle.info.midi_clock_units;
+    header.midi_clock_rate = bundle.info.midi_clock_rate;
+    header.key_signature = strings.intern(bundle.info.key_signature);
+    header.time_signature = strings.intern(bundle.info.time_signature);
+    header.num_score_notes = static_cast<uint32_t>(bundle.score_notes.size());
+    header.num_performance_notes = static_cast<uint32_t>(bundle.performance_notes.size());
+    header.num_alignments = static_cast<uint32_t>(bundle.alignment.size());
+    
+    // Score columns
+    const size_t ns = bundle.score_notes.size();
+    std::vector<float> score_onset(ns), score_duration(ns);
+    std::vector<int32_t> score_pitch(ns);
+    std::vector<uint32_t> score_id(ns);
+    std::unordered_map<std::string_view, int32_t> score_index;
+    for (size_t i = 0; i < ns; ++i) {
+        const Note& note = bundle.score_notes[i];
+        score_onset[i] = note.onset_beat;
+        score_duration[i] = note.duration_beat;
+        score_pitch[i] = note.pitch;
+        score_id[i] = strings.intern(note.id);
+        score_index.emplace(note.id, static_cast<int32_t>(i));
+    }
+    
+    // Performance columns
+    const size_t np = bundle.performance_notes.size();
+    std::vector<float> perf_onset(np), perf_duration(np);
+    std::vector<int32_t> perf_onset_tick(np), perf_duration_tick(np), perf_pitch(np), perf_velocity(np);
+    std::vector<uint32_t> perf_id(np);
+    std::unordered_map<std::string_view, int32_t> perf_index;
+    for (size_t i = 0; i < np; ++i) {
+        const Note& note = bundle.performance_notes[i];
+        perf_onset[i] = note.onset_sec;
+        perf_duration[i] = note.duration_sec;
+        perf_onset_tick[i] = note.onset_tick;
+        perf_duration_tick[i] = note.duration_tick;
+        perf_pitch[i] = note.pitch;
+        perf_velocity[i] = note.velocity;
+        perf_id[i] = strings.intern(note.id);
+        perf_index.emplace(note.id, static_cast<int32_t>(i));
+    }
+    
+    // Alignment as note index pairs
+    const size_t na = bundle.alignment.size();
+    std::vector<uint32_t> alignment_label(na);
+    std::vector<int32_t> alignment_score(na, NO_INDEX), alignment_perf(na, NO_INDEX);
+    for (size_t i = 0; i < na; ++i) {
+        const Alignment& align = bundle.alignment[i];
+        alignment_label[i] = static_cast<uint32_t>(align.label);
+        if (align.label != Alignment::Label::INSERTION) {
+            auto it = score_index.find(align.score_id);
+            if (it == score_index.end()) {
+                throw std::invalid_argument("Alignment refers to unknown score note: " + align.score_id);
+            }
+            alignment_score[i] = it->second;
+        }
+        if (align.label != Alignment::Label::DELETION) {
+            auto it = perf_index.find(align.performance_id);
+            if (it == perf_index.end()) {
+                throw std::invalid_argument("Alignment refers to unknown performance note: " + align.performance_id);
+            }
+            alignment_perf[i] = it->second;
+        }
+    }
+    
+    std::vector<int32_t> sustain;
+    sustain.reserve(bundle.sustain_pedal.size() * 2);
+    for (const auto& [time, value] : bundle.sustain_pedal) {
+        sustain.push_back(time);
+        sustain.push_back(value);
+    }
+    
+    header.num_strings = strings.size();
+    header.string_bytes = static_cast<uint32_t>(strings.data().size());
+    
+    // Assemble the image
+    Layout layout = compute_layout(header);
+    std::vector<char> buffer(layout.end, 0);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    put_column(buffer, layout.score_onset, score_onset);
+    put_column(buffer, layout.score_duration, score_duration);
+    put_column(buffer, layout.score_pitch, score_pitch);
+    put_column(buffer, layout.score_id, score_id);
+    put_column(buffer, layout.perf_onset, perf_onset);
+    put_column(buffer, layout.perf_duration, perf_duration);
+    put_column(buffer, layout.perf_onset_tick, perf_onset_tick);
+    put_column(buffer, layout.perf_duration_tick, perf_duration_tick);
+    put_column(buffer, layout.perf_pitch, perf_pitch);
+    put_column(buffer, layout.perf_velocity, perf_velocity);
+    put_column(buffer, layout.perf_id, perf_id);
+    put_column(buffer, layout.alignment_label, alignment_label);
+    put_column(buffer, layout.alignment_score_index, alignment_score);
+    put_column(buffer, layout.alignment_performance_index, alignment_perf);
+    put_column(buffer, layout.sustain, sustain);
+    put_column(buffer, layout.string_offsets, strings.offsets());
+    std::memcpy(buffer.data() + layout.string_data, strings.data().data(), strings.data().size());
+    
+    // Write to a temporary file of this writer first, so readers never see
+    // partial files and concurrent writers of one entry never share one
+    const std::string tmp_path = unique_tmp_path(path);
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot write binary match file: " + path);
+        }
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (!out) {
+            out.close();
+            std::error_code ignored;
+            fs::remove(tmp_path, ignored);
+            throw std::runtime_error("Failed writing binary match file: " + path);
+        }
+    }
+    fs::rename(tmp_path, path);
+}
+
+// BinaryMatchView implementation
+BinaryMatchView::BinaryMatchView(const std::string& path) : file_(path) {
+    if (file_.size() < sizeof(FileHeader)) {
+        throw std::runtime_error("Not a binary match file: " + path);
+    }
+    
+    header_ = reinterpret_cast<const FileHeader*>(file_.data());
+    if (std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header_->byte_order != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Not a binary match file: " + path);
+    }
+    if (header_->format_version != FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported binary match file version: " + path);
+    }
+    
+    Layout layout = compute_layout(*header_);
+    if (file_.size() < layout.end) {
+        throw std::runtime_error("Truncated binary match file: " + path);
+    }
+    
+    const char* base = file_.data();
+    score_onset_ = reinterpret_cast<const float*>(base + layout.score_onset);
+    score_duration_ = reinterpret_cast<const float*>(base + layout.score_duration);
+    score_pitch_ = reinterpret_cast<const int32_t*>(base + layout.score_pitch);
+    score_id_ = reinterpret_cast<const uint32_t*>(base + layout.score_id);
+    perf_onset_ = reinterpret_cast<const float*>(base + layout.perf_onset);
+    perf_duration_ = reinterpret_cast<const float*>(base + layout.perf_duration);
+    perf_onset_tick_ = reinterpret_cast<const int32_t*>(base + layout.perf_onset_tick);
+    perf_duration_tick_ = reinterpret_cast<const int32_t*>(base + layout.perf_duration_tick);
+    perf_pitch_ = reinterpret_cast<const int32_t*>(base + layout.perf_pitch);
+    perf_velocity_ = reinterpret_cast<const int32_t*>(base + layout.perf_velocity);
+    perf_id_ = reinterpret_cast<const uint32_t*>(base + layout.perf_id);
+    alignment_label_ = reinterpret_cast<const uint32_t*>(base + layout.alignment_label);
+    alignment_score_index_ = reinterpret_cast<const int32_t*>(base + layout.alignment_score_index);
+    alignment_performance_index_ = reinterpret_cast<const int32_t*>(base + layout.alignment_performance_index);
+    sustain_ = reinterpret_cast<const int32_t*>(base + layout.sustain);
+    string_offsets_ = reinterpret_cast<const uint32_t*>(base + layout.string_offsets);
+    string_data_ = base + layout.string_data;
+    
+    // Every index is checked here, so the accessors can read without checks
+    const uint32_t num_strings = header_->num_strings;
+    for (uint32_t i = 0; i < num_strings; ++i) {
+        if (string_offsets_[i] > string_offsets_[i + 1]) {
+            throw std::runtime_error("Corrupt string table in binary match file: " + path);
+        }
+    }
+    if (string_offsets_[num_strings] > header_->string_bytes) {
+        throw std::runtime_error("Corrupt string table in binary match file: " + path);
+    }
+    auto check_ids = [&](const uint32_t* ids, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (ids[i] >= num_strings) {
+                throw std::runtime_error("Corrupt note id in binary match file: " + path);
+            }
+        }
+    };
+    check_ids(score_id_, header_->num_score_notes);
+    check_ids(perf_id_, header_->num_performance_notes);
+    auto valid_index = [](int32_t index, uint32_t count) {
+        return index == NO_INDEX || (index >= 0 && static_cast<uint32_t>(index) < count);
+    };
+    for (size_t i = 0; i < header_->num_alignments; ++i) {
+        if (alignment_label_[i] > static_cast<uint32_t>(Alignment::Label::DELETION) ||
+            !valid_index(alignment_score_index_[i], header_->num_score_notes) ||
+            !valid_index(alignment_performance_index_[i], header_->num_performance_notes)) {
+            throw std::runtime_error("Corrupt alignment in binary match file: " + path);
+        }
+    }
+}
+
+uint32_t BinaryMatchView::parser_version() const {
+    return header_->parser_version;
+}
+
+SourceStamp BinaryMatchView::source() const {
+    return {header_->source_mtime, header_->source_size};
+}
+
+MatchFileInfo BinaryMatchView::info() const {
+    MatchFileInfo info;
+    info.version = header_->info_version;
+    info.midi_clock_units = header_->midi_clock_units;
+    info.midi_clock_rate = header_->midi_clock_rate;
+    info.key_signature = string(header_->key_signature);
+    info.time_signature = string(header_->time_signature);
+    return info;
+}
+
+size_t BinaryMatchView::num_score_notes() const { return header_->num_score_notes; }
+size_t BinaryMatchView::num_performance_notes() const { return header_->num_performance_notes; }
+size_t BinaryMatchView::num_alignments() const { return header_->num_alignments; }
+size_t BinaryMatchView::num_sustain_events() const { return header_->num_sustain_events; }
+
+std::string_view BinaryMatchView::string(uint32_t index) const {
+    if (index >= header_->num_strings) {
+        throw std::out_of_range("String index out of range");
+    }
+    return std::string_view(string_data_ + string_offsets_[index],
+                            string_offsets_[index + 1] - string_offsets_[index]);
+}
+
+NoteArray BinaryMatchView::score_notes() const {
+    NoteArray notes(num_score_notes());
+    for (size_t i = 0; i < notes.size(); ++i) {
+        Note& note = notes[i];
+        note.onset_beat = score_onset_[i];
+        note.duration_beat = score_duration_[i];
+        note.pitch = score_pitch_[i];
+        note.id = string(score_id_[i]);
+    }
+    return notes;
+}
+
+NoteArray BinaryMatchView::performance_notes() const {
+    NoteArray notes(num_performance_notes());
+    for (size_t i = 0; i < notes.size(); ++i) {
+        Note& note = notes[i];
+        note.onset_sec = perf_onset_[i];
+        note.duration_sec = perf_duration_[i];
+        note.onset_tick = perf_onset_tick_[i];
+        note.duration_tick = perf_duration_tick_[i];
+        note.pitch = perf_pitch_[i];
+        note.velocity = perf_velocity_[i];
+        note.id = string(perf_id_[i]);
+    }
+    return notes;
+}
+
+AlignmentVector BinaryMatchView::alignment() const {
+    AlignmentVector alignment;
+    alignment.reserve(num_alignments());
+    for (size_t i = 0; i < num_alignments(); ++i) {
+        auto label = static_cast<Alignment::Label>(alignment_label_[i]);
+        int32_t s = alignment_score_index_[i];
+        int32_t p = alignment_performance_index_[i];
+        alignment.emplace_back(label,
+                               s == NO_INDEX ? std::string() : std::string(string(score_id_[s])),
+                               p == NO_INDEX ? std::string() : std::string(string(perf_id_[p])));
+    }
+    return alignment;
+}
+
+MatchBundle BinaryMatchView::bundle() const {
+    MatchBundle bundle;
+    bundle.info = info();
+    bundle.score_notes = score_notes();
+    bundle.performance_notes = performance_notes();
+    bundle.alignment = alignment();
+    bundle.sustain_pedal.reserve(num_sustain_events());
+    for (size_t i = 0; i < num_sustain_events(); ++i) {
+        bundle.sustain_pedal.emplace_back(sustain_[2 * i], sustain_[2 * i + 1]);
+    }
+    return bundle;
+}
+
+// MatchCache implementation
+MatchCache::MatchCache(std::string directory) : directory_(std::move(directory)) {
+    fs::create_directories(directory_);
+}
+
+std::string MatchCache::entry_path(const std::string& match_path) const {
+    std::string key = fs::absolute(match_path).lexically_normal().string();
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.pbin", static_cast<unsigned long long>(hash_string(key)));
+    return (fs::path(directory_) / name).string();
+}
+
+MatchBundle MatchCache::load(const std::string& match_path, bool* hit) const {
+    const SourceStamp stamp = stamp_of(match_path);
+    const std::string cache_path = entry_path(match_path);
+    
+    if (fs::exists(cache_path)) {
+        try {
+            BinaryMatchView view(cache_path);
+            SourceStamp cached = view.source();
+            if (view.parser_version() == PARSER_VERSION &&
+                cached.mtime == stamp.mtime && cached.size == stamp.size) {
+                if (hit) *hit = true;
+                return view.bundle();
+            }
+        } catch (const std::exception&) {
+            // Stale or corrupt entry; fall through and rebuild it
+        }
+    }
+    
+    if (hit) *hit = false;
+    
+    // Miss: parse the text file and store the result
+    MatchNotes notes = MatchFileParser::load_notes(match_path);
+    MatchBundle bundle;
+    bundle.info = std::move(notes.info);
+    bundle.score_notes = std::move(notes.score_notes);
+    bundle.performance_notes = std::move(notes.performance_notes);
+    bundle.alignment = std::move(notes.alignment);
+    bundle.sustain_pedal = std::move(notes.sustain_pedal);
+    
+    write(cache_path, bundle, stamp);
+    return bundle;
+}
+
+} // namespace binary_cache
+} // namespace parangonar
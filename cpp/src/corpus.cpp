@@ -0,0 +1,120 @@
+#include <parangonar/corpus.hpp>
+#include <parangonar/mapped_file.hpp>
+#include <parangonar/parallel.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+namespace parangonar {
+
+namespace fs = std::filesystem;
+
+std::vector<std::string> CorpusLoader::list_files(const std::string& directory, const CorpusOptions& options) {
+    if (!fs::is_directory(directory)) {
+        throw std::runtime_error("Not a directory: " + directory);
+    }
+    
+    std::vector<std::string> files;
+    auto add_entry = [&](const fs::directory_entry& entry) {
+        if (entry.is_regular_file() &&
+            (options.extension.empty() || entry.path().extension() == options.extension)) {
+            files.push_back(entry.path().string());
+        }
+    };
+    
+    if (options.recursive) {
+        for (const auto& entry : fs::recursive_directory_iterator(directory)) {
+            add_entry(entry);
+        }
+    } else {
+        for (const auto& entry : fs::directory_iterator(directory)) {
+            add_entry(entry);
+        }
+    }
+    
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+CorpusSummary CorpusLoader::load(
+    const std::vector<std::string>& files,
+    const EntryCallback& on_entry,
+    const CorpusOptions& options) {
+    
+    auto start_time = std::chrono::steady_clock::now();
+    
+    CorpusSummary summary;
+    summary.files_total = files.size();
+    summary.files.resize(files.size());
+    
+    std::mutex callback_mutex;
+    
+    parallel::parallel_for(files.size(), options.num_threads, [&](size_t i) {
+        CorpusFileReport& report = summary.files[i];
+        report.path = files[i];
+        
+        auto t0 = std::chrono::steady_clock::now();
+        CorpusEntry entry;
+        entry.path = files[i];
+        
+        try {
+            MappedFile file(files[i]);
+            report.bytes = file.size();
+            
+            if (options.keep_match_data) {
+                MatchFileData data = MatchFileParser::parse_string(file.view());
+                std::tie(entry.score_notes, entry.performance_notes) = MatchFileParser::to_note_arrays(data);
+                entry.alignment = MatchFileParser::to_alignment(data);
+                report.skipped_lines = data.skipped_lines;
+                report.first_skipped_line = data.first_skipped_line;
+                entry.data = std::move(data);
+            } else {
+                MatchNotes notes = MatchFileParser::load_notes_string(file.view());
+                entry.score_notes = std::move(notes.score_notes);
+                entry.performance_notes = std::move(notes.performance_notes);
+                entry.alignment = std::move(notes.alignment);
+                report.skipped_lines = notes.skipped_lines;
+                report.first_skipped_line = std::move(notes.first_skipped_line);
+            }
+            
+            report.ok = true;
+            report.num_score_notes = entry.score_notes.size();
+            report.num_performance_notes = entry.performance_notes.size();
+        } catch (const std::exception& e) {
+            report.error = e.what();
+        }
+        
+        report.parse_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        
+        if (report.ok && on_entry) {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            on_entry(std::move(entry));
+        }
+    });
+    
+    for (const auto& report : summary.files) {
+        if (report.ok) {
+            summary.files_loaded++;
+        } else {
+            summary.files_failed++;
+        }
+        summary.bytes_total += report.bytes;
+        summary.parse_sec_total += report.parse_sec;
+    }
+    
+    summary.wall_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return summary;
+}
+
+CorpusSummary CorpusLoader::load_directory(
+    const std::string& directory,
+    const EntryCallback& on_entry,
+    const CorpusOptions& options) {
+    
+    return load(list_files(directory, options), on_entry, options);
+}
+
+} // namespace parangonar
@@ -4,6 +4,12 @@
 
 namespace parangonar {
 
+DynamicTimeWarping::DynamicTimeWarping(DistanceFunction dist_fn) : distance_fn(std::move(dist_fn)) {
+    using DistancePointer = double (*)(const std::vector<float>&, const std::vector<float>&);
+    auto target = distance_fn.target<DistancePointer>();
+    euclidean_ = target && *target == &metrics::euclidean_distance<float>;
+}
+
 DynamicTimeWarping::DTWResult DynamicTimeWarping::compute(
     const std::vector<std::vector<float>>& X,
     const std::vector<std::vector<float>>& Y,
@@ -30,6 +36,93 @@ DynamicTimeWarping::DTWResult DynamicTimeWarping::compute(
     return result;
 }
 
+void DynamicTimeWarping::compute_path(const float* X, size_t x_rows, size_t x_cols,
+                                      const float* Y, size_t y_rows, size_t y_cols,
+                                      Buffers& buffers, DTWPath& path) const {
+    path.clear();
+    if (x_rows == 0 || y_rows == 0) {
+        return;
+    }
+    
+    const size_t M = x_rows;
+    const size_t N = y_rows;
+    const size_t stride = N + 1;
+    
+    auto& cost = buffers.cost;
+    cost.assign((M + 1) * stride, std::numeric_limits<double>::infinity());
+    cost[0] = 0.0;
+    
+    if (!euclidean_) {
+        buffers.row_x.resize(x_cols);
+        buffers.row_y.resize(y_cols);
+    }
+    
+    for (size_t i = 1; i <= M; ++i) {
+        const float* x = X + (i - 1) * x_cols;
+        if (!euclidean_) {
+            std::copy(x, x + x_cols, buffers.row_x.begin());
+        }
+        
+        for (size_t j = 1; j <= N; ++j) {
+            const float* y = Y + (j - 1) * y_cols;
+            double distance;
+            if (euclidean_) {
+                // Same arithmetic as metrics::euclidean_distance
+                if (x_cols != y_cols) {
+                    distance = std::numeric_limits<double>::infinity();
+                } else {
+                    double sum = 0.0;
+                    for (size_t k = 0; k < x_cols; ++k) {
+                        double diff = static_cast<double>(x[k]) - static_cast<double>(y[k]);
+                        sum += diff * diff;
+                    }
+                    distance = std::sqrt(sum);
+                }
+            } else {
+                std::copy(y, y + y_cols, buffers.row_y.begin());
+                distance = distance_fn(buffers.row_x, buffers.row_y);
+            }
+            
+            double insertion = cost[(i - 1) * stride + j];
+            double deletion = cost[i * stride + j - 1];
+            double match = cost[(i - 1) * stride + j - 1];
+            cost[i * stride + j] = distance + std::min({insertion, deletion, match});
+        }
+    }
+    
+    // Backtrack as in backtrack_path; unpadded (i, j) is cost[i + 1][j + 1]
+    auto at = [&cost, stride](int i, int j) { return cost[(i + 1) * stride + (j + 1)]; };
+    int i = static_cast<int>(M) - 1;
+    int j = static_cast<int>(N) - 1;
+    
+    path.emplace_back(i, j);
+    
+    while (i > 0 || j > 0) {
+        if (i == 0) {
+            j -= 1;
+        } else if (j == 0) {
+            i -= 1;
+        } else {
+            double match = at(i - 1, j - 1);
+            double insertion = at(i - 1, j);
+            double deletion = at(i, j - 1);
+            
+            if (match <= insertion && match <= deletion) {
+                i -= 1;
+                j -= 1;
+            } else if (insertion <= deletion) {
+                i -= 1;
+            } else {
+                j -= 1;
+            }
+        }
+        
+        path.emplace_back(i, j);
+    }
+    
+    std::reverse(path.begin(), path.end());
+}
+
 Matrix2D<double> DynamicTimeWarping::compute_pairwise_distances(
     const std::vector<std::vector<float>>& X,
     const std::vector<std::vector<float>>& Y) const {
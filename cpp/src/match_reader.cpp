@@ -0,0 +1,264 @@
+#include <parangonar/match_reader.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace parangonar {
+
+namespace {
+
+// Strip surrounding brackets from an info value like "[C Maj/A min]"
+std::string_view bracket_content(std::string_view value) {
+    auto pos = value.find('[');
+    auto end_pos = value.find(']');
+    if (pos != std::string_view::npos && end_pos != std::string_view::npos && end_pos > pos) {
+        return value.substr(pos + 1, end_pos - pos - 1);
+    }
+    return {};
+}
+
+// Ticks to seconds, as in MatchFileParser::to_note_arrays
+float ticks_to_seconds(int ticks, const MatchFileInfo& info) {
+    float mpq = info.midi_clock_rate;   // microseconds per quarter
+    float ppq = info.midi_clock_units;  // ticks per quarter
+    return (ticks * mpq / ppq) / 1000000.0f;
+}
+
+int score_pitch(const match_scanner::ScoreNoteView& view) {
+    return match_scanner::midi_pitch(view.note_name, view.accidental, view.octave);
+}
+
+int performance_pitch(const match_scanner::PerformanceNoteView& view) {
+    return match_scanner::midi_pitch(view.note_name, view.accidental, view.octave);
+}
+
+} // namespace
+
+void MatchVisitor::on_error(std::string_view line, const std::exception& error) {
+    std::cerr << "Warning: Failed to parse line: " << line << " - " << error.what() << std::endl;
+}
+
+void apply_match_info(MatchFileInfo& info, std::string_view key, std::string_view value) {
+    if (key == "matchFileVersion") {
+        info.version = match_scanner::parse_float(value);
+    } else if (key == "midiClockUnits") {
+        info.midi_clock_units = match_scanner::parse_int(value);
+    } else if (key == "midiClockRate") {
+        info.midi_clock_rate = match_scanner::parse_int(value);
+    } else if (key == "keySignature") {
+        info.key_signature = bracket_content(value);
+    } else if (key == "timeSignature") {
+        info.time_signature = bracket_content(value);
+    }
+}
+
+void record_skipped_line(size_t& skipped_lines, std::string& first_skipped_line,
+                         std::string_view line, const std::exception& error) {
+    if (skipped_lines++ == 0) {
+        first_skipped_line = std::string(line) + " - " + error.what();
+    }
+}
+
+// MatchStreamReader implementation
+MatchStreamReader::MatchStreamReader(size_t buffer_size)
+    : buffer_(std::max<size_t>(buffer_size, 1)) {}
+
+void MatchStreamReader::read_file(const std::string& filename, MatchVisitor& visitor) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+    read_stream(in, visitor);
+}
+
+void MatchStreamReader::read_stream(std::istream& in, MatchVisitor& visitor) {
+    size_t carried = 0;  // Partial line kept from the previous read
+    
+    while (true) {
+        if (carried == buffer_.size()) {
+            // A single line longer than the buffer
+            buffer_.resize(buffer_.size() * 2);
+        }
+        
+        in.read(buffer_.data() + carried, static_cast<std::streamsize>(buffer_.size() - carried));
+        size_t received = static_cast<size_t>(in.gcount());
+        std::string_view chunk(buffer_.data(), carried + received);
+        
+        if (received == 0) {
+            // End of input: flush a final line without terminator
+            visit_line(match_scanner::trim_line(chunk), visitor);
+            visitor.on_end();
+            return;
+        }
+        
+        size_t last_newline = chunk.rfind('\n');
+        if (last_newline == std::string_view::npos) {
+            carried = chunk.size();
+            continue;
+        }
+        
+        visit_lines(chunk.substr(0, last_newline + 1), visitor);
+        
+        carried = chunk.size() - last_newline - 1;
+        std::memmove(buffer_.data(), buffer_.data() + last_newline + 1, carried);
+    }
+}
+
+void MatchStreamReader::read_string(std::string_view contents, MatchVisitor& visitor) {
+    visit_lines(contents, visitor);
+    visitor.on_end();
+}
+
+void MatchStreamReader::visit_lines(std::string_view contents, MatchVisitor& visitor) {
+    match_scanner::for_each_line(contents, [&visitor](std::string_view line) {
+        visit_line(line, visitor);
+    });
+}
+
+void MatchStreamReader::visit_line(std::string_view line, MatchVisitor& visitor) {
+    // Skip empty lines
+    if (line.empty()) return;
+    
+    match_scanner::LineView view;
+    try {
+        view = match_scanner::scan_line(line, visitor.needs_score_details());
+    } catch (const std::exception& e) {
+        visitor.on_error(line, e);
+        return;
+    }
+    
+    switch (view.kind) {
+        case match_scanner::LineView::INFO:
+            visitor.on_info(view.info_key, view.info_value);
+            break;
+        case match_scanner::LineView::SUSTAIN:
+            visitor.on_sustain(view.sustain_time, view.sustain_value);
+            break;
+        case match_scanner::LineView::MATCH:
+            visitor.on_match(view.score_note, view.performance_note);
+            break;
+        case match_scanner::LineView::DELETION:
+            visitor.on_deletion(view.score_note);
+            break;
+        case match_scanner::LineView::INSERTION:
+            visitor.on_insertion(view.performance_note);
+            break;
+        default:
+            // Meta lines and other metadata
+            break;
+    }
+}
+
+// NoteArrayBuilder implementation
+void NoteArrayBuilder::on_info(std::string_view key, std::string_view value) {
+    apply_match_info(info, key, value);
+}
+
+void NoteArrayBuilder::on_sustain(int time, int value) {
+    sustain_pedal.emplace_back(time, value);
+}
+
+void NoteArrayBuilder::on_match(const match_scanner::ScoreNoteView& score_note,
+                                const match_scanner::PerformanceNoteView& performance_note) {
+    add_score_note(score_note);
+    add_performance_note(performance_note);
+    alignment.emplace_back(Alignment::Label::MATCH, std::string(score_note.id), std::string(performance_note.id));
+}
+
+void NoteArrayBuilder::on_deletion(const match_scanner::ScoreNoteView& score_note) {
+    add_score_note(score_note);
+    alignment.emplace_back(Alignment::Label::DELETION, std::string(score_note.id), "");
+}
+
+void NoteArrayBuilder::on_insertion(const match_scanner::PerformanceNoteView& performance_note) {
+    add_performance_note(performance_note);
+    alignment.emplace_back(Alignment::Label::INSERTION, "", std::string(performance_note.id));
+}
+
+void NoteArrayBuilder::on_end() {
+    for (auto& note : performance_notes) {
+        note.onset_sec = ticks_to_seconds(note.onset_tick, info);
+        note.duration_sec = ticks_to_seconds(note.duration_tick, info);
+    }
+}
+
+void NoteArrayBuilder::on_error(std::string_view line, const std::exception& error) {
+    MatchVisitor::on_error(line, error);
+    record_skipped_line(skipped_lines, first_skipped_line, line, error);
+}
+
+void NoteArrayBuilder::add_score_note(const match_scanner::ScoreNoteView& view) {
+    Note note;
+    note.id = view.id;
+    note.onset_beat = view.onset_time;
+    note.duration_beat = view.offset_time - view.onset_time;
+    note.pitch = score_pitch(view);
+    score_notes.push_back(std::move(note));
+    
+    if (with_attributes) {
+        std::vector<std::string> attributes;
+        std::string_view list = view.attributes;
+        while (!list.empty()) {
+            auto comma_pos = list.find(',');
+            attributes.emplace_back(list.substr(0, comma_pos));
+            if (comma_pos == std::string_view::npos) break;
+            list.remove_prefix(comma_pos + 1);
+        }
+        score_attributes.push_back(std::move(attributes));
+    }
+}
+
+void NoteArrayBuilder::add_performance_note(const match_scanner::PerformanceNoteView& view) {
+    Note note;
+    note.id = view.id;
+    note.onset_tick = view.onset_tick;
+    note.duration_tick = view.offset_tick - view.onset_tick;
+    note.pitch = performance_pitch(view);
+    note.velocity = view.velocity;
+    performance_notes.push_back(std::move(note));
+}
+
+// NoteTableBuilder implementation
+NoteTableBuilder::NoteTableBuilder()
+    : score_notes(NoteTable::TimeBase::BEAT),
+      performance_notes(NoteTable::TimeBase::SECONDS, score_notes.id_pool) {}
+
+void NoteTableBuilder::on_info(std::string_view key, std::string_view value) {
+    apply_match_info(info, key, value);
+}
+
+void NoteTableBuilder::on_match(const match_scanner::ScoreNoteView& score_note,
+                                const match_scanner::PerformanceNoteView& performance_note) {
+    add_score_note(score_note);
+    add_performance_note(performance_note);
+}
+
+void NoteTableBuilder::on_deletion(const match_scanner::ScoreNoteView& score_note) {
+    add_score_note(score_note);
+}
+
+void NoteTableBuilder::on_insertion(const match_scanner::PerformanceNoteView& performance_note) {
+    add_performance_note(performance_note);
+}
+
+void NoteTableBuilder::on_end() {
+    for (size_t i = 0; i < onset_ticks_.size(); ++i) {
+        performance_notes.onset[i] = ticks_to_seconds(onset_ticks_[i], info);
+        performance_notes.duration[i] = ticks_to_seconds(duration_ticks_[i], info);
+    }
+}
+
+void NoteTableBuilder::add_score_note(const match_scanner::ScoreNoteView& view) {
+    score_notes.push_back(view.onset_time, view.offset_time - view.onset_time,
+                          score_pitch(view), 0, view.id);
+}
+
+void NoteTableBuilder::add_performance_note(const match_scanner::PerformanceNoteView& view) {
+    onset_ticks_.push_back(view.onset_tick);
+    duration_ticks_.push_back(view.offset_tick - view.onset_tick);
+    performance_notes.push_back(0.0f, 0.0f, performance_pitch(view), view.velocity, view.id);
+}
+
+} // namespace parangonar
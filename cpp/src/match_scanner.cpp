@@ -0,0 +1,298 @@
+#include <parangonar/match_scanner.hpp>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace parangonar {
+namespace match_scanner {
+
+namespace {
+
+constexpr size_t MAX_FIELDS = 16;
+
+std::string_view trim_spaces(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+    return text;
+}
+
+bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Split on commas outside of brackets; returns the number of fields
+size_t split_fields(std::string_view content, std::string_view* fields) {
+    size_t count = 0;
+    size_t field_start = 0;
+    int bracket_depth = 0;
+    
+    for (size_t i = 0; i < content.size(); ++i) {
+        char c = content[i];
+        if (c == '[') {
+            bracket_depth++;
+        } else if (c == ']') {
+            bracket_depth--;
+        } else if (c == ',' && bracket_depth == 0) {
+            if (count == MAX_FIELDS) return count;
+            fields[count++] = content.substr(field_start, i - field_start);
+            field_start = i + 1;
+        }
+    }
+    if (field_start < content.size() && count < MAX_FIELDS) {
+        fields[count++] = content.substr(field_start);
+    }
+    return count;
+}
+
+// "[C,n]" -> ("C", "n"); leaves both empty if the format does not match
+void split_note_name(std::string_view field, std::string_view& note_name, std::string_view& accidental) {
+    if (field.size() >= 2 && field.front() == '[' && field.back() == ']') {
+        field = field.substr(1, field.size() - 2);
+        auto comma_pos = field.find(',');
+        if (comma_pos != std::string_view::npos) {
+            note_name = field.substr(0, comma_pos);
+            accidental = field.substr(comma_pos + 1);
+        }
+    }
+}
+
+// Character lookup for note spelling: semitones from C per note letter
+// (-1 if invalid) and the alteration per accidental
+struct PitchTable {
+    int8_t semitone[256];
+    int8_t alteration[256];
+    
+    constexpr PitchTable() : semitone(), alteration() {
+        for (int i = 0; i < 256; ++i) {
+            semitone[i] = -1;
+        }
+        semitone['C'] = 0;
+        semitone['D'] = 2;
+        semitone['E'] = 4;
+        semitone['F'] = 5;
+        semitone['G'] = 7;
+        semitone['A'] = 9;
+        semitone['B'] = 11;
+        alteration['#'] = 1;
+        alteration['b'] = -1;
+    }
+};
+
+constexpr PitchTable PITCH_TABLE;
+
+} // namespace
+
+std::string_view trim_line(std::string_view line) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+        line.remove_suffix(1);
+    }
+    // Remove trailing period if present
+    if (!line.empty() && line.back() == '.') {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+int parse_int(std::string_view text) {
+    text = trim_spaces(text);
+    if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+    
+    int value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("Invalid integer: " + std::string(text));
+    }
+    return value;
+}
+
+float parse_float(std::string_view text) {
+    text = trim_spaces(text);
+    if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+    
+    float value = 0.0f;
+#if defined(__cpp_lib_to_chars)
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("Invalid number: " + std::string(text));
+    }
+#else
+    // Standard libraries without floating point from_chars: strtof on a
+    // small null-terminated copy
+    char buffer[64];
+    if (text.empty() || text.size() >= sizeof(buffer)) {
+        throw std::runtime_error("Invalid number: " + std::string(text));
+    }
+    std::memcpy(buffer, text.data(), text.size());
+    buffer[text.size()] = '\0';
+    char* end = nullptr;
+    value = std::strtof(buffer, &end);
+    if (end == buffer) {
+        throw std::runtime_error("Invalid number: " + std::string(text));
+    }
+#endif
+    return value;
+}
+
+float parse_fraction(std::string_view text) {
+    auto slash_pos = text.find('/');
+    if (slash_pos == std::string_view::npos) {
+        return parse_float(text);
+    }
+    
+    float numerator = parse_float(text.substr(0, slash_pos));
+    float denominator = parse_float(text.substr(slash_pos + 1));
+    
+    return numerator / denominator;
+}
+
+ScoreNoteView parse_score_note_args(std::string_view args, bool details) {
+    std::string_view parts[MAX_FIELDS];
+    size_t num_parts = split_fields(args, parts);
+    
+    if (num_parts < 8) {
+        throw std::runtime_error("Invalid snote format, not enough parts: snote(" + std::string(args) + ")");
+    }
+    
+    ScoreNoteView score_note;
+    score_note.id = parts[0];
+    split_note_name(parts[1], score_note.note_name, score_note.accidental);
+    score_note.octave = parse_int(parts[2]);
+    score_note.onset_time = parse_float(parts[6]);
+    score_note.offset_time = parse_float(parts[7]);
+    
+    if (!details) {
+        return score_note;
+    }
+    
+    // Parse measure:beat
+    auto colon_pos = parts[3].find(':');
+    if (colon_pos == std::string_view::npos) {
+        throw std::runtime_error("Invalid measure:beat format: " + std::string(parts[3]));
+    }
+    score_note.measure = parse_int(parts[3].substr(0, colon_pos));
+    score_note.beat = parse_int(parts[3].substr(colon_pos + 1));
+    
+    score_note.offset = parse_fraction(parts[4]);
+    score_note.duration = parse_fraction(parts[5]);
+    
+    // Attribute list without brackets
+    if (num_parts > 8) {
+        std::string_view attributes = parts[8];
+        if (attributes.size() >= 2 && attributes.front() == '[' && attributes.back() == ']') {
+            attributes = attributes.substr(1, attributes.size() - 2);
+        }
+        score_note.attributes = attributes;
+    }
+    
+    return score_note;
+}
+
+PerformanceNoteView parse_performance_note_args(std::string_view args) {
+    std::string_view parts[MAX_FIELDS];
+    size_t num_parts = split_fields(args, parts);
+    
+    if (num_parts < 7) {
+        throw std::runtime_error("Invalid note format, not enough parts: note(" + std::string(args) + ")");
+    }
+    
+    PerformanceNoteView perf_note;
+    perf_note.id = parts[0];
+    split_note_name(parts[1], perf_note.note_name, perf_note.accidental);
+    perf_note.octave = parse_int(parts[2]);
+    perf_note.onset_tick = parse_int(parts[3]);
+    perf_note.offset_tick = parse_int(parts[4]);
+    perf_note.sound_off_tick = parse_int(parts[5]);
+    perf_note.velocity = parse_int(parts[6]);
+    
+    return perf_note;
+}
+
+LineView scan_line(std::string_view line, bool score_details) {
+    static constexpr std::string_view INFO_PREFIX = "info(";
+    static constexpr std::string_view SUSTAIN_PREFIX = "sustain(";
+    static constexpr std::string_view SNOTE_PREFIX = "snote(";
+    static constexpr std::string_view INSERTION_PREFIX = "insertion-note(";
+    static constexpr std::string_view NOTE_SEPARATOR = ")-note(";
+    
+    LineView result;
+    
+    if (starts_with(line, INFO_PREFIX)) {
+        // info(key,value)
+        std::string_view content = line.substr(INFO_PREFIX.size());
+        if (!content.empty() && content.back() == ')') content.remove_suffix(1);
+        auto comma_pos = content.find(',');
+        if (comma_pos != std::string_view::npos) {
+            result.kind = LineView::INFO;
+            result.info_key = content.substr(0, comma_pos);
+            result.info_value = content.substr(comma_pos + 1);
+        }
+    } else if (starts_with(line, SUSTAIN_PREFIX)) {
+        // sustain(time,value)
+        std::string_view content = line.substr(SUSTAIN_PREFIX.size());
+        auto comma_pos = content.find(',');
+        auto end_pos = content.find(')');
+        if (comma_pos != std::string_view::npos && end_pos != std::string_view::npos && comma_pos < end_pos) {
+            result.kind = LineView::SUSTAIN;
+            result.sustain_time = parse_int(content.substr(0, comma_pos));
+            result.sustain_value = parse_int(content.substr(comma_pos + 1, end_pos - comma_pos - 1));
+        }
+    } else if (starts_with(line, INSERTION_PREFIX)) {
+        // insertion-note(...)
+        auto note_end = line.find(')', INSERTION_PREFIX.size());
+        if (note_end != std::string_view::npos) {
+            result.kind = LineView::INSERTION;
+            result.performance_note = parse_performance_note_args(
+                line.substr(INSERTION_PREFIX.size(), note_end - INSERTION_PREFIX.size()));
+        }
+    } else {
+        auto snote_start = line.find(SNOTE_PREFIX);
+        if (snote_start == std::string_view::npos) {
+            return result;
+        }
+        auto args_start = snote_start + SNOTE_PREFIX.size();
+        auto split_pos = line.find(NOTE_SEPARATOR, args_start);
+        
+        if (split_pos != std::string_view::npos) {
+            // snote(...)-note(...)
+            auto note_start = split_pos + NOTE_SEPARATOR.size();
+            auto note_end = line.rfind(')');
+            if (note_end == std::string_view::npos || note_end < note_start) {
+                throw std::runtime_error("Invalid note format: " + std::string(line));
+            }
+            result.kind = LineView::MATCH;
+            result.score_note = parse_score_note_args(line.substr(args_start, split_pos - args_start), score_details);
+            result.performance_note = parse_performance_note_args(line.substr(note_start, note_end - note_start));
+        } else {
+            // snote(...) without a performance note
+            auto snote_end = line.find(')', args_start);
+            if (snote_end == std::string_view::npos) {
+                throw std::runtime_error("Invalid snote format: " + std::string(line));
+            }
+            result.kind = LineView::DELETION;
+            result.score_note = parse_score_note_args(line.substr(args_start, snote_end - args_start), score_details);
+        }
+    }
+    
+    return result;
+}
+
+int midi_pitch(std::string_view note_name, std::string_view accidental, int octave) {
+    int semitone = note_name.size() == 1 ? PITCH_TABLE.semitone[static_cast<unsigned char>(note_name[0])] : -1;
+    if (semitone < 0) {
+        throw std::runtime_error("Unknown note name: " + std::string(note_name));
+    }
+    
+    // "n" means natural, no change needed
+    if (accidental.size() == 1) {
+        semitone += PITCH_TABLE.alteration[static_cast<unsigned char>(accidental[0])];
+    }
+    
+    // C4 = 60
+    return (octave + 1) * 12 + semitone;
+}
+
+} // namespace match_scanner
+} // namespace parangonar
@@ -0,0 +1,337 @@
+#include <parangonar/match_writer.hpp>
+#include <parangonar/match_scanner.hpp>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace parangonar {
+
+namespace {
+
+// Sharp spelling per pitch class
+constexpr const char* NOTE_NAMES[12] = {"C", "C", "D", "D", "E", "F", "F", "G", "G", "A", "A", "B"};
+constexpr const char* ACCIDENTALS[12] = {"n", "#", "n", "#", "n", "n", "#", "n", "#", "n", "#", "n"};
+
+// Numerator and denominator of a time signature like "3/4"; 4/4 if not parsable
+std::pair<int, int> parse_time_signature(std::string_view time_signature) {
+    auto slash_pos = time_signature.find('/');
+    if (slash_pos == std::string_view::npos) {
+        return {4, 4};
+    }
+    try {
+        int numerator = match_scanner::parse_int(time_signature.substr(0, slash_pos));
+        int denominator = match_scanner::parse_int(time_signature.substr(slash_pos + 1));
+        if (numerator <= 0 || denominator <= 0) {
+            return {4, 4};
+        }
+        return {numerator, denominator};
+    } catch (const std::exception&) {
+        return {4, 4};
+    }
+}
+
+// Largest denominator tried when writing a fraction (covers nested tuplets)
+constexpr int MAX_FRACTION_DENOMINATOR = 768;
+
+std::unordered_map<std::string_view, size_t> index_by_id(const NoteArray& notes) {
+    std::unordered_map<std::string_view, size_t> index;
+    index.reserve(notes.size());
+    for (size_t i = 0; i < notes.size(); ++i) {
+        index.emplace(notes[i].id, i);
+    }
+    return index;
+}
+
+size_t find_note(const std::unordered_map<std::string_view, size_t>& index, const std::string& id, const char* kind) {
+    auto it = index.find(id);
+    if (it == index.end()) {
+        throw std::invalid_argument(std::string("Alignment refers to unknown ") + kind + " note: " + id);
+    }
+    return it->second;
+}
+
+} // namespace
+
+MatchFileWriter::MatchFileWriter(size_t flush_size) : flush_size_(flush_size) {
+    buffer_.reserve(flush_size_ + 1024);
+}
+
+void MatchFileWriter::flush(const Sink& sink) {
+    if (!buffer_.empty()) {
+        sink(buffer_);
+        buffer_.clear();
+    }
+}
+
+void MatchFileWriter::append_int(long long value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer_.append(digits, result.ptr);
+}
+
+void MatchFileWriter::append_float(float value) {
+    char digits[32];
+#if defined(__cpp_lib_to_chars)
+    // Shortest representation that parses back to the same float
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer_.append(digits, result.ptr);
+#else
+    int length = std::snprintf(digits, sizeof(digits), "%.9g", value);
+    buffer_.append(digits, static_cast<size_t>(length));
+#endif
+}
+
+// Fraction of a whole note as in the match format ("0", "1/4", "3/16");
+// values without a small denominator are written as floats
+void MatchFileWriter::append_fraction(float value) {
+    for (int denominator = 1; denominator <= MAX_FRACTION_DENOMINATOR; ++denominator) {
+        float scaled = value * denominator;
+        float numerator = std::round(scaled);
+        if (std::abs(scaled - numerator) < 1e-3f) {
+            append_int(static_cast<long long>(numerator));
+            if (denominator > 1 && numerator != 0.0f) {
+                buffer_ += '/';
+                append_int(denominator);
+            }
+            return;
+        }
+    }
+    append_float(value);
+}
+
+void MatchFileWriter::append_spelling(int pitch) {
+    int pitch_class = ((pitch % 12) + 12) % 12;
+    int octave = (pitch - pitch_class) / 12 - 1;
+    buffer_ += '[';
+    append(NOTE_NAMES[pitch_class]);
+    buffer_ += ',';
+    append(ACCIDENTALS[pitch_class]);
+    append("],");
+    append_int(octave);
+}
+
+void MatchFileWriter::append_score_note(const Note& note, const std::vector<std::string>* attributes) {
+    // Position within the bar from the onset in beats
+    float measure_position = std::floor(note.onset_beat / beats_per_measure_);
+    float beat_position = std::floor(note.onset_beat - measure_position * beats_per_measure_);
+    float beat_offset = note.onset_beat - measure_position * beats_per_measure_ - beat_position;
+    
+    append("snote(");
+    append(note.id);
+    buffer_ += ',';
+    append_spelling(note.pitch);
+    buffer_ += ',';
+    append_int(static_cast<long long>(measure_position) + 1);
+    buffer_ += ':';
+    append_int(static_cast<long long>(beat_position) + 1);
+    buffer_ += ',';
+    // Offset and duration in whole notes
+    append_fraction(beat_offset / beat_unit_);
+    buffer_ += ',';
+    append_fraction(note.duration_beat / beat_unit_);
+    buffer_ += ',';
+    append_float(note.onset_beat);
+    buffer_ += ',';
+    append_float(note.onset_beat + note.duration_beat);
+    append(",[");
+    if (attributes) {
+        for (size_t i = 0; i < attributes->size(); ++i) {
+            if (i > 0) buffer_ += ',';
+            append((*attributes)[i]);
+        }
+    }
+    append("])");
+}
+
+void MatchFileWriter::append_performance_note(const Note& note) {
+    int offset_tick = note.onset_tick + note.duration_tick;
+    append(note.id);
+    buffer_ += ',';
+    append_spelling(note.pitch);
+    buffer_ += ',';
+    append_int(note.onset_tick);
+    buffer_ += ',';
+    append_int(offset_tick);
+    buffer_ += ',';
+    append_int(offset_tick);
+    buffer_ += ',';
+    append_int(note.velocity);
+    buffer_ += ')';
+}
+
+void MatchFileWriter::write(const Sink& sink,
+                            const MatchFileInfo& info,
+                            const NoteArray& score_notes,
+                            const NoteArray& performance_notes,
+                            const AlignmentVector& alignment,
+                            const std::vector<std::pair<int, int>>& sustain_pedal,
+                            const std::vector<std::vector<std::string>>* score_attributes) {
+    if (score_attributes && score_attributes->size() != score_notes.size()) {
+        score_attributes = nullptr;
+    }
+    
+    auto score_index = index_by_id(score_notes);
+    auto perf_index = index_by_id(performance_notes);
+    std::tie(beats_per_measure_, beat_unit_) = parse_time_signature(info.time_signature);
+    buffer_.clear();
+    
+    // Header
+    char version[16];
+    int version_length = std::snprintf(version, sizeof(version), "%.1f", info.version);
+    append("info(matchFileVersion,");
+    append(std::string_view(version, static_cast<size_t>(version_length)));
+    append(").\ninfo(midiClockUnits,");
+    append_int(info.midi_clock_units);
+    append(").\ninfo(midiClockRate,");
+    append_int(info.midi_clock_rate);
+    append(").\n");
+    if (!info.key_signature.empty()) {
+        append("info(keySignature,[");
+        append(info.key_signature);
+        append("]).\n");
+    }
+    if (!info.time_signature.empty()) {
+        append("info(timeSignature,[");
+        append(info.time_signature);
+        append("]).\n");
+    }
+    
+    // One line per alignment entry
+    for (const auto& align : alignment) {
+        switch (align.label) {
+            case Alignment::Label::MATCH: {
+                size_t s = find_note(score_index, align.score_id, "score");
+                size_t p = find_note(perf_index, align.performance_id, "performance");
+                append_score_note(score_notes[s], score_attributes ? &(*score_attributes)[s] : nullptr);
+                append("-note(");
+                append_performance_note(performance_notes[p]);
+                break;
+            }
+            case Alignment::Label::DELETION: {
+                size_t s = find_note(score_index, align.score_id, "score");
+                append_score_note(score_notes[s], score_attributes ? &(*score_attributes)[s] : nullptr);
+                append("-deletion");
+                break;
+            }
+            case Alignment::Label::INSERTION: {
+                size_t p = find_note(perf_index, align.performance_id, "performance");
+                append("insertion-note(");
+                append_performance_note(performance_notes[p]);
+                break;
+            }
+        }
+        append(".\n");
+        
+        if (buffer_.size() >= flush_size_) {
+            flush(sink);
+        }
+    }
+    
+    for (const auto& [time, value] : sustain_pedal) {
+        append("sustain(");
+        append_int(time);
+        buffer_ += ',';
+        append_int(value);
+        append(").\n");
+        
+        if (buffer_.size() >= flush_size_) {
+            flush(sink);
+        }
+    }
+    
+    flush(sink);
+}
+
+void MatchFileWriter::write(std::ostream& out,
+                            const MatchFileInfo& info,
+                            const NoteArray& score_notes,
+                            const NoteArray& performance_notes,
+                            const AlignmentVector& alignment,
+                            const std::vector<std::pair<int, int>>& sustain_pedal) {
+    write([&out](std::string_view chunk) {
+        out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    }, info, score_notes, performance_notes, alignment, sustain_pedal);
+    
+    if (!out) {
+        throw std::runtime_error("Failed writing match file");
+    }
+}
+
+void MatchFileWriter::write_fd(int fd,
+                               const MatchFileInfo& info,
+                               const NoteArray& score_notes,
+                               const NoteArray& performance_notes,
+                               const AlignmentVector& alignment,
+                               const std::vector<std::pair<int, int>>& sustain_pedal) {
+    write([fd](std::string_view chunk) {
+        while (!chunk.empty()) {
+#if defined(_WIN32)
+            int written = ::_write(fd, chunk.data(), static_cast<unsigned int>(chunk.size()));
+            if (written < 0) {
+                throw std::runtime_error("Failed writing match file");
+            }
+#else
+            ssize_t written = ::write(fd, chunk.data(), chunk.size());
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Failed writing match file");
+            }
+#endif
+            chunk.remove_prefix(static_cast<size_t>(written));
+        }
+    }, info, score_notes, performance_notes, alignment, sustain_pedal);
+}
+
+void MatchFileWriter::write_file(const std::string& filename,
+                                 const MatchFileInfo& info,
+                                 const NoteArray& score_notes,
+                                 const NoteArray& performance_notes,
+                                 const AlignmentVector& alignment,
+                                 const std::vector<std::pair<int, int>>& sustain_pedal) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+    write(out, info, score_notes, performance_notes, alignment, sustain_pedal);
+}
+
+void MatchFileWriter::write_file(const std::string& filename, const MatchNotes& notes) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+    write([&out](std::string_view chunk) {
+        out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    }, notes.info, notes.score_notes, notes.performance_notes, notes.alignment,
+       notes.sustain_pedal, notes.score_attributes.empty() ? nullptr : &notes.score_attributes);
+    
+    if (!out) {
+        throw std::runtime_error("Failed writing match file: " + filename);
+    }
+}
+
+std::string MatchFileWriter::to_string(const MatchFileInfo& info,
+                                       const NoteArray& score_notes,
+                                       const NoteArray& performance_notes,
+                                       const AlignmentVector& alignment,
+                                       const std::vector<std::pair<int, int>>& sustain_pedal) {
+    std::string result;
+    write([&result](std::string_view chunk) {
+        result.append(chunk.data(), chunk.size());
+    }, info, score_notes, performance_notes, alignment, sustain_pedal);
+    return result;
+}
+
+} // namespace parangonar
@@ -1,509 +1,1873 @@
 #include <parangonar/matchers.hpp>
+#include <parangonar/parallel.hpp>
+#include <parangonar/trace.hpp>
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
 #include <set>
 #include <random>
 #include <cmath>
 #include <iostream>
 #include <chrono>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace parangonar {
 
-// SimplestGreedyMatcher implementation
-AlignmentVector SimplestGreedyMatcher::operator()(
-    const NoteArray& score_notes, 
-    const NoteArray& performance_notes) {
+namespace {
+
+// Alignment between note indices; NO_INDEX marks the missing side
+struct IndexAlignment {
+    Alignment::Label label;
+    size_t score_index;
+    size_t performance_index;
+};
+
+constexpr size_t NO_INDEX = std::numeric_limits<size_t>::max();
+
+// Resolve index alignments to note ids
+template<typename ScoreIdFn, typename PerfIdFn>
+AlignmentVector to_alignment_vector(
+    const std::vector<IndexAlignment>& index_alignment,
+    ScoreIdFn score_id,
+    PerfIdFn performance_id) {
     
     AlignmentVector alignment;
-    std::set<std::string> performance_aligned;
-    std::set<std::string> score_aligned;
+    alignment.reserve(index_alignment.size());
+    for (const auto& align : index_alignment) {
+        switch (align.label) {
+            case Alignment::Label::MATCH:
+                alignment.emplace_back(Alignment::Label::MATCH, score_id(align.score_index),
+                                       performance_id(align.performance_index));
+                break;
+            case Alignment::Label::DELETION:
+                alignment.emplace_back(Alignment::Label::DELETION, score_id(align.score_index));
+                break;
+            case Alignment::Label::INSERTION:
+                alignment.emplace_back(Alignment::Label::INSERTION, "", performance_id(align.performance_index));
+                break;
+        }
+    }
+    return alignment;
+}
+
+// Reusable buffers of the matching kernels below
+struct MatchScratch {
+    // Greedy matching
+    std::vector<size_t> bucket_start, bucket_head, bucketed_indices;
+    std::vector<char> performance_aligned;
+    
+    // Sequence matching
+    note_array::PitchPartition score_partition, perf_partition;
+    std::vector<float> partitioned_score_onsets, score_onsets_converted;
+    std::vector<float> sorted_score_onsets, sorted_perf_onsets;
+    std::vector<char> omit_mask;
+    
+    // Combination search; the result is best_score and best_omit_indices
+    std::vector<char> combination_mask;
+    std::vector<size_t> drawn;
+    double best_score = 0.0;
+    std::vector<size_t> best_omit_indices;
+    uint64_t combinations_evaluated = 0;  // Running count, reset by the caller
+};
+
+// Greedy pitch matching through per-pitch FIFO queues of performance indices;
+// appends to alignment
+void greedy_match_indices(
+    const std::vector<int>& score_pitches,
+    const std::vector<int>& perf_pitches,
+    MatchScratch& scratch,
+    std::vector<IndexAlignment>& alignment) {
+    
+    // Bucket performance indices by pitch (counting sort, array order kept),
+    // so each bucket acts as a FIFO queue of candidates for that pitch
+    int min_pitch = std::numeric_limits<int>::max();
+    int max_pitch = std::numeric_limits<int>::min();
+    for (int pitch : perf_pitches) {
+        min_pitch = std::min(min_pitch, pitch);
+        max_pitch = std::max(max_pitch, pitch);
+    }
+    
+    const size_t num_pitches = perf_pitches.empty() ? 0 : note_array::pitch_range(min_pitch, max_pitch);
+    auto& bucket_start = scratch.bucket_start;
+    bucket_start.assign(num_pitches + 1, 0);
+    for (int pitch : perf_pitches) {
+        bucket_start[pitch - min_pitch + 1]++;
+    }
+    for (size_t p = 0; p < num_pitches; ++p) {
+        bucket_start[p + 1] += bucket_start[p];
+    }
+    
+    auto& bucket_head = scratch.bucket_head;
+    auto& bucketed_indices = scratch.bucketed_indices;
+    bucket_head.assign(bucket_start.begin(), bucket_start.end());
+    bucketed_indices.resize(perf_pitches.size());
+    for (size_t i = 0; i < perf_pitches.size(); ++i) {
+        bucketed_indices[bucket_head[perf_pitches[i] - min_pitch]++] = i;
+    }
+    bucket_head.assign(bucket_start.begin(), bucket_start.end());  // Rewind queue heads for matching
     
-    for (const auto& score_note : score_notes) {
-        std::string performance_id;
+    auto& performance_aligned = scratch.performance_aligned;
+    performance_aligned.assign(perf_pitches.size(), 0);
+    
+    for (size_t score_idx = 0; score_idx < score_pitches.size(); ++score_idx) {
+        const int pitch = score_pitches[score_idx];
         bool found_match = false;
         
-        // Find matching pitches
-        for (const auto& perf_note : performance_notes) {
-            if (score_note.pitch == perf_note.pitch &&
-                performance_aligned.find(perf_note.id) == performance_aligned.end()) {
-                performance_id = perf_note.id;
-                performance_aligned.insert(perf_note.id);
-                score_aligned.insert(score_note.id);
+        // Pop the first unaligned performance note of the same pitch
+        if (num_pitches > 0 && pitch >= min_pitch && pitch <= max_pitch) {
+            size_t p = static_cast<size_t>(pitch - min_pitch);
+            if (bucket_head[p] < bucket_start[p + 1]) {
+                size_t perf_idx = bucketed_indices[bucket_head[p]++];
+                performance_aligned[perf_idx] = 1;
+                alignment.push_back({Alignment::Label::MATCH, score_idx, perf_idx});
                 found_match = true;
-                break;
             }
         }
         
-        if (found_match) {
-            alignment.emplace_back(Alignment::Label::MATCH, score_note.id, performance_id);
-        } else {
-            alignment.emplace_back(Alignment::Label::DELETION, score_note.id);
+        if (!found_match) {
+            alignment.push_back({Alignment::Label::DELETION, score_idx, NO_INDEX});
         }
     }
     
     // Add unaligned performance notes as insertions
-    for (const auto& perf_note : performance_notes) {
-        if (performance_aligned.find(perf_note.id) == performance_aligned.end()) {
-            alignment.emplace_back(Alignment::Label::INSERTION, "", perf_note.id);
+    for (size_t i = 0; i < perf_pitches.size(); ++i) {
+        if (!performance_aligned[i]) {
+            alignment.push_back({Alignment::Label::INSERTION, NO_INDEX, i});
         }
     }
+}
+
+std::vector<IndexAlignment> greedy_match_indices(
+    const std::vector<int>& score_pitches,
+    const std::vector<int>& perf_pitches) {
     
+    MatchScratch scratch;
+    std::vector<IndexAlignment> alignment;
+    alignment.reserve(score_pitches.size() + perf_pitches.size());
+    greedy_match_indices(score_pitches, perf_pitches, scratch, alignment);
     return alignment;
 }
 
-// SequenceAugmentedGreedyMatcher implementation
-SequenceAugmentedGreedyMatcher::CombinationResult SequenceAugmentedGreedyMatcher::find_best_combination(
+// Squared error between long_times (skipping omitted entries) and short_times
+double omission_score(
+    const std::vector<float>& long_times,
+    const std::vector<float>& short_times,
+    const std::vector<char>& omit_mask,
+    bool shift) {
+    
+    const size_t n_long = long_times.size();
+    double optimal_shift = 0.0;
+    
+    if (shift && !short_times.empty()) {
+        // Calculate optimal shift
+        double sum_diff = 0.0;
+        for (size_t i = 0, k = 0; i < n_long; ++i) {
+            if (omit_mask[i]) continue;
+            sum_diff += long_times[i] - short_times[k++];
+        }
+        optimal_shift = sum_diff / short_times.size();
+    }
+    
+    double score = 0.0;
+    for (size_t i = 0, k = 0; i < n_long; ++i) {
+        if (omit_mask[i]) continue;
+        double diff = long_times[i] - short_times[k++] - optimal_shift;
+        score += diff * diff;
+    }
+    return score;
+}
+
+// SequenceAugmentedGreedyMatcher::find_best_combination into scratch.best_*
+void find_best_combination(
     const std::vector<float>& long_times,
     const std::vector<float>& short_times,
     bool shift,
-    int cap_combinations) {
+    int cap_combinations,
+    std::mt19937& gen,
+    MatchScratch& scratch) {
     
     const size_t n_long = long_times.size();
     const size_t n_short = short_times.size();
     const size_t extra_notes = n_long - n_short;
     
+    scratch.best_omit_indices.clear();
+    
     if (extra_notes == 0) {
-        return {0.0, {}};
+        scratch.best_score = 0.0;
+        return;
     }
     
-    CombinationResult best_result;
-    best_result.score = std::numeric_limits<double>::infinity();
+    scratch.best_score = std::numeric_limits<double>::infinity();
     
-    // Generate combinations to try
-    std::vector<std::vector<size_t>> combinations;
+    if (cap_combinations <= 0) {
+        return;
+    }
     
-    if (cap_combinations > 0) {
-        // Calculate total number of combinations
-        double total_combinations = 1.0;
-        for (size_t i = 0; i < extra_notes; ++i) {
-            total_combinations *= static_cast<double>(n_long - i) / static_cast<double>(i + 1);
-        }
-        
-        if (total_combinations > cap_combinations) {
-            // Random sampling
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            
-            for (int i = 0; i < cap_combinations; ++i) {
-                std::vector<size_t> combination;
-                std::vector<size_t> available_indices(n_long);
-                std::iota(available_indices.begin(), available_indices.end(), 0);
-                
-                for (size_t j = 0; j < extra_notes; ++j) {
-                    std::uniform_int_distribution<size_t> dist(0, available_indices.size() - 1);
-                    size_t chosen_idx = dist(gen);
-                    combination.push_back(available_indices[chosen_idx]);
-                    available_indices.erase(available_indices.begin() + chosen_idx);
-                }
-                
-                combinations.push_back(combination);
-            }
-        } else {
-            // Generate all combinations
-            std::vector<bool> selector(n_long, false);
-            std::fill(selector.end() - extra_notes, selector.end(), true);
-            
-            do {
-                std::vector<size_t> combination;
-                for (size_t i = 0; i < n_long; ++i) {
-                    if (selector[i]) {
-                        combination.push_back(i);
-                    }
-                }
-                combinations.push_back(combination);
-            } while (std::next_permutation(selector.begin(), selector.end()));
-        }
+    // Calculate total number of combinations
+    double total_combinations = 1.0;
+    for (size_t i = 0; i < extra_notes; ++i) {
+        total_combinations *= static_cast<double>(n_long - i) / static_cast<double>(i + 1);
     }
     
-    // Evaluate each combination
-    for (const auto& omit_indices : combinations) {
-        std::vector<float> shortened_times;
-        
-        // Create shortened version by omitting specified indices
-        std::set<size_t> omit_set(omit_indices.begin(), omit_indices.end());
-        for (size_t i = 0; i < n_long; ++i) {
-            if (omit_set.find(i) == omit_set.end()) {
-                shortened_times.push_back(long_times[i]);
-            }
-        }
-        
-        // Calculate score
-        double score = 0.0;
+    // Candidates are scored as they are drawn; only the current omission
+    // mask and the best omission indices are kept around.
+    auto& omit_mask = scratch.combination_mask;
+    omit_mask.assign(n_long, 0);
+    
+    if (total_combinations > cap_combinations) {
+        // Random sampling with Floyd's algorithm: O(k) per draw, no index pool
+        auto& drawn = scratch.drawn;
         
-        if (shift && shortened_times.size() == short_times.size()) {
-            // Calculate optimal shift
-            double sum_diff = 0.0;
-            for (size_t i = 0; i < shortened_times.size(); ++i) {
-                sum_diff += shortened_times[i] - short_times[i];
+        for (int i = 0; i < cap_combinations; ++i) {
+            drawn.clear();
+            for (size_t j = n_long - extra_notes; j < n_long; ++j) {
+                std::uniform_int_distribution<size_t> dist(0, j);
+                size_t chosen_idx = dist(gen);
+                if (omit_mask[chosen_idx]) {
+                    chosen_idx = j;
+                }
+                omit_mask[chosen_idx] = 1;
+                drawn.push_back(chosen_idx);
             }
-            double optimal_shift = sum_diff / shortened_times.size();
             
-            // Calculate squared error with optimal shift
-            for (size_t i = 0; i < shortened_times.size(); ++i) {
-                double diff = shortened_times[i] - short_times[i] - optimal_shift;
-                score += diff * diff;
+            double score = omission_score(long_times, short_times, omit_mask, shift);
+            scratch.combinations_evaluated++;
+            if (score < scratch.best_score) {
+                scratch.best_score = score;
+                scratch.best_omit_indices.assign(drawn.begin(), drawn.end());
             }
-        } else {
-            // Calculate squared error without shift
-            for (size_t i = 0; i < std::min(shortened_times.size(), short_times.size()); ++i) {
-                double diff = shortened_times[i] - short_times[i];
-                score += diff * diff;
+            
+            for (size_t idx : drawn) {
+                omit_mask[idx] = 0;
             }
         }
+    } else {
+        // Enumerate all combinations in place
+        std::fill(omit_mask.end() - extra_notes, omit_mask.end(), 1);
         
-        if (score < best_result.score) {
-            best_result.score = score;
-            best_result.omit_indices = omit_indices;
-        }
+        do {
+            double score = omission_score(long_times, short_times, omit_mask, shift);
+            scratch.combinations_evaluated++;
+            if (score < scratch.best_score) {
+                scratch.best_score = score;
+                scratch.best_omit_indices.clear();
+                for (size_t i = 0; i < n_long; ++i) {
+                    if (omit_mask[i]) {
+                        scratch.best_omit_indices.push_back(i);
+                    }
+                }
+            }
+        } while (std::next_permutation(omit_mask.begin(), omit_mask.end()));
     }
+}
+
+} // namespace
+
+// SimplestGreedyMatcher implementation
+AlignmentVector SimplestGreedyMatcher::operator()(
+    const NoteArray& score_notes, 
+    const NoteArray& performance_notes) const {
     
-    return best_result;
+    auto index_alignment = greedy_match_indices(note_array::pitches(score_notes),
+                                                note_array::pitches(performance_notes));
+    return to_alignment_vector(index_alignment,
+        [&](size_t i) -> const std::string& { return score_notes[i].id; },
+        [&](size_t i) -> const std::string& { return performance_notes[i].id; });
 }
 
-AlignmentVector SequenceAugmentedGreedyMatcher::operator()(
-    const NoteArray& score_notes,
-    const NoteArray& performance_notes,
-    const TimeAlignmentVector& alignment_times,
+AlignmentVector SimplestGreedyMatcher::operator()(
+    const NoteTable& score_notes,
+    const NoteTable& performance_notes) const {
+    
+    auto index_alignment = greedy_match_indices(score_notes.pitch, performance_notes.pitch);
+    return to_alignment_vector(index_alignment,
+        [&](size_t i) -> const std::string& { return score_notes.id_str(i); },
+        [&](size_t i) -> const std::string& { return performance_notes.id_str(i); });
+}
+
+// SequenceAugmentedGreedyMatcher implementation
+SequenceAugmentedGreedyMatcher::CombinationResult SequenceAugmentedGreedyMatcher::find_best_combination(
+    const std::vector<float>& long_times,
+    const std::vector<float>& short_times,
     bool shift,
-    int cap_combinations) {
+    int cap_combinations,
+    std::mt19937& gen) {
     
-    AlignmentVector alignment;
-    std::set<std::string> performance_aligned;
+    MatchScratch scratch;
+    parangonar::find_best_combination(long_times, short_times, shift, cap_combinations, gen, scratch);
+    return {scratch.best_score, std::move(scratch.best_omit_indices)};
+}
+
+namespace {
+
+// Pitch-wise sequence matching on columns; appends index alignments
+void sequence_match_indices(
+    const std::vector<float>& score_onsets,
+    const std::vector<int>& score_pitches,
+    const std::vector<float>& perf_onsets,
+    const std::vector<int>& perf_pitches,
+    const preprocessors::LinearInterpolator& interpolator,
+    bool shift,
+    int cap_combinations,
+    std::mt19937& gen,
+    MatchScratch& scratch,
+    std::vector<IndexAlignment>& alignment) {
     
-    // Create time interpolator
-    std::vector<float> score_times, perf_times;
-    for (const auto& align : alignment_times) {
-        score_times.push_back(align.score_time);
-        perf_times.push_back(align.performance_time);
-    }
+    // Bucket both sides by pitch once, each bucket sorted by onset
+    auto& score_partition = scratch.score_partition;
+    auto& perf_partition = scratch.perf_partition;
+    note_array::partition_by_pitch(score_pitches, score_onsets, score_partition);
+    note_array::partition_by_pitch(perf_pitches, perf_onsets, perf_partition);
     
-    if (score_times.size() < 2) {
-        // Fall back to simple greedy matching
-        SimplestGreedyMatcher simple_matcher;
-        return simple_matcher(score_notes, performance_notes);
+    // Convert all score onsets to the performance time domain in one batch,
+    // laid out in partition order
+    auto& partitioned_score_onsets = scratch.partitioned_score_onsets;
+    partitioned_score_onsets.clear();
+    for (size_t idx : score_partition.indices) {
+        partitioned_score_onsets.push_back(score_onsets[idx]);
     }
+    auto& score_onsets_converted = scratch.score_onsets_converted;
+    interpolator.interpolate(partitioned_score_onsets, score_onsets_converted);
     
-    preprocessors::LinearInterpolator interpolator(score_times, perf_times);
-    
-    // Get unique pitches from score
-    auto unique_pitches = note_array::unique_pitches(score_notes);
+    auto& performance_aligned = scratch.performance_aligned;
+    performance_aligned.assign(perf_pitches.size(), 0);
+    auto& sorted_score_onsets = scratch.sorted_score_onsets;
+    auto& sorted_perf_onsets = scratch.sorted_perf_onsets;
+    auto& omit_mask = scratch.omit_mask;
+    size_t perf_group = 0;
     
-    for (int pitch : unique_pitches) {
-        auto score_pitch_notes = note_array::filter_by_pitch(score_notes, pitch);
-        auto perf_pitch_notes = note_array::filter_by_pitch(performance_notes, pitch);
+    for (size_t score_group = 0; score_group < score_partition.pitches.size(); ++score_group) {
+        const int pitch = score_partition.pitches[score_group];
+        while (perf_group < perf_partition.pitches.size() && perf_partition.pitches[perf_group] < pitch) {
+            ++perf_group;
+        }
         
-        if (score_pitch_notes.empty() || perf_pitch_notes.empty()) {
-            // Handle empty cases
-            for (const auto& note : score_pitch_notes) {
-                alignment.emplace_back(Alignment::Label::DELETION, note.id);
-            }
-            for (const auto& note : perf_pitch_notes) {
-                alignment.emplace_back(Alignment::Label::INSERTION, "", note.id);
-                performance_aligned.insert(note.id);
+        const size_t score_begin = score_partition.offsets[score_group];
+        const size_t score_count = score_partition.offsets[score_group + 1] - score_begin;
+        const size_t* score_indices = score_partition.indices.data() + score_begin;
+        
+        if (perf_group == perf_partition.pitches.size() || perf_partition.pitches[perf_group] != pitch) {
+            // No performance notes of this pitch
+            for (size_t i = 0; i < score_count; ++i) {
+                alignment.push_back({Alignment::Label::DELETION, score_indices[i], NO_INDEX});
             }
             continue;
         }
         
-        // Get onset times and sort
-        std::vector<float> score_onsets = note_array::onset_times_beat(score_pitch_notes);
-        std::vector<float> perf_onsets = note_array::onset_times_sec(perf_pitch_notes);
-        
-        // Convert score onsets to performance time domain
-        auto score_onsets_converted = interpolator.interpolate(score_onsets);
-        
-        // Sort by onset times
-        std::vector<size_t> score_indices(score_onsets.size());
-        std::iota(score_indices.begin(), score_indices.end(), 0);
-        std::sort(score_indices.begin(), score_indices.end(),
-                  [&score_onsets_converted](size_t i, size_t j) {
-                      return score_onsets_converted[i] < score_onsets_converted[j];
-                  });
-        
-        std::vector<size_t> perf_indices(perf_onsets.size());
-        std::iota(perf_indices.begin(), perf_indices.end(), 0);
-        std::sort(perf_indices.begin(), perf_indices.end(),
-                  [&perf_onsets](size_t i, size_t j) {
-                      return perf_onsets[i] < perf_onsets[j];
-                  });
+        const size_t perf_begin = perf_partition.offsets[perf_group];
+        const size_t perf_count = perf_partition.offsets[perf_group + 1] - perf_begin;
+        const size_t* perf_indices = perf_partition.indices.data() + perf_begin;
         
-        // Create sorted onset vectors
-        std::vector<float> sorted_score_onsets, sorted_perf_onsets;
-        for (size_t idx : score_indices) {
-            sorted_score_onsets.push_back(score_onsets_converted[idx]);
+        // Sorted onset vectors for this pitch
+        sorted_score_onsets.assign(score_onsets_converted.begin() + score_begin,
+                                   score_onsets_converted.begin() + score_begin + score_count);
+        sorted_perf_onsets.clear();
+        for (size_t i = 0; i < perf_count; ++i) {
+            sorted_perf_onsets.push_back(perf_onsets[perf_indices[i]]);
         }
-        for (size_t idx : perf_indices) {
-            sorted_perf_onsets.push_back(perf_onsets[idx]);
-        }
-        
-        const size_t score_count = sorted_score_onsets.size();
-        const size_t perf_count = sorted_perf_onsets.size();
-        const size_t common_count = std::min(score_count, perf_count);
         
         if (score_count == perf_count) {
             // Equal number of notes - align all
-            for (size_t i = 0; i < common_count; ++i) {
-                const auto& score_note = score_pitch_notes[score_indices[i]];
-                const auto& perf_note = perf_pitch_notes[perf_indices[i]];
-                alignment.emplace_back(Alignment::Label::MATCH, score_note.id, perf_note.id);
-                performance_aligned.insert(perf_note.id);
+            for (size_t i = 0; i < score_count; ++i) {
+                alignment.push_back({Alignment::Label::MATCH, score_indices[i], perf_indices[i]});
+                performance_aligned[perf_indices[i]] = 1;
             }
         } else {
             // Different number of notes - find best combination
             bool score_longer = score_count > perf_count;
             
-            auto best_combination = find_best_combination(
+            find_best_combination(
                 score_longer ? sorted_score_onsets : sorted_perf_onsets,
                 score_longer ? sorted_perf_onsets : sorted_score_onsets,
                 shift,
-                cap_combinations
+                cap_combinations,
+                gen,
+                scratch
             );
             
-            std::set<size_t> omit_set(best_combination.omit_indices.begin(),
-                                     best_combination.omit_indices.end());
+            omit_mask.assign(std::max(score_count, perf_count), 0);
+            for (size_t idx : scratch.best_omit_indices) {
+                omit_mask[idx] = 1;
+            }
             
             if (score_longer) {
                 // Score has more notes
                 size_t perf_idx = 0;
                 for (size_t score_idx = 0; score_idx < score_count; ++score_idx) {
-                    const auto& score_note = score_pitch_notes[score_indices[score_idx]];
-                    
-                    if (omit_set.find(score_idx) == omit_set.end() && perf_idx < perf_count) {
+                    if (!omit_mask[score_idx] && perf_idx < perf_count) {
                         // Align this score note
-                        const auto& perf_note = perf_pitch_notes[perf_indices[perf_idx]];
-                        alignment.emplace_back(Alignment::Label::MATCH, score_note.id, perf_note.id);
-                        performance_aligned.insert(perf_note.id);
+                        alignment.push_back({Alignment::Label::MATCH, score_indices[score_idx], perf_indices[perf_idx]});
+                        performance_aligned[perf_indices[perf_idx]] = 1;
                         perf_idx++;
                     } else {
                         // Delete this score note
-                        alignment.emplace_back(Alignment::Label::DELETION, score_note.id);
+                        alignment.push_back({Alignment::Label::DELETION, score_indices[score_idx], NO_INDEX});
                     }
                 }
             } else {
                 // Performance has more notes
                 size_t score_idx = 0;
                 for (size_t perf_idx = 0; perf_idx < perf_count; ++perf_idx) {
-                    const auto& perf_note = perf_pitch_notes[perf_indices[perf_idx]];
-                    
-                    if (omit_set.find(perf_idx) == omit_set.end() && score_idx < score_count) {
+                    if (!omit_mask[perf_idx] && score_idx < score_count) {
                         // Align this performance note
-                        const auto& score_note = score_pitch_notes[score_indices[score_idx]];
-                        alignment.emplace_back(Alignment::Label::MATCH, score_note.id, perf_note.id);
-                        performance_aligned.insert(perf_note.id);
+                        alignment.push_back({Alignment::Label::MATCH, score_indices[score_idx], perf_indices[perf_idx]});
                         score_idx++;
                     } else {
                         // Insert this performance note
-                        alignment.emplace_back(Alignment::Label::INSERTION, "", perf_note.id);
-                        performance_aligned.insert(perf_note.id);
+                        alignment.push_back({Alignment::Label::INSERTION, NO_INDEX, perf_indices[perf_idx]});
                     }
+                    performance_aligned[perf_indices[perf_idx]] = 1;
                 }
             }
         }
     }
     
     // Add any unaligned performance notes as insertions
-    for (const auto& perf_note : performance_notes) {
-        if (performance_aligned.find(perf_note.id) == performance_aligned.end()) {
-            alignment.emplace_back(Alignment::Label::INSERTION, "", perf_note.id);
+    for (size_t i = 0; i < perf_pitches.size(); ++i) {
+        if (!performance_aligned[i]) {
+            alignment.push_back({Alignment::Label::INSERTION, NO_INDEX, i});
         }
     }
+}
+
+std::vector<IndexAlignment> sequence_match_indices(
+    const std::vector<float>& score_onsets,
+    const std::vector<int>& score_pitches,
+    const std::vector<float>& perf_onsets,
+    const std::vector<int>& perf_pitches,
+    const preprocessors::LinearInterpolator& interpolator,
+    bool shift,
+    int cap_combinations,
+    std::mt19937& gen) {
     
+    MatchScratch scratch;
+    std::vector<IndexAlignment> alignment;
+    alignment.reserve(score_pitches.size() + perf_pitches.size());
+    sequence_match_indices(score_onsets, score_pitches, perf_onsets, perf_pitches, interpolator,
+                           shift, cap_combinations, gen, scratch, alignment);
     return alignment;
 }
 
-// AutomaticNoteMatcher implementation
-AutomaticNoteMatcher::AutomaticNoteMatcher() {
-    initialize_matchers();
+// Score -> performance time interpolator; empty if there are too few points
+std::optional<preprocessors::LinearInterpolator> make_interpolator(
+    const TimeAlignmentVector& alignment_times) {
+    
+    std::vector<float> score_times, perf_times;
+    for (const auto& align : alignment_times) {
+        score_times.push_back(align.score_time);
+        perf_times.push_back(align.performance_time);
+    }
+    
+    if (score_times.size() < 2) {
+        return std::nullopt;
+    }
+    
+    return preprocessors::LinearInterpolator(score_times, perf_times);
 }
 
-AutomaticNoteMatcher::AutomaticNoteMatcher(const Config& config) {
-    update_config(config);
-    initialize_matchers();
-}
+} // namespace
 
-void AutomaticNoteMatcher::initialize_matchers() {
-    note_matcher_ = std::make_unique<DynamicTimeWarping>();
-    symbolic_note_matcher_ = std::make_unique<SequenceAugmentedGreedyMatcher>();
-    greedy_symbolic_note_matcher_ = std::make_unique<SimplestGreedyMatcher>();
+AlignmentVector SequenceAugmentedGreedyMatcher::operator()(
+    const NoteArray& score_notes,
+    const NoteArray& performance_notes,
+    const TimeAlignmentVector& alignment_times,
+    bool shift,
+    int cap_combinations,
+    unsigned int random_seed) const {
+    
+    auto interpolator = make_interpolator(alignment_times);
+    if (!interpolator) {
+        // Fall back to simple greedy matching
+        SimplestGreedyMatcher simple_matcher;
+        return simple_matcher(score_notes, performance_notes);
+    }
+    
+    // Seeded per call so that results do not depend on call history
+    std::mt19937 gen(random_seed);
+    
+    auto index_alignment = sequence_match_indices(
+        note_array::onset_times_beat(score_notes), note_array::pitches(score_notes),
+        note_array::onset_times_sec(performance_notes), note_array::pitches(performance_notes),
+        *interpolator, shift, cap_combinations, gen
+    );
+    return to_alignment_vector(index_alignment,
+        [&](size_t i) -> const std::string& { return score_notes[i].id; },
+        [&](size_t i) -> const std::string& { return performance_notes[i].id; });
 }
 
-void AutomaticNoteMatcher::update_config(const Config& config) {
-    alignment_type_ = config.alignment_type;
-    score_fine_node_length_ = config.score_fine_node_length;
-    s_time_div_ = config.s_time_div;
-    p_time_div_ = config.p_time_div;
-    sfuzziness_ = config.sfuzziness;
-    pfuzziness_ = config.pfuzziness;
-    window_size_ = config.window_size;
-    pfuzziness_relative_to_tempo_ = config.pfuzziness_relative_to_tempo;
-    shift_onsets_ = config.shift_onsets;
-    cap_combinations_ = config.cap_combinations;
+AlignmentVector SequenceAugmentedGreedyMatcher::operator()(
+    const NoteTable& score_notes,
+    const NoteTable& performance_notes,
+    const TimeAlignmentVector& alignment_times,
+    bool shift,
+    int cap_combinations,
+    unsigned int random_seed) const {
+    
+    auto interpolator = make_interpolator(alignment_times);
+    if (!interpolator) {
+        // Fall back to simple greedy matching
+        SimplestGreedyMatcher simple_matcher;
+        return simple_matcher(score_notes, performance_notes);
+    }
+    
+    // Seeded per call so that results do not depend on call history
+    std::mt19937 gen(random_seed);
+    
+    auto index_alignment = sequence_match_indices(
+        score_notes.onset, score_notes.pitch,
+        performance_notes.onset, performance_notes.pitch,
+        *interpolator, shift, cap_combinations, gen
+    );
+    return to_alignment_vector(index_alignment,
+        [&](size_t i) -> const std::string& { return score_notes.id_str(i); },
+        [&](size_t i) -> const std::string& { return performance_notes.id_str(i); });
 }
 
-const AutomaticNoteMatcher::Config& AutomaticNoteMatcher::get_config() const {
-    static Config config;
-    config.alignment_type = alignment_type_;
-    config.score_fine_node_length = score_fine_node_length_;
-    config.s_time_div = s_time_div_;
-    config.p_time_div = p_time_div_;
-    config.sfuzziness = sfuzziness_;
-    config.pfuzziness = pfuzziness_;
-    config.window_size = window_size_;
-    config.pfuzziness_relative_to_tempo = pfuzziness_relative_to_tempo_;
-    config.shift_onsets = shift_onsets_;
-    config.cap_combinations = cap_combinations_;
-    return config;
-}
+namespace {
 
-void AutomaticNoteMatcher::set_config(const Config& config) {
-    update_config(config);
+// Note columns read by the alignment pipeline
+struct NoteColumns {
+    std::vector<float> onset_beat, duration_beat;
+    std::vector<float> onset_sec, duration_sec;
+    std::vector<int> pitch;
+    
+    void assign(const NoteArray& notes) {
+        onset_beat.clear();
+        duration_beat.clear();
+        onset_sec.clear();
+        duration_sec.clear();
+        pitch.clear();
+        for (const auto& note : notes) {
+            onset_beat.push_back(note.onset_beat);
+            duration_beat.push_back(note.duration_beat);
+            onset_sec.push_back(note.onset_sec);
+            duration_sec.push_back(note.duration_sec);
+            pitch.push_back(note.pitch);
+        }
+    }
+};
+
+using note_array::FlatPianoroll;
+
+// note_array::compute_pianoroll of the given rows, in beats if the first
+// row has beat times
+void build_pianoroll(const NoteColumns& notes, const size_t* rows, size_t num_rows,
+                     int time_div, FlatPianoroll& roll) {
+    const bool use_beat_time =
+        num_rows > 0 && (notes.onset_beat[rows[0]] != 0.0f || notes.duration_beat[rows[0]] != 0.0f);
+    const auto& onsets = use_beat_time ? notes.onset_beat : notes.onset_sec;
+    const auto& durations = use_beat_time ? notes.duration_beat : notes.duration_sec;
+    note_array::compute_pianoroll(onsets.data(), durations.data(), notes.pitch.data(), rows, num_rows, time_div,
+                                  false, roll);
 }
 
-AlignmentVector AutomaticNoteMatcher::operator()(
-    const NoteArray& score_notes,
-    const NoteArray& performance_notes,
-    bool verbose_time) {
+// Match between note rows found in a window
+struct WindowMatch {
+    int window;
+    size_t score_row;
+    size_t performance_row;
+};
+
+// Notes sharing an id share a key
+struct IdKeys {
+    std::vector<size_t> order;    // Rows sorted by id
+    std::vector<size_t> key;      // Row -> key, keys in id order
+    std::vector<size_t> key_row;  // Key -> first row with that id
     
-    auto start_time = std::chrono::high_resolution_clock::now();
+    void assign(const NoteArray& notes) {
+        order.resize(notes.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&notes](size_t a, size_t b) { return notes[a].id < notes[b].id; });
+        
+        key.resize(notes.size());
+        key_row.clear();
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (i == 0 || notes[order[i]].id != notes[order[i - 1]].id) {
+                key_row.push_back(order[i]);
+            }
+            key[order[i]] = key_row.size() - 1;
+        }
+    }
+};
+
+// Index tables for mending
+struct MendScratch {
+    IdKeys score_ids, perf_ids;
+    std::vector<size_t> score_candidate_offsets, perf_candidate_offsets;
+    std::vector<std::pair<int, size_t>> score_candidates, perf_candidates;  // (window, other key)
+    std::vector<char> score_used, perf_used;
+    std::vector<std::pair<size_t, size_t>> matches;     // (score key, performance key)
+    std::vector<size_t> fallback_score_rows, fallback_perf_rows;
+    std::vector<int> fallback_score_pitches, fallback_perf_pitches;
+    std::vector<IndexAlignment> fallback_alignment;
+    size_t fallback_matches = 0;
+};
+
+// Group (window, other key) candidates by key, keeping collection order
+template<typename KeyFn, typename OtherFn>
+void group_candidates(const std::vector<WindowMatch>& window_matches, size_t num_keys,
+                      KeyFn key_of, OtherFn other_of,
+                      std::vector<size_t>& offsets, std::vector<std::pair<int, size_t>>& candidates) {
+    offsets.assign(num_keys + 1, 0);
+    for (const auto& match : window_matches) {
+        offsets[key_of(match) + 1]++;
+    }
+    for (size_t k = 0; k < num_keys; ++k) {
+        offsets[k + 1] += offsets[k];
+    }
     
-    // Step 1: Initial coarse DTW pass
-    auto dtw_alignment_times_init = preprocessors::alignment_times_from_dtw(
-        score_notes, performance_notes, *note_matcher_, 4.0f, s_time_div_, p_time_div_
-    );
+    candidates.resize(window_matches.size());
+    for (const auto& match : window_matches) {
+        candidates[offsets[key_of(match)]++] = {match.window, other_of(match)};
+    }
+    for (size_t k = num_keys; k > 0; --k) {
+        offsets[k] = offsets[k - 1];
+    }
+    offsets[0] = 0;
+}
+
+// preprocessors::mend_note_alignments on window matches between rows; ids
+// are replaced by keys, and std::map order by key order
+AlignmentVector mend_window_matches(
+    const std::vector<WindowMatch>& window_matches,
+    const NoteArray& performance_notes,
+    const NoteArray& score_notes,
+    const IdKeys* prepared_score_ids,
+    MatchScratch& match_scratch,
+    MendScratch& scratch) {
     
-    auto t1 = std::chrono::high_resolution_clock::now();
-    if (verbose_time) {
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - start_time);
-        std::cout << duration.count() / 1000.0 << " sec : Initial coarse DTW pass" << std::endl;
+    if (!prepared_score_ids) {
+        scratch.score_ids.assign(score_notes);
     }
+    scratch.perf_ids.assign(performance_notes);
+    const IdKeys& score_ids = prepared_score_ids ? *prepared_score_ids : scratch.score_ids;
+    const auto& score_key = score_ids.key;
+    const auto& perf_key = scratch.perf_ids.key;
+    const size_t num_score_keys = score_ids.key_row.size();
+    const size_t num_perf_keys = scratch.perf_ids.key_row.size();
     
-    // Step 2: Cut arrays into windows
-    auto [score_note_arrays, performance_note_arrays] = preprocessors::cut_note_arrays(
-        performance_notes, score_notes, dtw_alignment_times_init,
-        sfuzziness_, pfuzziness_, window_size_, pfuzziness_relative_to_tempo_
-    );
+    group_candidates(window_matches, num_score_keys,
+                     [&](const WindowMatch& m) { return score_key[m.score_row]; },
+                     [&](const WindowMatch& m) { return perf_key[m.performance_row]; },
+                     scratch.score_candidate_offsets, scratch.score_candidates);
+    group_candidates(window_matches, num_perf_keys,
+                     [&](const WindowMatch& m) { return perf_key[m.performance_row]; },
+                     [&](const WindowMatch& m) { return score_key[m.score_row]; },
+                     scratch.perf_candidate_offsets, scratch.perf_candidates);
     
-    auto t2 = std::chrono::high_resolution_clock::now();
-    if (verbose_time) {
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1);
-        std::cout << duration.count() / 1000.0 << " sec : Cutting" << std::endl;
-    }
+    auto& score_used = scratch.score_used;
+    auto& perf_used = scratch.perf_used;
+    auto& matches = scratch.matches;
+    score_used.assign(num_score_keys, 0);
+    perf_used.assign(num_perf_keys, 0);
+    matches.clear();
     
-    // Step 3: Compute windowed alignments
-    std::vector<AlignmentVector> note_alignments;
+    auto score_id_empty = [&](size_t key) { return score_notes[score_ids.key_row[key]].id.empty(); };
+    auto perf_id_empty = [&](size_t key) { return performance_notes[scratch.perf_ids.key_row[key]].id.empty(); };
+    const auto* score_candidates = scratch.score_candidates.data();
+    const auto* perf_candidates = scratch.perf_candidates.data();
+    const auto& score_offsets = scratch.score_candidate_offsets;
+    const auto& perf_offsets = scratch.perf_candidate_offsets;
     
-    for (size_t window_id = 0; window_id < score_note_arrays.size(); ++window_id) {
-        if (alignment_type_ == "greedy") {
-            auto alignment = (*greedy_symbolic_note_matcher_)(
-                score_note_arrays[window_id], performance_note_arrays[window_id]
-            );
-            note_alignments.push_back(std::move(alignment));
-        } else {
-            TimeAlignmentVector dtw_alignment_times;
-            
-            if (alignment_type_ == "dtw") {
-                if (score_note_arrays[window_id].empty() || performance_note_arrays[window_id].empty()) {
-                    // For empty arrays, use linear interpolation from init times
-                    if (window_id + 1 < dtw_alignment_times_init.size()) {
-                        dtw_alignment_times = {
-                            dtw_alignment_times_init[window_id],
-                            dtw_alignment_times_init[window_id + 1]
-                        };
+    // Resolve matches, preferring earlier windows for conflicts
+    for (size_t score = 0; score < num_score_keys; ++score) {
+        const size_t num_candidates = score_offsets[score + 1] - score_offsets[score];
+        if (num_candidates == 0) continue;
+        const auto* candidates = score_candidates + score_offsets[score];
+        
+        if (num_candidates == 1) {
+            const size_t perf = candidates[0].second;
+            const auto* perf_begin = perf_candidates + perf_offsets[perf];
+            const auto* perf_end = perf_candidates + perf_offsets[perf + 1];
+            if (perf_end - perf_begin == 1) {
+                // Mutual unique match - accept it
+                matches.emplace_back(score, perf);
+                score_used[score] = 1;
+                perf_used[perf] = 1;
+            } else {
+                // Choose the score candidate from the earliest window
+                int best_window = std::numeric_limits<int>::max();
+                size_t best_score = NO_INDEX;
+                for (const auto* it = perf_begin; it != perf_end; ++it) {
+                    if (it->first < best_window && !score_used[it->second]) {
+                        best_window = it->first;
+                        best_score = it->second;
                     }
-                } else {
-                    dtw_alignment_times = preprocessors::alignment_times_from_dtw(
-                        score_note_arrays[window_id], performance_note_arrays[window_id],
-                        *note_matcher_, score_fine_node_length_, s_time_div_, p_time_div_
-                    );
                 }
-            } else {
-                // Use linear alignment
-                if (window_id + 1 < dtw_alignment_times_init.size()) {
-                    dtw_alignment_times = {
-                        dtw_alignment_times_init[window_id],
-                        dtw_alignment_times_init[window_id + 1]
-                    };
+                if (best_score != NO_INDEX && !score_id_empty(best_score) && !perf_used[perf]) {
+                    matches.emplace_back(best_score, perf);
+                    score_used[best_score] = 1;
+                    perf_used[perf] = 1;
                 }
             }
-            
-            // Distance augmented greedy alignment
-            auto fine_alignment = (*symbolic_note_matcher_)(
-                score_note_arrays[window_id], performance_note_arrays[window_id],
-                dtw_alignment_times, shift_onsets_, cap_combinations_
-            );
-            
-            note_alignments.push_back(std::move(fine_alignment));
+        } else {
+            // Earliest window whose performance note has no earlier free score candidate
+            int best_window = std::numeric_limits<int>::max();
+            size_t best_perf = NO_INDEX;
+            for (size_t c = 0; c < num_candidates; ++c) {
+                const auto [window, perf] = candidates[c];
+                if (window < best_window && !perf_used[perf]) {
+                    bool is_best_for_perf = true;
+                    for (size_t o = perf_offsets[perf]; o < perf_offsets[perf + 1]; ++o) {
+                        if (perf_candidates[o].first < window && !score_used[perf_candidates[o].second]) {
+                            is_best_for_perf = false;
+                            break;
+                        }
+                    }
+                    if (is_best_for_perf) {
+                        best_window = window;
+                        best_perf = perf;
+                    }
+                }
+            }
+            if (best_perf != NO_INDEX && !perf_id_empty(best_perf) && !score_used[score]) {
+                matches.emplace_back(score, best_perf);
+                score_used[score] = 1;
+                perf_used[best_perf] = 1;
+            }
         }
     }
     
-    auto t3 = std::chrono::high_resolution_clock::now();
-    if (verbose_time) {
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(t3 - t2);
-        std::cout << duration.count() / 1000.0 
-                  << " sec : Fine-grained DTW passes, symbolic matching" << std::endl;
+    // Greedy fallback on the remaining notes
+    scratch.fallback_score_rows.clear();
+    scratch.fallback_score_pitches.clear();
+    for (size_t row = 0; row < score_notes.size(); ++row) {
+        if (!score_used[score_key[row]]) {
+            scratch.fallback_score_rows.push_back(row);
+            scratch.fallback_score_pitches.push_back(score_notes[row].pitch);
+        }
+    }
+    scratch.fallback_perf_rows.clear();
+    scratch.fallback_perf_pitches.clear();
+    for (size_t row = 0; row < performance_notes.size(); ++row) {
+        if (!perf_used[perf_key[row]]) {
+            scratch.fallback_perf_rows.push_back(row);
+            scratch.fallback_perf_pitches.push_back(performance_notes[row].pitch);
+        }
     }
     
-    // Step 4: Mend windows to global alignment
-    auto global_alignment = preprocessors::mend_note_alignments(
-        note_alignments, performance_notes, score_notes, dtw_alignment_times_init
-    );
+    scratch.fallback_matches = 0;
+    if (!scratch.fallback_score_rows.empty() && !scratch.fallback_perf_rows.empty()) {
+        scratch.fallback_alignment.clear();
+        greedy_match_indices(scratch.fallback_score_pitches, scratch.fallback_perf_pitches,
+                             match_scratch, scratch.fallback_alignment);
+        for (const auto& align : scratch.fallback_alignment) {
+            if (align.label != Alignment::Label::MATCH) continue;
+            size_t score = score_key[scratch.fallback_score_rows[align.score_index]];
+            size_t perf = perf_key[scratch.fallback_perf_rows[align.performance_index]];
+            // Only add if both notes are still unmatched
+            if (!score_used[score] && !perf_used[perf]) {
+                matches.emplace_back(score, perf);
+                score_used[score] = 1;
+                perf_used[perf] = 1;
+                scratch.fallback_matches++;
+            }
+        }
+    }
     
-    auto t4 = std::chrono::high_resolution_clock::now();
-    if (verbose_time) {
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(t4 - t3);
-        std::cout << duration.count() / 1000.0 << " sec : Mending" << std::endl;
+    // Matches, then deletions and insertions for truly unmatched notes
+    size_t num_entries = matches.size();
+    for (size_t row = 0; row < score_notes.size(); ++row) {
+        num_entries += !score_used[score_key[row]];
+    }
+    for (size_t row = 0; row < performance_notes.size(); ++row) {
+        num_entries += !perf_used[perf_key[row]];
+    }
+    
+    AlignmentVector global_alignment;
+    global_alignment.reserve(num_entries);
+    for (const auto& [score, perf] : matches) {
+        global_alignment.emplace_back(Alignment::Label::MATCH, score_notes[score_ids.key_row[score]].id,
+                                      performance_notes[scratch.perf_ids.key_row[perf]].id);
+    }
+    for (size_t row = 0; row < score_notes.size(); ++row) {
+        if (!score_used[score_key[row]]) {
+            global_alignment.emplace_back(Alignment::Label::DELETION, score_notes[row].id);
+        }
+    }
+    for (size_t row = 0; row < performance_notes.size(); ++row) {
+        if (!perf_used[perf_key[row]]) {
+            global_alignment.emplace_back(Alignment::Label::INSERTION, "", performance_notes[row].id);
+        }
     }
     
     return global_alignment;
 }
 
-// Evaluation functions
-namespace evaluation {
+template<typename... Vectors>
+size_t vector_bytes(const Vectors&... vectors) {
+    return (size_t{0} + ... + (vectors.capacity() * sizeof(typename Vectors::value_type)));
+}
 
-FScoreResult fscore_alignments(
-    const AlignmentVector& prediction,
-    const AlignmentVector& ground_truth,
-    const std::vector<Alignment::Label>& types,
-    bool return_numbers) {
+size_t columns_bytes(const NoteColumns& columns) {
+    return vector_bytes(columns.onset_beat, columns.duration_beat, columns.onset_sec, columns.duration_sec,
+                        columns.pitch);
+}
+
+// Score-derived inputs of the pipeline. A PreparedScore computes all of them
+// once; other calls fill the columns per call and leave the tables empty
+struct ScoreData {
+    NoteColumns columns;
+    std::vector<size_t> all_rows;
+    std::vector<std::pair<int, FlatPianoroll>> rolls;  // Roll of all rows per time_div
+    IdKeys ids;
+    bool has_ids = false;
     
-    // Filter by types
-    AlignmentVector pred_filtered, gt_filtered;
+    void assign(const NoteArray& notes) {
+        columns.assign(notes);
+        all_rows.resize(notes.size());
+        std::iota(all_rows.begin(), all_rows.end(), 0);
+        rolls.clear();
+        has_ids = false;
+    }
     
-    for (const auto& align : prediction) {
-        if (std::find(types.begin(), types.end(), align.label) != types.end()) {
-            pred_filtered.push_back(align);
+    const FlatPianoroll* roll(int time_div) const {
+        for (const auto& [div, roll] : rolls) {
+            if (div == time_div) return &roll;
         }
+        return nullptr;
     }
     
-    for (const auto& align : ground_truth) {
-        if (std::find(types.begin(), types.end(), align.label) != types.end()) {
-            gt_filtered.push_back(align);
+    size_t capacity_bytes() const {
+        size_t bytes = columns_bytes(columns) + vector_bytes(all_rows, ids.order, ids.key, ids.key_row);
+        for (const auto& entry : rolls) {
+            bytes += vector_bytes(entry.second.values);
         }
+        return bytes;
     }
+};
+
+// Per-pair state of the pipeline: note columns, coarse alignment times,
+// windows and the matches found in them
+struct PairBuffers {
+    ScoreData own_score;               // Score data of calls without a PreparedScore
+    const ScoreData* score = nullptr;  // own_score or a PreparedScore's
+    NoteColumns performance;
+    std::vector<size_t> all_perf_rows;
+    TimeAlignmentVector init_times;
+    preprocessors::WindowRows windows;
+    std::vector<WindowMatch> window_matches;
     
-    // Count correct predictions
-    size_t n_correct = 0;
-    for (const auto& pred : pred_filtered) {
-        for (const auto& gt : gt_filtered) {
-            if (pred.label == gt.label &&
-                pred.score_id == gt.score_id &&
-                pred.performance_id == gt.performance_id) {
-                n_correct++;
-                break;
-            }
+    size_t capacity_bytes() const {
+        size_t bytes = own_score.capacity_bytes() + columns_bytes(performance);
+        bytes += vector_bytes(all_perf_rows, init_times, window_matches);
+        bytes += vector_bytes(windows.score_offsets, windows.score_rows,
+                              windows.performance_offsets, windows.performance_rows);
+        return bytes;
+    }
+};
+
+// Scratch of the DTW passes, window matching and mending; the stages of one
+// pair may run on different threads, each with its own scratch
+struct StageScratch {
+    FlatPianoroll score_roll, perf_roll;
+    DynamicTimeWarping::Buffers dtw;
+    DTWPath path;
+    TimeAlignmentVector window_times;
+    std::vector<int> window_score_pitches, window_perf_pitches;
+    std::vector<float> window_score_onsets, window_perf_onsets;
+    std::vector<float> interpolation_x, interpolation_y;
+    preprocessors::LinearInterpolator interpolator;
+    MatchScratch match;
+    std::vector<IndexAlignment> window_alignment;
+    WindowCache::Key cache_key;
+    WindowCache::Matches cached_matches;
+    MendScratch mend;
+    
+    size_t capacity_bytes() const {
+        size_t bytes = vector_bytes(score_roll.values, perf_roll.values, dtw.cost, dtw.row_x, dtw.row_y,
+                                    path, window_times);
+        bytes += vector_bytes(window_score_pitches, window_perf_pitches, window_score_onsets,
+                              window_perf_onsets, interpolation_x, interpolation_y, window_alignment, cache_key,
+                              cached_matches);
+        bytes += vector_bytes(match.bucket_start, match.bucket_head, match.bucketed_indices,
+                              match.performance_aligned, match.partitioned_score_onsets,
+                              match.score_onsets_converted, match.sorted_score_onsets,
+                              match.sorted_perf_onsets, match.omit_mask, match.combination_mask,
+                              match.drawn, match.best_omit_indices);
+        for (const auto* partition : {&match.score_partition, &match.perf_partition}) {
+            bytes += vector_bytes(partition->pitches, partition->offsets, partition->indices, partition->counts);
+        }
+        for (const auto* ids : {&mend.score_ids, &mend.perf_ids}) {
+            bytes += vector_bytes(ids->order, ids->key, ids->key_row);
         }
+        bytes += vector_bytes(mend.score_candidate_offsets, mend.perf_candidate_offsets, mend.score_candidates,
+                              mend.perf_candidates, mend.score_used, mend.perf_used, mend.matches);
+        bytes += vector_bytes(mend.fallback_score_rows, mend.fallback_perf_rows, mend.fallback_score_pitches,
+                              mend.fallback_perf_pitches, mend.fallback_alignment);
+        return bytes;
     }
+};
+
+int64_t elapsed_ns(std::chrono::high_resolution_clock::time_point from,
+                   std::chrono::high_resolution_clock::time_point to) {
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+/**
+ * The stages of AutomaticNoteMatcher over its configuration
+ * 
+ * coarse_alignment() fills the pair state up to the windows, match_window()
+ * matches one window on its own and mend() joins the window matches. Windows
+ * only read the pair state, so they can be matched concurrently given one
+ * scratch per thread and one match list per window (or run of windows).
+ */
+class AlignmentPipeline {
+private:
+    const AutomaticNoteMatcherConfig& config_;
+    const DynamicTimeWarping& dtw_;
+    WindowCache* cache_;
+    bool greedy_;
+    bool window_dtw_;
     
-    size_t n_pred_filtered = pred_filtered.size();
-    size_t n_gt_filtered = gt_filtered.size();
+public:
+    AlignmentPipeline(const AutomaticNoteMatcherConfig& config, const DynamicTimeWarping& dtw, WindowCache* cache)
+        : config_(config), dtw_(dtw), cache_(cache),
+          greedy_(config.alignment_type == "greedy"), window_dtw_(config.alignment_type == "dtw") {}
     
-    FScoreResult result;
-    result.n_predicted = n_pred_filtered;
-    result.n_ground_truth = n_gt_filtered;
+    // Steps 1 and 2: coarse DTW over the whole pieces, then cutting into windows.
+    // The score data must outlive the pair's use
+    void coarse_alignment(const ScoreData& score, const NoteArray& performance_notes,
+                          PairBuffers& pair, StageScratch& scratch, AlignmentStats& stats) const {
+        coarse_times(score, performance_notes, pair, scratch, stats);
+        cut_windows(pair, stats);
+    }
     
-    if (n_pred_filtered > 0 || n_gt_filtered > 0) {
-        result.precision = n_pred_filtered > 0 ? static_cast<double>(n_correct) / n_pred_filtered : 0.0;
-        result.recall = n_gt_filtered > 0 ? static_cast<double>(n_correct) / n_gt_filtered : 0.0;
-        result.f_score = (result.precision + result.recall) > 0 ? 
-                        2.0 * result.precision * result.recall / (result.precision + result.recall) : 0.0;
+    // Step 1 alone; a prepared performance roll must be the roll of all
+    // performance rows at p_time_div
+    void coarse_times(const ScoreData& score, const NoteArray& performance_notes,
+                      PairBuffers& pair, StageScratch& scratch, AlignmentStats& stats,
+                      const FlatPianoroll* prepared_perf_roll = nullptr) const {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        
+        pair.score = &score;
+        pair.performance.assign(performance_notes);
+        pair.all_perf_rows.resize(performance_notes.size());
+        std::iota(pair.all_perf_rows.begin(), pair.all_perf_rows.end(), 0);
+        
+        {
+            trace::Span span("coarse_dtw");
+            dtw_alignment_times(pair, score.all_rows.data(), score.all_rows.size(),
+                                pair.all_perf_rows.data(), pair.all_perf_rows.size(), scratch, pair.init_times,
+                                stats.stages[AlignmentStats::COARSE_DTW], -1, score.roll(config_.s_time_div),
+                                prepared_perf_roll);
+        }
+        
+        stats.stages[AlignmentStats::COARSE_DTW].wall_ns =
+            elapsed_ns(start_time, std::chrono::high_resolution_clock::now());
+    }
+    
+    // Step 2 alone, with the pair's current performance and coarse times
+    void cut_windows(PairBuffers& pair, AlignmentStats& stats) const {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        {
+            trace::Span span("cutting");
+            preprocessors::cut_note_rows(
+                pair.performance.onset_sec, pair.score->columns.onset_beat, pair.init_times, pair.windows,
+                config_.sfuzziness, config_.pfuzziness, config_.window_size, config_.pfuzziness_relative_to_tempo
+            );
+            span.arg("windows", static_cast<int64_t>(pair.windows.size()));
+        }
+        
+        stats.stages[AlignmentStats::CUTTING].wall_ns =
+            elapsed_ns(start_time, std::chrono::high_resolution_clock::now());
+        stats.num_windows = pair.windows.size();
+    }
+    
+    // Step 3 for one window: appends its matches (only matches are kept, since
+    // deletions and insertions are settled when mending)
+    void match_window(const PairBuffers& pair, size_t window_id, StageScratch& scratch,
+                      AlignmentStats& stats, std::vector<WindowMatch>& matches) const {
+        const auto& windows = pair.windows;
+        const size_t* score_rows = windows.score_rows.data() + windows.score_offsets[window_id];
+        const size_t num_score_rows = windows.score_offsets[window_id + 1] - windows.score_offsets[window_id];
+        const size_t* perf_rows = windows.performance_rows.data() + windows.performance_offsets[window_id];
+        const size_t num_perf_rows = windows.performance_offsets[window_id + 1] - windows.performance_offsets[window_id];
+        
+        if (num_score_rows == 0 || num_perf_rows == 0) {
+            return;  // Nothing to match
+        }
+        
+        trace::Span window_span("window");
+        window_span.arg("window", static_cast<int64_t>(window_id))
+                   .arg("score_notes", static_cast<int64_t>(num_score_rows))
+                   .arg("performance_notes", static_cast<int64_t>(num_perf_rows));
+        
+        uint64_t key_hash = 0;
+        if (cache_) {
+            build_cache_key(pair, window_id, score_rows, num_score_rows, perf_rows, num_perf_rows, scratch.cache_key);
+            key_hash = WindowCache::hash(scratch.cache_key);
+            if (cache_->lookup(key_hash, scratch.cache_key, scratch.cached_matches)) {
+                window_span.arg("cached", 1);
+                for (const auto& [score_index, perf_index] : scratch.cached_matches) {
+                    matches.push_back({static_cast<int>(window_id), score_rows[score_index], perf_rows[perf_index]});
+                }
+                return;
+            }
+        }
+        
+        scratch.window_score_pitches.clear();
+        for (size_t r = 0; r < num_score_rows; ++r) {
+            scratch.window_score_pitches.push_back(pair.score->columns.pitch[score_rows[r]]);
+        }
+        scratch.window_perf_pitches.clear();
+        for (size_t r = 0; r < num_perf_rows; ++r) {
+            scratch.window_perf_pitches.push_back(pair.performance.pitch[perf_rows[r]]);
+        }
+        
+        scratch.window_alignment.clear();
+        auto& window_times = scratch.window_times;
+        window_times.clear();
+        if (!greedy_) {
+            if (window_dtw_) {
+                dtw_alignment_times(pair, score_rows, num_score_rows, perf_rows, num_perf_rows, scratch,
+                                    window_times, stats.stages[AlignmentStats::WINDOW_MATCHING],
+                                    static_cast<int64_t>(window_id));
+            } else if (window_id + 1 < pair.init_times.size()) {
+                // Use linear alignment
+                window_times.push_back(pair.init_times[window_id]);
+                window_times.push_back(pair.init_times[window_id + 1]);
+            }
+        }
+        
+        trace::Span match_span("symbolic_match");
+        match_span.arg("window", static_cast<int64_t>(window_id));
+        if (window_times.size() < 2) {
+            // Greedy matching, also the fallback without enough alignment times
+            stats.greedy_fallback_windows += !greedy_;
+            greedy_match_indices(scratch.window_score_pitches, scratch.window_perf_pitches, scratch.match,
+                                 scratch.window_alignment);
+        } else {
+            // Distance augmented greedy alignment
+            scratch.interpolation_x.clear();
+            scratch.interpolation_y.clear();
+            for (const auto& align : window_times) {
+                scratch.interpolation_x.push_back(align.score_time);
+                scratch.interpolation_y.push_back(align.performance_time);
+            }
+            scratch.interpolator.assign(scratch.interpolation_x, scratch.interpolation_y);
+            
+            scratch.window_score_onsets.clear();
+            for (size_t r = 0; r < num_score_rows; ++r) {
+                scratch.window_score_onsets.push_back(pair.score->columns.onset_beat[score_rows[r]]);
+            }
+            scratch.window_perf_onsets.clear();
+            for (size_t r = 0; r < num_perf_rows; ++r) {
+                scratch.window_perf_onsets.push_back(pair.performance.onset_sec[perf_rows[r]]);
+            }
+            
+            // Seeded per window, as SequenceAugmentedGreedyMatcher does per call
+            std::mt19937 gen(config_.random_seed);
+            sequence_match_indices(scratch.window_score_onsets, scratch.window_score_pitches,
+                                   scratch.window_perf_onsets, scratch.window_perf_pitches, scratch.interpolator,
+                                   config_.shift_onsets, config_.cap_combinations, gen, scratch.match,
+                                   scratch.window_alignment);
+        }
+        
+        for (const auto& align : scratch.window_alignment) {
+            if (align.label == Alignment::Label::MATCH) {
+                matches.push_back({static_cast<int>(window_id), score_rows[align.score_index],
+                                   perf_rows[align.performance_index]});
+            }
+        }
+        
+        if (cache_) {
+            scratch.cached_matches.clear();
+            for (const auto& align : scratch.window_alignment) {
+                if (align.label == Alignment::Label::MATCH) {
+                    scratch.cached_matches.emplace_back(static_cast<uint32_t>(align.score_index),
+                                                        static_cast<uint32_t>(align.performance_index));
+                }
+            }
+            cache_->insert(key_hash, scratch.cache_key, scratch.cached_matches);
+        }
+    }
+    
+    // Step 4: mend the window matches (in window order) into the global alignment
+    AlignmentVector mend(const NoteArray& score_notes, const NoteArray& performance_notes,
+                         const PairBuffers& pair, StageScratch& scratch) const {
+        return mend(score_notes, performance_notes, *pair.score, pair.window_matches, scratch);
+    }
+    
+    // Step 4 over matches kept outside the pair
+    AlignmentVector mend(const NoteArray& score_notes, const NoteArray& performance_notes,
+                         const ScoreData& score, const std::vector<WindowMatch>& window_matches,
+                         StageScratch& scratch) const {
+        trace::Span span("mending");
+        span.arg("window_matches", static_cast<int64_t>(window_matches.size()));
+        return mend_window_matches(window_matches, performance_notes, score_notes,
+                                   score.has_ids ? &score.ids : nullptr, scratch.match, scratch.mend);
+    }
+    
+private:
+    // Everything match_window's result depends on besides the DTW settings
+    void build_cache_key(const PairBuffers& pair, size_t window_id,
+                         const size_t* score_rows, size_t num_score_rows,
+                         const size_t* perf_rows, size_t num_perf_rows, WindowCache::Key& key) const {
+        auto bits = [](float value) {
+            uint32_t word;
+            std::memcpy(&word, &value, sizeof(word));
+            return word;
+        };
+        
+        key.clear();
+        key.push_back(greedy_ ? 0 : window_dtw_ ? 1 : 2);
+        key.push_back(static_cast<uint32_t>(config_.s_time_div));
+        key.push_back(static_cast<uint32_t>(config_.p_time_div));
+        key.push_back(config_.shift_onsets);
+        key.push_back(static_cast<uint32_t>(config_.cap_combinations));
+        key.push_back(config_.random_seed);
+        key.push_back(static_cast<uint32_t>(num_score_rows));
+        key.push_back(static_cast<uint32_t>(num_perf_rows));
+        if (!greedy_ && !window_dtw_) {
+            // Linear alignment between the coarse times around the window
+            const bool has_times = window_id + 1 < pair.init_times.size();
+            key.push_back(has_times);
+            for (size_t t = window_id; has_times && t <= window_id + 1; ++t) {
+                key.push_back(bits(pair.init_times[t].score_time));
+                key.push_back(bits(pair.init_times[t].performance_time));
+            }
+        }
+        
+        // Greedy matching only sees pitches
+        auto add_notes = [&](const NoteColumns& columns, const size_t* rows, size_t num_rows) {
+            for (size_t r = 0; r < num_rows; ++r) {
+                size_t row = rows[r];
+                key.push_back(static_cast<uint32_t>(columns.pitch[row]));
+                if (!greedy_) {
+                    key.push_back(bits(columns.onset_beat[row]));
+                    key.push_back(bits(columns.duration_beat[row]));
+                    key.push_back(bits(columns.onset_sec[row]));
+                    key.push_back(bits(columns.duration_sec[row]));
+                }
+            }
+        };
+        add_notes(pair.score->columns, score_rows, num_score_rows);
+        add_notes(pair.performance, perf_rows, num_perf_rows);
+    }
+    
+    // DTW on the piano rolls of the given rows -> alignment times; prepared
+    // rolls must be the rolls of exactly these rows
+    void dtw_alignment_times(const PairBuffers& pair,
+                             const size_t* score_rows, size_t num_score_rows,
+                             const size_t* perf_rows, size_t num_perf_rows,
+                             StageScratch& scratch, TimeAlignmentVector& alignment_times,
+                             AlignmentStats::StageStats& stage, int64_t window_id,
+                             const FlatPianoroll* prepared_score_roll = nullptr,
+                             const FlatPianoroll* prepared_perf_roll = nullptr) const {
+        {
+            trace::Span span("pianoroll");
+            span.arg("window", window_id);
+            if (!prepared_score_roll) {
+                build_pianoroll(pair.score->columns, score_rows, num_score_rows, config_.s_time_div,
+                                scratch.score_roll);
+            }
+            if (!prepared_perf_roll) {
+                build_pianoroll(pair.performance, perf_rows, num_perf_rows, config_.p_time_div, scratch.perf_roll);
+            }
+        }
+        const FlatPianoroll& score_roll = prepared_score_roll ? *prepared_score_roll : scratch.score_roll;
+        const FlatPianoroll& perf_roll = prepared_perf_roll ? *prepared_perf_roll : scratch.perf_roll;
+        
+        trace::Span span("dtw");
+        const size_t rows = score_roll.num_pitches;
+        const size_t cols = perf_roll.num_pitches;
+        stage.dtw_cells += rows * cols;
+        if (rows > 0 && cols > 0) {
+            size_t matrix_bytes = (score_roll.values.size() + perf_roll.values.size()) * sizeof(float) +
+                                  (rows + 1) * (cols + 1) * sizeof(double);
+            stage.peak_matrix_bytes = std::max(stage.peak_matrix_bytes, matrix_bytes);
+        }
+        span.arg("window", window_id).arg("cells", static_cast<int64_t>(rows * cols));
+        
+        dtw_.compute_path(score_roll.values.data(), score_roll.num_pitches,
+                          score_roll.num_steps, perf_roll.values.data(),
+                          perf_roll.num_pitches, perf_roll.num_steps, scratch.dtw, scratch.path);
+        preprocessors::alignment_times_from_path(scratch.path, config_.s_time_div, config_.p_time_div,
+                                                 alignment_times);
+    }
+};
+
+} // namespace
+
+// The matcher's mending on window alignments given by id. Matches whose ids
+// are not among the notes are skipped; deletions and insertions are settled
+// from the notes themselves
+AlignmentVector preprocessors::mend_note_alignments(
+    const std::vector<AlignmentVector>& note_alignments,
+    const NoteArray& performance_notes,
+    const NoteArray& score_notes,
+    const TimeAlignmentVector& /*node_times*/,
+    int /*max_traversal_depth*/) {
+    
+    // Id -> first row with that id, the row mending keys the id by
+    auto first_rows = [](const NoteArray& notes) {
+        std::unordered_map<std::string_view, size_t> rows;
+        rows.reserve(notes.size());
+        for (size_t row = 0; row < notes.size(); ++row) {
+            rows.emplace(notes[row].id, row);
+        }
+        return rows;
+    };
+    const auto score_rows = first_rows(score_notes);
+    const auto perf_rows = first_rows(performance_notes);
+    
+    std::vector<WindowMatch> window_matches;
+    for (size_t window_id = 0; window_id < note_alignments.size(); ++window_id) {
+        for (const auto& align : note_alignments[window_id]) {
+            if (align.label != Alignment::Label::MATCH) continue;
+            auto score = score_rows.find(align.score_id);
+            auto perf = perf_rows.find(align.performance_id);
+            if (score != score_rows.end() && perf != perf_rows.end()) {
+                window_matches.push_back({static_cast<int>(window_id), score->second, perf->second});
+            }
+        }
+    }
+    
+    MatchScratch match_scratch;
+    MendScratch scratch;
+    return mend_window_matches(window_matches, performance_notes, score_notes, nullptr, match_scratch, scratch);
+}
+
+struct AlignmentWorkspace::Buffers {
+    PairBuffers pair;
+    StageScratch scratch;
+    
+    size_t capacity_bytes() const {
+        return pair.capacity_bytes() + scratch.capacity_bytes();
+    }
+};
+
+struct PreparedScore::Data {
+    NoteArray notes;
+    ScoreData score;
+};
+
+// PreparedScore implementation
+PreparedScore::PreparedScore(NoteArray score_notes, const std::vector<int>& time_divs) {
+    auto data = std::make_shared<Data>();
+    data->notes = std::move(score_notes);
+    ScoreData& score = data->score;
+    score.assign(data->notes);
+    for (int time_div : time_divs) {
+        if (time_div <= 0) {
+            throw std::invalid_argument("PreparedScore time_div must be positive");
+        }
+        if (score.roll(time_div)) continue;
+        score.rolls.emplace_back(time_div, FlatPianoroll());
+        build_pianoroll(score.columns, score.all_rows.data(), score.all_rows.size(), time_div,
+                        score.rolls.back().second);
+    }
+    score.ids.assign(data->notes);
+    score.has_ids = true;
+    data_ = std::move(data);
+}
+
+const NoteArray& PreparedScore::notes() const {
+    return data_->notes;
+}
+
+size_t PreparedScore::capacity_bytes() const {
+    return data_->notes.capacity() * sizeof(Note) + data_->score.capacity_bytes();
+}
+
+// AlignmentStats implementation
+int64_t AlignmentStats::total_ns() const {
+    int64_t total = 0;
+    for (const auto& stage : stages) {
+        total += stage.wall_ns;
+    }
+    return total;
+}
+
+const char* AlignmentStats::stage_name(Stage stage) {
+    switch (stage) {
+        case COARSE_DTW: return "coarse_dtw";
+        case CUTTING: return "cutting";
+        case WINDOW_MATCHING: return "window_matching";
+        case MENDING: return "mending";
+        default: return "unknown";
+    }
+}
+
+void AlignmentStats::clear() {
+    stages.fill(StageStats());
+    num_windows = 0;
+    window_score_notes.clear();
+    window_performance_notes.clear();
+    combinations_evaluated = 0;
+    greedy_fallback_windows = 0;
+    fallback_greedy_matches = 0;
+}
+
+// AlignmentWorkspace implementation
+AlignmentWorkspace::AlignmentWorkspace() = default;
+AlignmentWorkspace::~AlignmentWorkspace() = default;
+AlignmentWorkspace::AlignmentWorkspace(AlignmentWorkspace&&) noexcept = default;
+AlignmentWorkspace& AlignmentWorkspace::operator=(AlignmentWorkspace&&) noexcept = default;
+
+size_t AlignmentWorkspace::capacity_bytes() const {
+    return buffers_ ? buffers_->capacity_bytes() : 0;
+}
+
+void AlignmentWorkspace::release() {
+    buffers_.reset();
+}
+
+namespace {
+
+// Per-thread scratch keeps concurrent calls on one matcher independent
+AlignmentWorkspace& thread_local_workspace() {
+    thread_local AlignmentWorkspace workspace;
+    return workspace;
+}
+
+// The calling thread's workspace for one call, released afterwards if the
+// call left it above THREAD_LOCAL_MAX_BYTES
+class ThreadWorkspace {
+public:
+    ThreadWorkspace() : workspace_(thread_local_workspace()) {}
+    
+    ~ThreadWorkspace() {
+        if (workspace_.capacity_bytes() > AlignmentWorkspace::THREAD_LOCAL_MAX_BYTES) {
+            workspace_.release();
+        }
+    }
+    
+    ThreadWorkspace(const ThreadWorkspace&) = delete;
+    ThreadWorkspace& operator=(const ThreadWorkspace&) = delete;
+    
+    operator AlignmentWorkspace&() { return workspace_; }
+    
+private:
+    AlignmentWorkspace& workspace_;
+};
+
+} // namespace
+
+void AlignmentWorkspace::release_thread_local() {
+    thread_local_workspace().release();
+}
+
+// AutomaticNoteMatcher implementation
+AutomaticNoteMatcher::AutomaticNoteMatcher() {
+    // Wider windows than the Config defaults
+    config_.sfuzziness = 8.0f;
+    config_.pfuzziness = 8.0f;
+    initialize_matchers();
+}
+
+AutomaticNoteMatcher::AutomaticNoteMatcher(const Config& config) : config_(config) {
+    initialize_matchers();
+}
+
+void AutomaticNoteMatcher::initialize_matchers() {
+    note_matcher_ = std::make_unique<DynamicTimeWarping>();
+}
+
+const AutomaticNoteMatcher::Config& AutomaticNoteMatcher::get_config() const {
+    return config_;
+}
+
+void AutomaticNoteMatcher::set_config(const Config& config) {
+    config_ = config;
+}
+
+void AutomaticNoteMatcher::set_window_cache(std::shared_ptr<WindowCache> cache) {
+    window_cache_ = std::move(cache);
+}
+
+const std::shared_ptr<WindowCache>& AutomaticNoteMatcher::window_cache() const {
+    return window_cache_;
+}
+
+AlignmentVector AutomaticNoteMatcher::operator()(
+    const NoteArray& score_notes,
+    const NoteArray& performance_notes,
+    bool verbose_time) const {
+    
+    return (*this)(score_notes, performance_notes, ThreadWorkspace(), verbose_time);
+}
+
+AlignmentVector AutomaticNoteMatcher::operator()(
+    const NoteArray& score_notes,
+    const NoteArray& performance_notes,
+    AlignmentWorkspace& workspace,
+    bool verbose_time) const {
+    
+    AlignmentStats stats;
+    auto alignment = align_impl(score_notes, nullptr, performance_notes, workspace, stats, false);
+    
+    if (verbose_time) {
+        static const char* const descriptions[AlignmentStats::NUM_STAGES] = {
+            "Initial coarse DTW pass", "Cutting", "Fine-grained DTW passes, symbolic matching", "Mending"
+        };
+        for (int stage = 0; stage < AlignmentStats::NUM_STAGES; ++stage) {
+            // Whole milliseconds, as printed before stats were collected
+            int64_t milliseconds = stats.stages[stage].wall_ns / 1000000;
+            std::cout << milliseconds / 1000.0 << " sec : " << descriptions[stage] << std::endl;
+        }
+    }
+    
+    return alignment;
+}
+
+AlignmentVector AutomaticNoteMatcher::operator()(
+    const NoteArray& score_notes,
+    const NoteArray& performance_notes,
+    AlignmentStats& stats) const {
+    
+    return (*this)(score_notes, performance_notes, ThreadWorkspace(), stats);
+}
+
+AlignmentVector AutomaticNoteMatcher::operator()(
+    const NoteArray& score_notes,
+    const NoteArray& performance_notes,
+    AlignmentWorkspace& workspace,
+    AlignmentStats& stats) const {
+    
+    return align_impl(score_notes, nullptr, performance_notes, workspace, stats, true);
+}
+
+PreparedScore AutomaticNoteMatcher::prepare_score(NoteArray score_notes) const {
+    return PreparedScore(std::move(score_notes), {config_.s_time_div});
+}
+
+AlignmentVector AutomaticNoteMatcher::align(
+    const PreparedScore& score,
+    const NoteArray& performance_notes) const {
+    
+    return align(score, performance_notes, ThreadWorkspace());
+}
+
+AlignmentVector AutomaticNoteMatcher::align(
+    const PreparedScore& score,
+    const NoteArray& performance_notes,
+    AlignmentWorkspace& workspace) const {
+    
+    AlignmentStats stats;
+    return align_impl(score.notes(), &score, performance_notes, workspace, stats, false);
+}
+
+AlignmentVector AutomaticNoteMatcher::align(
+    const PreparedScore& score,
+    const NoteArray& performance_notes,
+    AlignmentWorkspace& workspace,
+    AlignmentStats& stats) const {
+    
+    return align_impl(score.notes(), &score, performance_notes, workspace, stats, true);
+}
+
+AlignmentVector AutomaticNoteMatcher::align_impl(
+    const NoteArray& score_notes,
+    const PreparedScore* prepared,
+    const NoteArray& performance_notes,
+    AlignmentWorkspace& workspace,
+    AlignmentStats& stats,
+    bool window_details) const {
+    
+    if (!workspace.buffers_) {
+        workspace.buffers_ = std::make_unique<AlignmentWorkspace::Buffers>();
+    }
+    auto& pair = workspace.buffers_->pair;
+    auto& scratch = workspace.buffers_->scratch;
+    trace::Span align_span("align");
+    align_span.arg("score_notes", static_cast<int64_t>(score_notes.size()))
+              .arg("performance_notes", static_cast<int64_t>(performance_notes.size()));
+    
+    stats.clear();
+    scratch.match.combinations_evaluated = 0;
+    const AlignmentPipeline pipeline(config_, *note_matcher_, window_cache_.get());
+    
+    // Steps 1 and 2: coarse DTW and cutting
+    if (!prepared) {
+        pair.own_score.assign(score_notes);
+    }
+    pipeline.coarse_alignment(prepared ? prepared->data_->score : pair.own_score, performance_notes,
+                              pair, scratch, stats);
+    
+    // Step 3: windowed alignments
+    auto t2 = std::chrono::high_resolution_clock::now();
+    pair.window_matches.clear();
+    for (size_t window_id = 0; window_id < pair.windows.size(); ++window_id) {
+        if (window_details) {
+            stats.window_score_notes.push_back(pair.windows.score_offsets[window_id + 1] -
+                                               pair.windows.score_offsets[window_id]);
+            stats.window_performance_notes.push_back(pair.windows.performance_offsets[window_id + 1] -
+                                                     pair.windows.performance_offsets[window_id]);
+        }
+        pipeline.match_window(pair, window_id, scratch, stats, pair.window_matches);
+    }
+    
+    auto t3 = std::chrono::high_resolution_clock::now();
+    stats.stages[AlignmentStats::WINDOW_MATCHING].wall_ns = elapsed_ns(t2, t3);
+    stats.combinations_evaluated = scratch.match.combinations_evaluated;
+    
+    // Step 4: mend windows to global alignment
+    auto global_alignment = pipeline.mend(score_notes, performance_notes, pair, scratch);
+    
+    stats.stages[AlignmentStats::MENDING].wall_ns = elapsed_ns(t3, std::chrono::high_resolution_clock::now());
+    stats.fallback_greedy_matches = scratch.mend.fallback_matches;
+    
+    return global_alignment;
+}
+
+// IncrementalAlignment implementation
+struct IncrementalAlignment::State {
+    const AutomaticNoteMatcher* matcher;
+    PreparedScore score;
+    NoteArray performance_notes;
+    PairBuffers pair;
+    StageScratch scratch;
+    std::vector<size_t> match_offsets;  // Window w matched pair.window_matches[match_offsets[w], match_offsets[w + 1])
+    preprocessors::WindowRows previous_windows;
+    std::vector<WindowMatch> previous_matches;
+    std::vector<size_t> previous_offsets;
+    AlignmentVector alignment;
+    size_t recomputed_windows = 0;
+    
+    State(const AutomaticNoteMatcher& matcher, PreparedScore score, NoteArray performance_notes)
+        : matcher(&matcher), score(std::move(score)), performance_notes(std::move(performance_notes)) {}
+    
+    AlignmentPipeline pipeline() const {
+        return AlignmentPipeline(matcher->config_, *matcher->note_matcher_, matcher->window_cache_.get());
+    }
+    
+    void mend() {
+        alignment = pipeline().mend(score.notes(), performance_notes, pair, scratch);
+    }
+};
+
+IncrementalAlignment::IncrementalAlignment(const AutomaticNoteMatcher& matcher, PreparedScore score,
+                                           NoteArray performance_notes)
+    : state_(std::make_unique<State>(matcher, std::move(score), std::move(performance_notes))) {
+    realign();
+}
+
+IncrementalAlignment::~IncrementalAlignment() = default;
+IncrementalAlignment::IncrementalAlignment(IncrementalAlignment&&) noexcept = default;
+IncrementalAlignment& IncrementalAlignment::operator=(IncrementalAlignment&&) noexcept = default;
+
+const AlignmentVector& IncrementalAlignment::alignment() const {
+    return state_->alignment;
+}
+
+const NoteArray& IncrementalAlignment::performance_notes() const {
+    return state_->performance_notes;
+}
+
+const PreparedScore& IncrementalAlignment::score() const {
+    return state_->score;
+}
+
+size_t IncrementalAlignment::num_windows() const {
+    return state_->pair.windows.size();
+}
+
+size_t IncrementalAlignment::last_recomputed_windows() const {
+    return state_->recomputed_windows;
+}
+
+const AlignmentVector& IncrementalAlignment::realign() {
+    State& state = *state_;
+    const AlignmentPipeline pipeline = state.pipeline();
+    AlignmentStats stats;
+    auto& pair = state.pair;
+    pipeline.coarse_alignment(state.score.data_->score, state.performance_notes, pair, state.scratch, stats);
+    
+    pair.window_matches.clear();
+    state.match_offsets.assign(1, 0);
+    for (size_t window_id = 0; window_id < pair.windows.size(); ++window_id) {
+        pipeline.match_window(pair, window_id, state.scratch, stats, pair.window_matches);
+        state.match_offsets.push_back(pair.window_matches.size());
+    }
+    state.recomputed_windows = pair.windows.size();
+    state.mend();
+    return state.alignment;
+}
+
+const AlignmentVector& IncrementalAlignment::replace_notes(size_t first_row, size_t num_removed,
+                                                           const NoteArray& notes) {
+    State& state = *state_;
+    auto& performance_notes = state.performance_notes;
+    if (first_row > performance_notes.size() || num_removed > performance_notes.size() - first_row) {
+        throw std::out_of_range("IncrementalAlignment: rows " + std::to_string(first_row) + " + " +
+                                std::to_string(num_removed) + " exceed " +
+                                std::to_string(performance_notes.size()) + " performance notes");
+    }
+    performance_notes.erase(performance_notes.begin() + first_row,
+                            performance_notes.begin() + first_row + num_removed);
+    performance_notes.insert(performance_notes.begin() + first_row, notes.begin(), notes.end());
+    
+    // Rows after the edit move by the size change; removed rows map nowhere
+    const size_t end_removed = first_row + num_removed;
+    auto new_row = [&](size_t row) {
+        return row < first_row ? row : row >= end_removed ? row - num_removed + notes.size() : NO_INDEX;
+    };
+    
+    auto& pair = state.pair;
+    std::swap(state.previous_windows, pair.windows);
+    std::swap(state.previous_matches, pair.window_matches);
+    std::swap(state.previous_offsets, state.match_offsets);
+    const auto& old_windows = state.previous_windows;
+    const auto& old_offsets = state.previous_offsets;
+    
+    const AlignmentPipeline pipeline = state.pipeline();
+    AlignmentStats stats;
+    pair.performance.assign(performance_notes);
+    pair.all_perf_rows.resize(performance_notes.size());
+    std::iota(pair.all_perf_rows.begin(), pair.all_perf_rows.end(), 0);
+    pipeline.cut_windows(pair, stats);
+    
+    // A window is unchanged if it holds the same score rows and the moved
+    // performance rows of its previous contents, in the same order
+    const auto& windows = pair.windows;
+    auto unchanged = [&](size_t w) {
+        if (w >= old_windows.size()) return false;
+        size_t score_begin = windows.score_offsets[w], score_end = windows.score_offsets[w + 1];
+        size_t old_score_begin = old_windows.score_offsets[w];
+        if (score_end - score_begin != old_windows.score_offsets[w + 1] - old_score_begin ||
+            !std::equal(windows.score_rows.begin() + score_begin, windows.score_rows.begin() + score_end,
+                        old_windows.score_rows.begin() + old_score_begin)) {
+            return false;
+        }
+        size_t perf_begin = windows.performance_offsets[w], perf_end = windows.performance_offsets[w + 1];
+        size_t old_perf_begin = old_windows.performance_offsets[w];
+        if (perf_end - perf_begin != old_windows.performance_offsets[w + 1] - old_perf_begin) {
+            return false;
+        }
+        for (size_t k = 0; k < perf_end - perf_begin; ++k) {
+            if (new_row(old_windows.performance_rows[old_perf_begin + k]) != windows.performance_rows[perf_begin + k]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    
+    pair.window_matches.clear();
+    state.match_offsets.assign(1, 0);
+    state.recomputed_windows = 0;
+    for (size_t window_id = 0; window_id < windows.size(); ++window_id) {
+        if (unchanged(window_id)) {
+            for (size_t m = old_offsets[window_id]; m < old_offsets[window_id + 1]; ++m) {
+                WindowMatch match = state.previous_matches[m];
+                match.performance_row = new_row(match.performance_row);
+                pair.window_matches.push_back(match);
+            }
+        } else {
+            pipeline.match_window(pair, window_id, state.scratch, stats, pair.window_matches);
+            state.recomputed_windows++;
+        }
+        state.match_offsets.push_back(pair.window_matches.size());
+    }
+    
+    state.mend();
+    return state.alignment;
+}
+
+namespace {
+
+// Windows matched per task in align_batch
+constexpr size_t WINDOWS_PER_TASK = 16;
+
+// A pair in flight in align_batch; recycled between pairs
+struct BatchJob {
+    size_t index = 0;
+    PairBuffers pair;
+    std::vector<std::vector<WindowMatch>> task_matches;  // Per task, in window order
+    std::atomic<size_t> remaining_tasks{0};
+};
+
+} // namespace
+
+void AutomaticNoteMatcher::align_batch(
+    const std::vector<AlignmentPair>& pairs,
+    const BatchCallback& on_result,
+    unsigned int num_threads) const {
+    
+    align_batch(pairs.data(), pairs.size(), on_result, num_threads);
+}
+
+void AutomaticNoteMatcher::align_batch(
+    const AlignmentPair* pairs,
+    size_t num_pairs,
+    const BatchCallback& on_result,
+    unsigned int num_threads) const {
+    
+    for (size_t i = 0; i < num_pairs; ++i) {
+        if (!pairs[i].score_notes || !pairs[i].performance_notes) {
+            throw std::invalid_argument("align_batch: pair " + std::to_string(i) + " has no notes");
+        }
+    }
+    
+    // Largest pairs first, so they do not finish last
+    std::vector<size_t> order(num_pairs);
+    std::iota(order.begin(), order.end(), 0);
+    auto pair_size = [pairs](size_t i) {
+        return pairs[i].score_notes->size() + pairs[i].performance_notes->size();
+    };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return pair_size(a) > pair_size(b); });
+    
+    const AlignmentPipeline pipeline(config_, *note_matcher_, window_cache_.get());
+    parallel::TaskPool pool(num_threads);
+    
+    // Scratch per worker, freed with the batch rather than kept by the
+    // long-lived pool threads
+    std::vector<StageScratch> worker_scratch(pool.num_threads());
+    auto thread_scratch = [&]() -> StageScratch& { return worker_scratch[pool.worker_index()]; };
+    
+    // Pair states, at most one per pair in flight
+    std::mutex jobs_mutex;
+    std::vector<std::unique_ptr<BatchJob>> jobs;
+    std::vector<BatchJob*> free_jobs;
+    auto acquire_job = [&]() {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        if (free_jobs.empty()) {
+            jobs.push_back(std::make_unique<BatchJob>());
+            return jobs.back().get();
+        }
+        BatchJob* job = free_jobs.back();
+        free_jobs.pop_back();
+        return job;
+    };
+    
+    std::mutex callback_mutex;
+    auto finish = [&](BatchJob* job) {
+        const AlignmentPair& input = pairs[job->index];
+        job->pair.window_matches.clear();
+        for (const auto& matches : job->task_matches) {
+            job->pair.window_matches.insert(job->pair.window_matches.end(), matches.begin(), matches.end());
+        }
+        AlignmentVector alignment = pipeline.mend(*input.score_notes, *input.performance_notes,
+                                                  job->pair, thread_scratch());
+        size_t index = job->index;
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            free_jobs.push_back(job);
+        }
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        on_result(index, std::move(alignment));
+    };
+    
+    for (size_t index : order) {
+        pool.submit([&, index]() {
+            BatchJob* job = acquire_job();
+            job->index = index;
+            AlignmentStats stats;
+            job->pair.own_score.assign(*pairs[index].score_notes);
+            pipeline.coarse_alignment(job->pair.own_score, *pairs[index].performance_notes,
+                                      job->pair, thread_scratch(), stats);
+            
+            const size_t num_windows = job->pair.windows.size();
+            const size_t num_tasks = (num_windows + WINDOWS_PER_TASK - 1) / WINDOWS_PER_TASK;
+            if (num_tasks == 0) {
+                job->task_matches.clear();
+                finish(job);
+                return;
+            }
+            job->task_matches.resize(num_tasks);
+            job->remaining_tasks.store(num_tasks);
+            for (size_t task = 0; task < num_tasks; ++task) {
+                pool.spawn([&, job, task, num_windows]() {
+                    AlignmentStats window_stats;
+                    StageScratch& scratch = thread_scratch();
+                    auto& matches = job->task_matches[task];
+                    matches.clear();
+                    size_t end = std::min(num_windows, (task + 1) * WINDOWS_PER_TASK);
+                    for (size_t window_id = task * WINDOWS_PER_TASK; window_id < end; ++window_id) {
+                        pipeline.match_window(job->pair, window_id, scratch, window_stats, matches);
+                    }
+                    if (job->remaining_tasks.fetch_sub(1) == 1) {
+                        finish(job);
+                    }
+                });
+            }
+        });
+    }
+    
+    pool.run();
+}
+
+// Evaluation functions
+namespace evaluation {
+
+namespace {
+
+// Alignment identity viewed in place, without copying the id strings
+struct AlignmentKey {
+    Alignment::Label label;
+    std::string_view score_id;
+    std::string_view performance_id;
+    
+    bool operator==(const AlignmentKey& other) const {
+        return label == other.label && score_id == other.score_id &&
+               performance_id == other.performance_id;
+    }
+};
+
+struct AlignmentKeyHash {
+    size_t operator()(const AlignmentKey& key) const {
+        size_t h = std::hash<std::string_view>()(key.score_id);
+        h ^= std::hash<std::string_view>()(key.performance_id) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h ^ static_cast<size_t>(key.label);
+    }
+};
+
+} // namespace
+
+FScoreResult fscore_alignments(
+    const AlignmentVector& prediction,
+    const AlignmentVector& ground_truth,
+    const std::vector<Alignment::Label>& types,
+    bool return_numbers) {
+    
+    // Label filter as a lookup table
+    bool wanted[3] = {false, false, false};
+    for (auto type : types) {
+        wanted[static_cast<int>(type)] = true;
+    }
+    
+    // Hash the filtered ground truth
+    std::unordered_set<AlignmentKey, AlignmentKeyHash> gt_keys;
+    gt_keys.reserve(ground_truth.size());
+    size_t n_gt_filtered = 0;
+    for (const auto& gt : ground_truth) {
+        if (wanted[static_cast<int>(gt.label)]) {
+            gt_keys.insert({gt.label, gt.score_id, gt.performance_id});
+            n_gt_filtered++;
+        }
+    }
+    
+    // Count correct predictions
+    size_t n_correct = 0;
+    size_t n_pred_filtered = 0;
+    for (const auto& pred : prediction) {
+        if (wanted[static_cast<int>(pred.label)]) {
+            n_pred_filtered++;
+            if (gt_keys.count({pred.label, pred.score_id, pred.performance_id}) > 0) {
+                n_correct++;
+            }
+        }
+    }
+    
+    FScoreResult result;
+    result.n_predicted = n_pred_filtered;
+    result.n_ground_truth = n_gt_filtered;
+    result.n_correct = n_correct;
+    
+    if (n_pred_filtered > 0 || n_gt_filtered > 0) {
+        result.precision = n_pred_filtered > 0 ? static_cast<double>(n_correct) / n_pred_filtered : 0.0;
+        result.recall = n_gt_filtered > 0 ? static_cast<double>(n_correct) / n_gt_filtered : 0.0;
+        result.f_score = (result.precision + result.recall) > 0 ? 
+                        2.0 * result.precision * result.recall / (result.precision + result.recall) : 0.0;
     } else {
         // No predictions and no ground truth -> perfect
         result.precision = result.recall = result.f_score = 1.0;
@@ -512,6 +1876,32 @@ FScoreResult fscore_alignments(
     return result;
 }
 
+std::vector<FScoreResult> fscore_alignments_batch(
+    const std::vector<AlignmentVector>& predictions,
+    const std::vector<AlignmentVector>& ground_truths,
+    const std::vector<Alignment::Label>& types,
+    unsigned int num_threads) {
+    
+    if (predictions.size() != ground_truths.size()) {
+        throw std::invalid_argument("predictions and ground_truths must have the same size");
+    }
+    
+    std::vector<FScoreResult> results(predictions.size());
+    parallel::parallel_for(predictions.size(), num_threads, [&](size_t i) {
+        results[i] = fscore_alignments(predictions[i], ground_truths[i], types);
+    });
+    
+    return results;
+}
+
+std::vector<FScoreResult> fscore_matches_batch(
+    const std::vector<AlignmentVector>& predictions,
+    const std::vector<AlignmentVector>& ground_truths,
+    unsigned int num_threads) {
+    
+    return fscore_alignments_batch(predictions, ground_truths, {Alignment::Label::MATCH}, num_threads);
+}
+
 FScoreResult fscore_matches(
     const AlignmentVector& prediction,
     const AlignmentVector& ground_truth) {
@@ -519,6 +1909,256 @@ FScoreResult fscore_matches(
     return fscore_alignments(prediction, ground_truth, {Alignment::Label::MATCH});
 }
 
+FScoreResult micro_average(const std::vector<FScoreResult>& results) {
+    FScoreResult total{};
+    for (const auto& result : results) {
+        total.n_predicted += result.n_predicted;
+        total.n_ground_truth += result.n_ground_truth;
+        total.n_correct += result.n_correct;
+    }
+    total.precision = total.n_predicted ? static_cast<double>(total.n_correct) / total.n_predicted : 0.0;
+    total.recall = total.n_ground_truth ? static_cast<double>(total.n_correct) / total.n_ground_truth : 0.0;
+    total.f_score = total.precision + total.recall > 0.0 ?
+        2.0 * total.precision * total.recall / (total.precision + total.recall) : 0.0;
+    return total;
+}
+
 } // namespace evaluation
 
-} // namespace parangonar
\ No newline at end of file
+// Parameter sweeps
+namespace sweep {
+
+namespace {
+
+// Windows that different fuzziness settings cut alike are matched once
+constexpr size_t SWEEP_CACHE_ENTRIES = size_t(1) << 14;
+
+// Configurations grouped by the intermediates they share, one level per
+// stage; each group runs its stage with the config of its first member
+struct MatchGroup {
+    size_t config;
+    std::vector<size_t> configs;  // All members, which get the same alignment
+};
+
+struct CutGroup {
+    size_t config;
+    std::vector<MatchGroup> matches;
+};
+
+struct CoarseGroup {
+    size_t config;
+    std::vector<CutGroup> cuts;
+};
+
+std::vector<CoarseGroup> group_configs(const std::vector<AutomaticNoteMatcherConfig>& configs) {
+    std::vector<CoarseGroup> groups;
+    std::map<std::pair<int, int>, size_t> coarse_index;
+    std::map<std::tuple<size_t, float, float, int, bool>, size_t> cut_index;
+    std::map<std::tuple<size_t, size_t, int, bool, int, unsigned int>, size_t> match_index;
+    for (size_t c = 0; c < configs.size(); ++c) {
+        const auto& config = configs[c];
+        auto coarse = coarse_index.emplace(std::make_pair(config.s_time_div, config.p_time_div), groups.size());
+        if (coarse.second) {
+            groups.push_back({c, {}});
+        }
+        const size_t coarse_id = coarse.first->second;
+        auto& cuts = groups[coarse_id].cuts;
+        
+        auto cut = cut_index.emplace(std::make_tuple(coarse_id, config.sfuzziness, config.pfuzziness,
+                                                     config.window_size, config.pfuzziness_relative_to_tempo),
+                                     cuts.size());
+        if (cut.second) {
+            cuts.push_back({c, {}});
+        }
+        const size_t cut_id = cut.first->second;
+        auto& matches = cuts[cut_id].matches;
+        
+        // Types other than greedy and dtw all run the linear matcher
+        int mode = config.alignment_type == "greedy" ? 0 : config.alignment_type == "dtw" ? 1 : 2;
+        auto match = match_index.emplace(std::make_tuple(coarse_id, cut_id, mode, config.shift_onsets,
+                                                         config.cap_combinations, config.random_seed),
+                                         matches.size());
+        if (match.second) {
+            matches.push_back({c, {}});
+        }
+        matches[match.first->second].configs.push_back(c);
+    }
+    return groups;
+}
+
+// Piano rolls of one piece, shared by its coarse alignments
+struct PieceRolls {
+    ScoreData score;
+    NoteColumns performance;
+    std::vector<size_t> all_perf_rows;
+    std::vector<std::pair<int, FlatPianoroll>> performance_rolls;
+    
+    const FlatPianoroll* performance_roll(int time_div) const {
+        for (const auto& [div, roll] : performance_rolls) {
+            if (div == time_div) return &roll;
+        }
+        return nullptr;
+    }
+};
+
+} // namespace
+
+std::vector<AutomaticNoteMatcherConfig> Grid::configs() const {
+    std::vector<AutomaticNoteMatcherConfig> result{base};
+    auto expand = [&result](const auto& values, auto field) {
+        if (values.empty()) return;
+        std::vector<AutomaticNoteMatcherConfig> expanded;
+        expanded.reserve(result.size() * values.size());
+        for (const auto& config : result) {
+            for (const auto& value : values) {
+                expanded.push_back(config);
+                expanded.back().*field = value;
+            }
+        }
+        result = std::move(expanded);
+    };
+    expand(alignment_types, &AutomaticNoteMatcherConfig::alignment_type);
+    expand(s_time_divs, &AutomaticNoteMatcherConfig::s_time_div);
+    expand(p_time_divs, &AutomaticNoteMatcherConfig::p_time_div);
+    expand(sfuzziness, &AutomaticNoteMatcherConfig::sfuzziness);
+    expand(pfuzziness, &AutomaticNoteMatcherConfig::pfuzziness);
+    expand(window_sizes, &AutomaticNoteMatcherConfig::window_size);
+    expand(cap_combinations, &AutomaticNoteMatcherConfig::cap_combinations);
+    return result;
+}
+
+std::vector<Result> run(const std::vector<Piece>& pieces,
+                        const std::vector<AutomaticNoteMatcherConfig>& configs,
+                        unsigned int num_threads) {
+    Stats stats;
+    return run(pieces, configs, stats, num_threads);
+}
+
+std::vector<Result> run(const std::vector<Piece>& pieces,
+                        const std::vector<AutomaticNoteMatcherConfig>& configs,
+                        Stats& stats, unsigned int num_threads) {
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (!pieces[i].score_notes || !pieces[i].performance_notes || !pieces[i].ground_truth) {
+            throw std::invalid_argument("sweep: piece " + std::to_string(i) + " has no notes or ground truth");
+        }
+    }
+    std::set<int> score_divs, performance_divs;
+    for (const auto& config : configs) {
+        if (config.s_time_div <= 0 || config.p_time_div <= 0) {
+            throw std::invalid_argument("sweep: time divisions must be positive");
+        }
+        score_divs.insert(config.s_time_div);
+        performance_divs.insert(config.p_time_div);
+    }
+    
+    std::vector<Result> results(configs.size());
+    for (size_t c = 0; c < configs.size(); ++c) {
+        results[c].config = configs[c];
+        results[c].pieces.resize(pieces.size());
+    }
+    
+    const std::vector<CoarseGroup> groups = group_configs(configs);
+    stats = Stats();
+    for (const auto& coarse : groups) {
+        stats.window_cuts += coarse.cuts.size();
+        for (const auto& cut : coarse.cuts) {
+            stats.alignments += cut.matches.size();
+        }
+    }
+    stats.score_rolls = score_divs.size() * pieces.size();
+    stats.performance_rolls = performance_divs.size() * pieces.size();
+    stats.coarse_alignments = groups.size() * pieces.size();
+    stats.window_cuts *= pieces.size();
+    stats.alignments *= pieces.size();
+    
+    // Largest pieces first, so they do not finish last
+    std::vector<size_t> order(pieces.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto piece_size = [&pieces](size_t i) {
+        return pieces[i].score_notes->size() + pieces[i].performance_notes->size();
+    };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return piece_size(a) > piece_size(b); });
+    
+    // Piece -> rolls -> coarse DTW per time divisions -> windows per cut
+    // settings -> one task per distinct alignment, which mends and evaluates
+    const DynamicTimeWarping dtw;
+    WindowCache window_cache(SWEEP_CACHE_ENTRIES);
+    parallel::TaskPool pool(num_threads);
+    
+    // Scratch per worker, freed with the run
+    std::vector<StageScratch> worker_scratch(pool.num_threads());
+    auto thread_scratch = [&]() -> StageScratch& { return worker_scratch[pool.worker_index()]; };
+    for (size_t index : order) {
+        pool.submit([&, index]() {
+            const Piece& piece = pieces[index];
+            auto rolls = std::make_shared<PieceRolls>();
+            {
+                trace::Span span("sweep_rolls");
+                ScoreData& score = rolls->score;
+                score.assign(*piece.score_notes);
+                score.ids.assign(*piece.score_notes);
+                score.has_ids = true;
+                for (int time_div : score_divs) {
+                    score.rolls.emplace_back(time_div, FlatPianoroll());
+                    build_pianoroll(score.columns, score.all_rows.data(), score.all_rows.size(), time_div,
+                                    score.rolls.back().second);
+                }
+                rolls->performance.assign(*piece.performance_notes);
+                rolls->all_perf_rows.resize(piece.performance_notes->size());
+                std::iota(rolls->all_perf_rows.begin(), rolls->all_perf_rows.end(), 0);
+                for (int time_div : performance_divs) {
+                    rolls->performance_rolls.emplace_back(time_div, FlatPianoroll());
+                    build_pianoroll(rolls->performance, rolls->all_perf_rows.data(), rolls->all_perf_rows.size(),
+                                    time_div, rolls->performance_rolls.back().second);
+                }
+            }
+            
+            for (const CoarseGroup& coarse : groups) {
+                pool.spawn([&, index, rolls, coarse_group = &coarse]() {
+                    const AutomaticNoteMatcherConfig& coarse_config = configs[coarse_group->config];
+                    AlignmentStats stage_stats;
+                    PairBuffers coarse_pair;
+                    AlignmentPipeline(coarse_config, dtw, nullptr)
+                        .coarse_times(rolls->score, *pieces[index].performance_notes, coarse_pair, thread_scratch(),
+                                      stage_stats, rolls->performance_roll(coarse_config.p_time_div));
+                    
+                    for (const CutGroup& cut : coarse_group->cuts) {
+                        auto pair = std::make_shared<PairBuffers>(coarse_pair);
+                        AlignmentPipeline(configs[cut.config], dtw, nullptr).cut_windows(*pair, stage_stats);
+                        
+                        for (const MatchGroup& match : cut.matches) {
+                            pool.spawn([&, index, rolls, pair, match_group = &match]() {
+                                const Piece& piece = pieces[index];
+                                const AlignmentPipeline pipeline(configs[match_group->config], dtw, &window_cache);
+                                StageScratch& scratch = thread_scratch();
+                                AlignmentStats window_stats;
+                                std::vector<WindowMatch> window_matches;
+                                for (size_t window_id = 0; window_id < pair->windows.size(); ++window_id) {
+                                    pipeline.match_window(*pair, window_id, scratch, window_stats, window_matches);
+                                }
+                                AlignmentVector alignment = pipeline.mend(*piece.score_notes, *piece.performance_notes,
+                                                                          rolls->score, window_matches, scratch);
+                                
+                                // Each (config, piece) slot is written by exactly one task
+                                const auto result = evaluation::fscore_matches(alignment, *piece.ground_truth);
+                                for (size_t c : match_group->configs) {
+                                    results[c].pieces[index] = result;
+                                }
+                            });
+                        }
+                    }
+                });
+            }
+        });
+    }
+    pool.run();
+    
+    for (auto& result : results) {
+        result.total = evaluation::micro_average(result.pieces);
+    }
+    return results;
+}
+
+} // namespace sweep
+
+} // namespace parangonar
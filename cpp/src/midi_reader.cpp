@@ -0,0 +1,349 @@
+#include <parangonar/midi_reader.hpp>
+#include <parangonar/mapped_file.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace parangonar {
+
+namespace {
+
+constexpr int NUM_CHANNELS = 16;
+constexpr int NUM_PITCHES = 128;
+constexpr int SUSTAIN_CONTROLLER = 64;
+constexpr int DEFAULT_TEMPO = 500000;  // 120 BPM
+
+// Bounds-checked big-endian reader over the file bytes
+class ByteCursor {
+private:
+    const uint8_t* pos_;
+    const uint8_t* end_;
+    
+public:
+    ByteCursor(const uint8_t* begin, const uint8_t* end) : pos_(begin), end_(end) {}
+    
+    bool done() const { return pos_ >= end_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - pos_); }
+    const uint8_t* position() const { return pos_; }
+    
+    void require(size_t n) const {
+        if (remaining() < n) {
+            throw std::runtime_error("Unexpected end of MIDI data");
+        }
+    }
+    
+    uint8_t peek() const {
+        require(1);
+        return *pos_;
+    }
+    
+    uint8_t u8() {
+        require(1);
+        return *pos_++;
+    }
+    
+    uint16_t u16() {
+        require(2);
+        uint16_t value = static_cast<uint16_t>((pos_[0] << 8) | pos_[1]);
+        pos_ += 2;
+        return value;
+    }
+    
+    uint32_t u32() {
+        require(4);
+        uint32_t value = (static_cast<uint32_t>(pos_[0]) << 24) | (static_cast<uint32_t>(pos_[1]) << 16) |
+                         (static_cast<uint32_t>(pos_[2]) << 8) | static_cast<uint32_t>(pos_[3]);
+        pos_ += 4;
+        return value;
+    }
+    
+    // Variable-length quantity, at most 4 bytes
+    uint32_t vlq() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint8_t byte = u8();
+            value = (value << 7) | (byte & 0x7F);
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Invalid variable-length quantity in MIDI data");
+    }
+    
+    void skip(size_t n) {
+        require(n);
+        pos_ += n;
+    }
+};
+
+struct PendingNote {
+    int64_t tick;
+    int velocity;
+};
+
+struct RawNote {
+    int64_t onset_tick;
+    int64_t offset_tick;
+    int pitch;
+    int velocity;
+    int track;
+    int channel;
+};
+
+struct SustainEvent {
+    int64_t tick;
+    int value;
+};
+
+// Parse one MTrk chunk body, appending notes, tempo changes and pedal events
+void parse_track(ByteCursor cursor, int track, std::vector<RawNote>& notes,
+                 std::vector<TempoChange>& tempos, std::vector<SustainEvent>& sustain) {
+    // Sounding notes per channel and pitch, oldest first
+    std::vector<std::vector<PendingNote>> pending(NUM_CHANNELS * NUM_PITCHES);
+    
+    int64_t tick = 0;
+    uint8_t running_status = 0;
+    
+    auto note_off = [&](int channel, int pitch, int64_t off_tick) {
+        auto& queue = pending[channel * NUM_PITCHES + pitch];
+        if (queue.empty()) {
+            return;  // Unmatched note-off
+        }
+        notes.push_back({queue.front().tick, off_tick, pitch, queue.front().velocity, track, channel});
+        queue.erase(queue.begin());
+    };
+    
+    while (!cursor.done()) {
+        tick += cursor.vlq();
+        
+        uint8_t status = cursor.peek();
+        if (status & 0x80) {
+            cursor.u8();
+        } else if (running_status) {
+            status = running_status;
+        } else {
+            throw std::runtime_error("MIDI data byte without running status");
+        }
+        
+        if (status == 0xFF) {
+            // Meta event
+            running_status = 0;
+            uint8_t type = cursor.u8();
+            uint32_t length = cursor.vlq();
+            cursor.require(length);
+            const uint8_t* data = cursor.position();
+            cursor.skip(length);
+            
+            if (type == 0x51 && length == 3) {
+                TempoChange change;
+                change.tick = tick;
+                change.microseconds_per_quarter = (data[0] << 16) | (data[1] << 8) | data[2];
+                change.track = track;
+                tempos.push_back(change);
+            } else if (type == 0x2F) {
+                break;  // End of track
+            }
+        } else if (status == 0xF0 || status == 0xF7) {
+            // System exclusive
+            running_status = 0;
+            cursor.skip(cursor.vlq());
+        } else if (status >= 0xF0) {
+            throw std::runtime_error("Unexpected system message in MIDI track");
+        } else {
+            running_status = status;
+            int channel = status & 0x0F;
+            
+            switch (status & 0xF0) {
+                case 0x80: {
+                    int pitch = cursor.u8() & 0x7F;
+                    cursor.u8();
+                    note_off(channel, pitch, tick);
+                    break;
+                }
+                case 0x90: {
+                    int pitch = cursor.u8() & 0x7F;
+                    int velocity = cursor.u8() & 0x7F;
+                    if (velocity == 0) {
+                        note_off(channel, pitch, tick);
+                    } else {
+                        pending[channel * NUM_PITCHES + pitch].push_back({tick, velocity});
+                    }
+                    break;
+                }
+                case 0xB0: {
+                    int controller = cursor.u8() & 0x7F;
+                    int value = cursor.u8() & 0x7F;
+                    if (controller == SUSTAIN_CONTROLLER) {
+                        sustain.push_back({tick, value});
+                    }
+                    break;
+                }
+                case 0xC0:
+                case 0xD0:
+                    cursor.skip(1);
+                    break;
+                default:
+                    // Aftertouch and pitch bend
+                    cursor.skip(2);
+                    break;
+            }
+        }
+    }
+    
+    // Close notes left sounding at the end of the track
+    for (int key = 0; key < NUM_CHANNELS * NUM_PITCHES; ++key) {
+        for (const auto& note : pending[key]) {
+            notes.push_back({note.tick, tick, key % NUM_PITCHES, note.velocity, track, key / NUM_PITCHES});
+        }
+    }
+}
+
+// Sort one tempo map, start it at tick 0 and set the time of each change
+void build_tempo_map(std::vector<TempoChange>::iterator first, std::vector<TempoChange>::iterator last,
+                     int track, int ticks_per_quarter, std::vector<TempoChange>& map) {
+    size_t start = map.size();
+    map.insert(map.end(), first, last);
+    std::stable_sort(map.begin() + start, map.end(),
+                     [](const TempoChange& a, const TempoChange& b) { return a.tick < b.tick; });
+    if (map.size() == start || map[start].tick > 0) {
+        TempoChange initial;
+        initial.microseconds_per_quarter = DEFAULT_TEMPO;
+        initial.track = track;
+        map.insert(map.begin() + start, initial);
+    }
+    for (size_t i = start + 1; i < map.size(); ++i) {
+        const TempoChange& previous = map[i - 1];
+        map[i].seconds = previous.seconds +
+            (map[i].tick - previous.tick) * previous.microseconds_per_quarter / (1e6 * std::max(ticks_per_quarter, 1));
+    }
+}
+
+} // namespace
+
+MidiFileData MidiFileReader::read_file(const std::string& filename) {
+    MappedFile file(filename);
+    return parse(file.view());
+}
+
+NoteArray MidiFileReader::read_notes(const std::string& filename) {
+    return read_file(filename).notes;
+}
+
+MidiFileData MidiFileReader::parse(std::string_view bytes) {
+    const auto* begin = reinterpret_cast<const uint8_t*>(bytes.data());
+    ByteCursor cursor(begin, begin + bytes.size());
+    
+    // Header chunk
+    cursor.require(14);
+    if (bytes.compare(0, 4, "MThd") != 0) {
+        throw std::runtime_error("Not a Standard MIDI File");
+    }
+    cursor.skip(4);
+    uint32_t header_length = cursor.u32();
+    if (header_length < 6) {
+        throw std::runtime_error("Invalid MIDI header");
+    }
+    
+    MidiFileData data;
+    data.format = cursor.u16();
+    int declared_tracks = cursor.u16();
+    uint16_t division = cursor.u16();
+    cursor.skip(header_length - 6);
+    
+    double ticks_per_second = 0.0;  // Only used for SMPTE division
+    if (division & 0x8000) {
+        int frames_per_second = -static_cast<int8_t>(division >> 8);
+        int ticks_per_frame = division & 0xFF;
+        double fps = frames_per_second == 29 ? 29.97 : frames_per_second;
+        ticks_per_second = fps * ticks_per_frame;
+        data.ticks_per_quarter = 0;
+        if (ticks_per_second <= 0.0) {
+            throw std::runtime_error("Invalid SMPTE time division");
+        }
+    } else {
+        data.ticks_per_quarter = division;
+        if (division == 0) {
+            throw std::runtime_error("Invalid MIDI time division");
+        }
+    }
+    
+    // Track chunks; other chunk types are skipped
+    std::vector<RawNote> raw_notes;
+    std::vector<TempoChange> tempos;
+    std::vector<SustainEvent> sustain;
+    while (cursor.remaining() >= 8 && data.num_tracks < declared_tracks) {
+        const char* chunk_id = reinterpret_cast<const char*>(cursor.position());
+        cursor.skip(4);
+        // Tolerate a truncated final chunk
+        size_t length = std::min<size_t>(cursor.u32(), cursor.remaining());
+        const uint8_t* body = cursor.position();
+        cursor.skip(length);
+        
+        if (std::string_view(chunk_id, 4) == "MTrk") {
+            parse_track(ByteCursor(body, body + length), data.num_tracks, raw_notes, tempos, sustain);
+            data.num_tracks++;
+        }
+    }
+    
+    // Tempo maps with the time of each change: one global map, or one per
+    // track in format 2; map_begin[t] is where the map timing track t starts
+    std::vector<size_t> map_begin;
+    if (data.format == 2) {
+        std::stable_sort(tempos.begin(), tempos.end(),
+                         [](const TempoChange& a, const TempoChange& b) { return a.track < b.track; });
+        auto first = tempos.begin();
+        for (int track = 0; track < data.num_tracks; ++track) {
+            auto last = std::find_if(first, tempos.end(), [track](const TempoChange& c) { return c.track != track; });
+            map_begin.push_back(data.tempo_map.size());
+            build_tempo_map(first, last, track, data.ticks_per_quarter, data.tempo_map);
+            first = last;
+        }
+    } else {
+        map_begin.push_back(0);
+        build_tempo_map(tempos.begin(), tempos.end(), 0, data.ticks_per_quarter, data.tempo_map);
+    }
+    map_begin.push_back(data.tempo_map.size());
+    
+    auto tick_to_seconds = [&](int64_t tick, int track) {
+        if (ticks_per_second > 0.0) {
+            return tick / ticks_per_second;
+        }
+        size_t map = data.format == 2 ? static_cast<size_t>(track) : 0;
+        auto it = std::upper_bound(data.tempo_map.begin() + map_begin[map],
+                                   data.tempo_map.begin() + map_begin[map + 1], tick,
+                                   [](int64_t t, const TempoChange& change) { return t < change.tick; });
+        const TempoChange& change = *(it - 1);
+        return change.seconds + (tick - change.tick) * change.microseconds_per_quarter / (1e6 * data.ticks_per_quarter);
+    };
+    
+    // Notes in onset order
+    std::stable_sort(raw_notes.begin(), raw_notes.end(), [](const RawNote& a, const RawNote& b) {
+        return a.onset_tick != b.onset_tick ? a.onset_tick < b.onset_tick : a.pitch < b.pitch;
+    });
+    
+    data.notes.resize(raw_notes.size());
+    for (size_t i = 0; i < raw_notes.size(); ++i) {
+        const RawNote& raw = raw_notes[i];
+        Note& note = data.notes[i];
+        double onset_sec = tick_to_seconds(raw.onset_tick, raw.track);
+        note.onset_tick = static_cast<int>(raw.onset_tick);
+        note.duration_tick = static_cast<int>(raw.offset_tick - raw.onset_tick);
+        note.onset_sec = static_cast<float>(onset_sec);
+        note.duration_sec = static_cast<float>(tick_to_seconds(raw.offset_tick, raw.track) - onset_sec);
+        note.pitch = raw.pitch;
+        note.velocity = raw.velocity;
+        note.track = raw.track;
+        note.channel = raw.channel;
+        note.id = "n" + std::to_string(i);
+    }
+    
+    std::stable_sort(sustain.begin(), sustain.end(),
+                     [](const SustainEvent& a, const SustainEvent& b) { return a.tick < b.tick; });
+    data.sustain_pedal.reserve(sustain.size());
+    for (const auto& event : sustain) {
+        data.sustain_pedal.emplace_back(static_cast<int>(event.tick), event.value);
+    }
+    
+    return data;
+}
+
+} // namespace parangonar
@@ -1,6 +1,8 @@
 #include <parangonar/note.hpp>
 #include <algorithm>
+#include <cstdint>
 #include <set>
+#include <stdexcept>
 #include <cmath>
 
 namespace parangonar {
@@ -42,54 +44,181 @@ std::vector<float> onset_times_sec(const NoteArray& notes) {
     return times;
 }
 
-std::vector<std::vector<float>> compute_pianoroll(const NoteArray& notes, int time_div, bool remove_drums) {
-    if (notes.empty()) {
-        return {};
+std::vector<int> pitches(const NoteArray& notes) {
+    std::vector<int> result;
+    result.reserve(notes.size());
+    for (const auto& note : notes) {
+        result.push_back(note.pitch);
+    }
+    return result;
+}
+
+PitchPartition partition_by_pitch(const NoteArray& notes, const std::vector<float>& onsets) {
+    return partition_by_pitch(pitches(notes), onsets);
+}
+
+size_t pitch_range(int min_pitch, int max_pitch) {
+    const int64_t range = static_cast<int64_t>(max_pitch) - min_pitch + 1;
+    if (range > static_cast<int64_t>(MAX_PITCH_RANGE)) {
+        throw std::invalid_argument("Pitch range " + std::to_string(min_pitch) + " to " +
+                                    std::to_string(max_pitch) + " is too wide");
+    }
+    return static_cast<size_t>(range);
+}
+
+PitchPartition partition_by_pitch(const std::vector<int>& pitches, const std::vector<float>& onsets) {
+    PitchPartition partition;
+    partition_by_pitch(pitches, onsets, partition);
+    return partition;
+}
+
+void partition_by_pitch(const std::vector<int>& pitches, const std::vector<float>& onsets, PitchPartition& partition) {
+    partition.pitches.clear();
+    partition.offsets.clear();
+    partition.indices.clear();
+    partition.offsets.push_back(0);
+    if (pitches.empty()) {
+        return;
     }
     
+    auto [min_it, max_it] = std::minmax_element(pitches.begin(), pitches.end());
+    const int min_pitch = *min_it;
+    const int max_pitch = *max_it;
+    
+    // Counting sort by pitch keeps array order within each group; counts[p]
+    // starts as the first slot of pitch p and ends as the slot after its last
+    const size_t num_pitches = pitch_range(min_pitch, max_pitch);
+    auto& counts = partition.counts;
+    counts.assign(num_pitches, 0);
+    for (int pitch : pitches) {
+        counts[pitch - min_pitch]++;
+    }
+    size_t start = 0;
+    for (size_t p = 0; p < num_pitches; ++p) {
+        size_t count = counts[p];
+        counts[p] = start;
+        start += count;
+    }
+    
+    partition.indices.resize(pitches.size());
+    for (size_t i = 0; i < pitches.size(); ++i) {
+        partition.indices[counts[pitches[i] - min_pitch]++] = i;
+    }
+    
+    // Compact to non-empty groups and order each group by onset
+    auto by_onset = [&onsets](size_t i, size_t j) { return onsets[i] < onsets[j]; };
+    size_t group_begin = 0;
+    for (size_t p = 0; p < num_pitches; ++p) {
+        size_t group_end = counts[p];
+        if (group_end == group_begin) continue;
+        
+        auto first = partition.indices.begin() + group_begin;
+        auto last = partition.indices.begin() + group_end;
+        if (group_end - group_begin <= 32) {
+            // Stable insertion sort; avoids stable_sort's temporary buffer
+            for (auto it = first + 1; it < last; ++it) {
+                size_t value = *it;
+                auto hole = it;
+                while (hole > first && by_onset(value, *(hole - 1))) {
+                    *hole = *(hole - 1);
+                    --hole;
+                }
+                *hole = value;
+            }
+        } else {
+            std::stable_sort(first, last, by_onset);
+        }
+        partition.pitches.push_back(min_pitch + static_cast<int>(p));
+        partition.offsets.push_back(group_end);
+        group_begin = group_end;
+    }
+}
+
+void compute_pianoroll(const float* onsets, const float* durations, const int* pitches,
+                       const size_t* rows, size_t num_rows, int time_div, bool remove_drums,
+                       FlatPianoroll& roll) {
+    roll.values.clear();
+    roll.num_pitches = roll.num_steps = 0;
+    roll.min_pitch = 0;
+    
+    auto row_at = [rows](size_t r) { return rows ? rows[r] : r; };
+    
     // Find time range and pitch range
-    float min_time = 0.0f;
     float max_time = 0.0f;
     int min_pitch = 127;
     int max_pitch = 0;
+    bool any = false;
+    for (size_t r = 0; r < num_rows; ++r) {
+        size_t row = row_at(r);
+        if (remove_drums && pitches[row] >= 128) continue;
+        max_time = std::max(max_time, onsets[row] + durations[row]);
+        min_pitch = std::min(min_pitch, pitches[row]);
+        max_pitch = std::max(max_pitch, pitches[row]);
+        any = true;
+    }
+    if (!any) {
+        return;
+    }
     
-    bool use_beat_time = (notes[0].onset_beat != 0.0f || notes[0].duration_beat != 0.0f);
+    const int num_time_steps = static_cast<int>(std::ceil(max_time * time_div)) + 1;
+    roll.num_steps = static_cast<size_t>(num_time_steps);
+    roll.num_pitches = pitch_range(min_pitch, max_pitch);
+    roll.min_pitch = min_pitch;
+    roll.values.assign(roll.num_pitches * roll.num_steps, 0.0f);
     
-    for (const auto& note : notes) {
-        if (remove_drums && note.pitch >= 128) continue;
+    // Fill piano roll
+    for (size_t r = 0; r < num_rows; ++r) {
+        size_t row = row_at(r);
+        if (remove_drums && pitches[row] >= 128) continue;
         
-        float onset = use_beat_time ? note.onset_beat : note.onset_sec;
-        float duration = use_beat_time ? note.duration_beat : note.duration_sec;
+        int start_time = static_cast<int>(onsets[row] * time_div);
+        int end_time = static_cast<int>((onsets[row] + durations[row]) * time_div);
+        float* pitch_row = roll.values.data() + (pitches[row] - min_pitch) * roll.num_steps;
         
-        min_time = std::min(min_time, onset);
-        max_time = std::max(max_time, onset + duration);
-        min_pitch = std::min(min_pitch, note.pitch);
-        max_pitch = std::max(max_pitch, note.pitch);
+        for (int t = std::max(start_time, 0); t <= end_time && t < num_time_steps; ++t) {
+            pitch_row[t] = 1.0f;
+        }
+    }
+}
+
+std::vector<std::vector<float>> time_major(const FlatPianoroll& roll) {
+    std::vector<std::vector<float>> pianoroll(roll.num_steps, std::vector<float>(roll.num_pitches, 0.0f));
+    for (size_t p = 0; p < roll.num_pitches; ++p) {
+        const float* pitch_row = roll.values.data() + p * roll.num_steps;
+        for (size_t t = 0; t < roll.num_steps; ++t) {
+            pianoroll[t][p] = pitch_row[t];
+        }
+    }
+    return pianoroll;
+}
+
+void compute_pianoroll(const NoteArray& notes, int time_div, bool remove_drums, FlatPianoroll& roll) {
+    if (notes.empty()) {
+        compute_pianoroll(nullptr, nullptr, nullptr, nullptr, 0, time_div, remove_drums, roll);
+        return;
     }
     
-    // Create piano roll matrix
-    int num_time_steps = static_cast<int>(std::ceil(max_time * time_div)) + 1;
-    int num_pitches = max_pitch - min_pitch + 1;
-    
-    std::vector<std::vector<float>> pianoroll(num_time_steps, std::vector<float>(num_pitches, 0.0f));
+    bool use_beat_time = (notes[0].onset_beat != 0.0f || notes[0].duration_beat != 0.0f);
     
-    // Fill piano roll
+    std::vector<float> onsets, durations;
+    std::vector<int> pitches;
+    onsets.reserve(notes.size());
+    durations.reserve(notes.size());
+    pitches.reserve(notes.size());
     for (const auto& note : notes) {
-        if (remove_drums && note.pitch >= 128) continue;
-        
-        float onset = use_beat_time ? note.onset_beat : note.onset_sec;
-        float duration = use_beat_time ? note.duration_beat : note.duration_sec;
-        
-        int start_time = static_cast<int>(onset * time_div);
-        int end_time = static_cast<int>((onset + duration) * time_div);
-        int pitch_idx = note.pitch - min_pitch;
-        
-        for (int t = start_time; t <= end_time && t < num_time_steps; ++t) {
-            pianoroll[t][pitch_idx] = 1.0f;
-        }
+        onsets.push_back(use_beat_time ? note.onset_beat : note.onset_sec);
+        durations.push_back(use_beat_time ? note.duration_beat : note.duration_sec);
+        pitches.push_back(note.pitch);
     }
     
-    return pianoroll;
+    compute_pianoroll(onsets.data(), durations.data(), pitches.data(), nullptr, notes.size(), time_div,
+                      remove_drums, roll);
+}
+
+std::vector<std::vector<float>> compute_pianoroll(const NoteArray& notes, int time_div, bool remove_drums) {
+    FlatPianoroll roll;
+    compute_pianoroll(notes, time_div, remove_drums, roll);
+    return time_major(roll);
 }
 
 } // namespace note_array
@@ -0,0 +1,117 @@
+#include <parangonar/note_table.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace parangonar {
+
+// StringPool implementation
+uint32_t StringPool::intern(std::string_view str) {
+    auto it = lookup_.find(str);
+    if (it != lookup_.end()) {
+        return it->second;
+    }
+    
+    uint32_t index = static_cast<uint32_t>(strings_.size());
+    strings_.emplace_back(str);
+    lookup_.emplace(strings_.back(), index);
+    return index;
+}
+
+// NoteTable implementation
+NoteTable::NoteTable(TimeBase time_base, std::shared_ptr<StringPool> id_pool)
+    : time_base(time_base),
+      id_pool(id_pool ? std::move(id_pool) : std::make_shared<StringPool>()) {}
+
+NoteTable NoteTable::from_score(const NoteArray& notes, std::shared_ptr<StringPool> id_pool) {
+    NoteTable table(TimeBase::BEAT, std::move(id_pool));
+    table.reserve(notes.size());
+    for (const auto& note : notes) {
+        table.push_back(note.onset_beat, note.duration_beat, note.pitch, note.velocity, note.id);
+    }
+    return table;
+}
+
+NoteTable NoteTable::from_performance(const NoteArray& notes, std::shared_ptr<StringPool> id_pool) {
+    NoteTable table(TimeBase::SECONDS, std::move(id_pool));
+    table.reserve(notes.size());
+    for (const auto& note : notes) {
+        table.push_back(note.onset_sec, note.duration_sec, note.pitch, note.velocity, note.id);
+    }
+    return table;
+}
+
+NoteArray NoteTable::to_note_array() const {
+    NoteArray notes(size());
+    for (size_t i = 0; i < size(); ++i) {
+        Note& note = notes[i];
+        if (time_base == TimeBase::BEAT) {
+            note.onset_beat = onset[i];
+            note.duration_beat = duration[i];
+        } else {
+            note.onset_sec = onset[i];
+            note.duration_sec = duration[i];
+        }
+        note.pitch = pitch[i];
+        note.velocity = velocity[i];
+        note.id = id_str(i);
+    }
+    return notes;
+}
+
+void NoteTable::reserve(size_t n) {
+    onset.reserve(n);
+    duration.reserve(n);
+    pitch.reserve(n);
+    velocity.reserve(n);
+    id.reserve(n);
+}
+
+void NoteTable::clear() {
+    onset.clear();
+    duration.clear();
+    pitch.clear();
+    velocity.clear();
+    id.clear();
+}
+
+void NoteTable::push_back(float note_onset, float note_duration, int note_pitch, int note_velocity,
+                          std::string_view note_id) {
+    onset.push_back(note_onset);
+    duration.push_back(note_duration);
+    pitch.push_back(note_pitch);
+    velocity.push_back(note_velocity);
+    id.push_back(id_pool->intern(note_id));
+}
+
+NoteTable NoteTable::select(const std::vector<size_t>& rows) const {
+    NoteTable result(time_base, id_pool);
+    result.reserve(rows.size());
+    for (size_t row : rows) {
+        result.onset.push_back(onset[row]);
+        result.duration.push_back(duration[row]);
+        result.pitch.push_back(pitch[row]);
+        result.velocity.push_back(velocity[row]);
+        result.id.push_back(id[row]);
+    }
+    return result;
+}
+
+namespace note_array {
+
+PitchPartition partition_by_pitch(const NoteTable& notes) {
+    return partition_by_pitch(notes.pitch, notes.onset);
+}
+
+void compute_pianoroll(const NoteTable& notes, int time_div, bool remove_drums, FlatPianoroll& roll) {
+    compute_pianoroll(notes.onset.data(), notes.duration.data(), notes.pitch.data(), nullptr, notes.size(),
+                      time_div, remove_drums, roll);
+}
+
+std::vector<std::vector<float>> compute_pianoroll(const NoteTable& notes, int time_div, bool remove_drums) {
+    FlatPianoroll roll;
+    compute_pianoroll(notes, time_div, remove_drums, roll);
+    return time_major(roll);
+}
+
+} // namespace note_array
+} // namespace parangonar
@@ -1,65 +1,45 @@
 #include <parangonar/preprocessors.hpp>
-#include <parangonar/matchers.hpp>
 #include <algorithm>
-#include <set>
-#include <map>
 #include <cmath>
 #include <stdexcept>
 #include <numeric>
-#include <limits>
 
 namespace parangonar {
 namespace preprocessors {
 
-TimeAlignmentVector alignment_times_from_dtw(
-    const NoteArray& score_notes,
-    const NoteArray& performance_notes,
+namespace {
+
+// DTW over pitch-major piano rolls -> sorted, deduplicated alignment times,
+// as AutomaticNoteMatcher computes them
+TimeAlignmentVector alignment_times_from_pianorolls(
+    const note_array::FlatPianoroll& s_pianoroll,
+    const note_array::FlatPianoroll& p_pianoroll,
     const DynamicTimeWarping& matcher,
-    float score_fine_node_length,
     int s_time_div,
     int p_time_div) {
     
-    // Compute piano rolls
-    auto s_pianoroll = note_array::compute_pianoroll(score_notes, s_time_div, false);
-    auto p_pianoroll = note_array::compute_pianoroll(performance_notes, p_time_div, false);
-    
-    // Make performance piano roll binary
-    for (auto& row : p_pianoroll) {
-        for (auto& val : row) {
-            val = (val > 0.0f) ? 1.0f : 0.0f;
-        }
-    }
-    
-    // Transpose piano rolls for DTW (time x pitch -> pitch x time)
-    std::vector<std::vector<float>> s_pianoroll_T, p_pianoroll_T;
-    
-    if (!s_pianoroll.empty() && !s_pianoroll[0].empty()) {
-        s_pianoroll_T.resize(s_pianoroll[0].size());
-        for (size_t i = 0; i < s_pianoroll[0].size(); ++i) {
-            s_pianoroll_T[i].resize(s_pianoroll.size());
-            for (size_t j = 0; j < s_pianoroll.size(); ++j) {
-                s_pianoroll_T[i][j] = s_pianoroll[j][i];
-            }
-        }
-    }
-    
-    if (!p_pianoroll.empty() && !p_pianoroll[0].empty()) {
-        p_pianoroll_T.resize(p_pianoroll[0].size());
-        for (size_t i = 0; i < p_pianoroll[0].size(); ++i) {
-            p_pianoroll_T[i].resize(p_pianoroll.size());
-            for (size_t j = 0; j < p_pianoroll.size(); ++j) {
-                p_pianoroll_T[i][j] = p_pianoroll[j][i];
-            }
-        }
-    }
+    DynamicTimeWarping::Buffers buffers;
+    DTWPath path;
+    matcher.compute_path(s_pianoroll.values.data(), s_pianoroll.num_pitches, s_pianoroll.num_steps,
+                         p_pianoroll.values.data(), p_pianoroll.num_pitches, p_pianoroll.num_steps,
+                         buffers, path);
     
-    // Perform DTW alignment
-    auto dtw_result = matcher.compute(s_pianoroll_T, p_pianoroll_T, true, false);
-    
-    // Convert path to time alignments
     TimeAlignmentVector alignment_times;
+    alignment_times_from_path(path, s_time_div, p_time_div, alignment_times);
+    return alignment_times;
+}
+
+} // namespace
+
+void alignment_times_from_path(
+    const DTWPath& path,
+    int s_time_div,
+    int p_time_div,
+    TimeAlignmentVector& alignment_times) {
     
-    for (const auto& step : dtw_result.path) {
+    // Convert path to time alignments
+    alignment_times.clear();
+    for (const auto& step : path) {
         float score_time = static_cast<float>(step.row) / s_time_div;
         float performance_time = static_cast<float>(step.col) / p_time_div;
         alignment_times.emplace_back(score_time, performance_time);
@@ -79,10 +59,82 @@ TimeAlignmentVector alignment_times_from_dtw(
                    }),
         alignment_times.end()
     );
+}
+
+TimeAlignmentVector alignment_times_from_dtw(
+    const NoteArray& score_notes,
+    const NoteArray& performance_notes,
+    const DynamicTimeWarping& matcher,
+    float score_fine_node_length,
+    int s_time_div,
+    int p_time_div) {
     
-    return alignment_times;
+    // Compute piano rolls
+    note_array::FlatPianoroll s_pianoroll, p_pianoroll;
+    note_array::compute_pianoroll(score_notes, s_time_div, false, s_pianoroll);
+    note_array::compute_pianoroll(performance_notes, p_time_div, false, p_pianoroll);
+    
+    return alignment_times_from_pianorolls(s_pianoroll, p_pianoroll, matcher, s_time_div, p_time_div);
 }
 
+TimeAlignmentVector alignment_times_from_dtw(
+    const NoteTable& score_notes,
+    const NoteTable& performance_notes,
+    const DynamicTimeWarping& matcher,
+    float /*score_fine_node_length*/,
+    int s_time_div,
+    int p_time_div) {
+    
+    note_array::FlatPianoroll s_pianoroll, p_pianoroll;
+    note_array::compute_pianoroll(score_notes, s_time_div, false, s_pianoroll);
+    note_array::compute_pianoroll(performance_notes, p_time_div, false, p_pianoroll);
+    
+    return alignment_times_from_pianorolls(s_pianoroll, p_pianoroll, matcher, s_time_div, p_time_div);
+}
+
+namespace {
+
+// Onset bounds of one window, fuzziness margins included
+struct WindowBounds {
+    float score_start, score_end;
+    float perf_start, perf_end;
+};
+
+// Bounds of window i (alignment_times[i] to alignment_times[i + window_size])
+WindowBounds window_bounds(
+    const TimeAlignmentVector& alignment_times,
+    size_t i,
+    float sfuzziness,
+    float pfuzziness,
+    int window_size,
+    bool pfuzziness_relative_to_tempo) {
+    
+    float window_start_score = alignment_times[i].score_time;
+    float window_end_score = alignment_times[i + window_size].score_time;
+    
+    float window_start_perf = alignment_times[i].performance_time;
+    float window_end_perf = alignment_times[i + window_size].performance_time;
+    
+    // Apply fuzziness
+    float score_margin = sfuzziness;
+    float perf_margin = pfuzziness;
+    
+    if (pfuzziness_relative_to_tempo && i + window_size < alignment_times.size()) {
+        float tempo_ratio = (window_end_perf - window_start_perf) / 
+                           std::max(window_end_score - window_start_score, 1e-6f);
+        perf_margin = pfuzziness * tempo_ratio;
+    }
+    
+    return {window_start_score - score_margin, window_end_score + score_margin,
+            window_start_perf - perf_margin, window_end_perf + perf_margin};
+}
+
+size_t num_windows(const TimeAlignmentVector& alignment_times, int window_size) {
+    return alignment_times.size() - window_size;
+}
+
+} // namespace
+
 std::pair<std::vector<NoteArray>, std::vector<NoteArray>> cut_note_arrays(
     const NoteArray& performance_notes,
     const NoteArray& score_notes,
@@ -102,38 +154,15 @@ std::pair<std::vector<NoteArray>, std::vector<NoteArray>> cut_note_arrays(
         return {score_arrays, performance_arrays};
     }
     
-    // Create interpolator for score time to performance time mapping
-    std::vector<float> score_times, perf_times;
-    for (const auto& align : alignment_times) {
-        score_times.push_back(align.score_time);
-        perf_times.push_back(align.performance_time);
-    }
-    
-    LinearInterpolator interpolator(score_times, perf_times);
-    
     // Cut arrays into windows
-    for (size_t i = 0; i < alignment_times.size() - window_size; ++i) {
-        float window_start_score = alignment_times[i].score_time;
-        float window_end_score = alignment_times[i + window_size].score_time;
-        
-        float window_start_perf = alignment_times[i].performance_time;
-        float window_end_perf = alignment_times[i + window_size].performance_time;
-        
-        // Apply fuzziness
-        float score_margin = sfuzziness;
-        float perf_margin = pfuzziness;
-        
-        if (pfuzziness_relative_to_tempo && i + window_size < alignment_times.size()) {
-            float tempo_ratio = (window_end_perf - window_start_perf) / 
-                               std::max(window_end_score - window_start_score, 1e-6f);
-            perf_margin = pfuzziness * tempo_ratio;
-        }
+    for (size_t i = 0; i < num_windows(alignment_times, window_size); ++i) {
+        auto window = window_bounds(alignment_times, i, sfuzziness, pfuzziness,
+                                    window_size, pfuzziness_relative_to_tempo);
         
         // Filter score notes
         NoteArray window_score_notes;
         for (const auto& note : score_notes) {
-            if (note.onset_beat >= window_start_score - score_margin &&
-                note.onset_beat <= window_end_score + score_margin) {
+            if (note.onset_beat >= window.score_start && note.onset_beat <= window.score_end) {
                 window_score_notes.push_back(note);
             }
         }
@@ -141,8 +170,7 @@ std::pair<std::vector<NoteArray>, std::vector<NoteArray>> cut_note_arrays(
         // Filter performance notes
         NoteArray window_perf_notes;
         for (const auto& note : performance_notes) {
-            if (note.onset_sec >= window_start_perf - perf_margin &&
-                note.onset_sec <= window_end_perf + perf_margin) {
+            if (note.onset_sec >= window.perf_start && note.onset_sec <= window.perf_end) {
                 window_perf_notes.push_back(note);
             }
         }
@@ -154,165 +182,115 @@ std::pair<std::vector<NoteArray>, std::vector<NoteArray>> cut_note_arrays(
     return {score_arrays, performance_arrays};
 }
 
-AlignmentVector mend_note_alignments(
-    const std::vector<AlignmentVector>& note_alignments,
-    const NoteArray& performance_notes,
-    const NoteArray& score_notes,
-    const TimeAlignmentVector& node_times,
-    int max_traversal_depth) {
-    
-    AlignmentVector global_alignment;
-    
-    // Collect all matches, keeping track of conflicts
-    std::map<std::string, std::vector<std::pair<int, std::string>>> score_to_perf_candidates; // score_id -> [(window_id, perf_id)]
-    std::map<std::string, std::vector<std::pair<int, std::string>>> perf_to_score_candidates; // perf_id -> [(window_id, score_id)]
-    std::set<std::string> deleted_scores;
-    std::set<std::string> inserted_perfs;
-    
-    // Collect all potential matches and conflicts
-    for (size_t window_id = 0; window_id < note_alignments.size(); ++window_id) {
-        for (const auto& align : note_alignments[window_id]) {
-            if (align.label == Alignment::Label::MATCH) {
-                score_to_perf_candidates[align.score_id].emplace_back(window_id, align.performance_id);
-                perf_to_score_candidates[align.performance_id].emplace_back(window_id, align.score_id);
-            } else if (align.label == Alignment::Label::DELETION) {
-                deleted_scores.insert(align.score_id);
-            } else if (align.label == Alignment::Label::INSERTION) {
-                inserted_perfs.insert(align.performance_id);
-            }
-        }
+std::pair<std::vector<NoteTable>, std::vector<NoteTable>> cut_note_arrays(
+    const NoteTable& performance_notes,
+    const NoteTable& score_notes,
+    const TimeAlignmentVector& alignment_times,
+    float sfuzziness,
+    float pfuzziness,
+    int window_size,
+    bool pfuzziness_relative_to_tempo) {
+    
+    std::vector<NoteTable> score_tables;
+    std::vector<NoteTable> performance_tables;
+    
+    if (alignment_times.size() < 2) {
+        // Not enough alignment points, return original tables
+        score_tables.push_back(score_notes);
+        performance_tables.push_back(performance_notes);
+        return {score_tables, performance_tables};
     }
     
-    std::set<std::string> used_score_ids;
-    std::set<std::string> used_perf_ids;
-    
-    // Resolve matches, preferring earlier windows for conflicts
-    for (const auto& [score_id, candidates] : score_to_perf_candidates) {
-        if (candidates.size() == 1) {
-            // Unique match - easy case
-            const auto& [window_id, perf_id] = candidates[0];
-            if (perf_to_score_candidates[perf_id].size() == 1) {
-                // Mutual unique match - accept it
-                global_alignment.emplace_back(Alignment::Label::MATCH, score_id, perf_id);
-                used_score_ids.insert(score_id);
-                used_perf_ids.insert(perf_id);
-            } else {
-                // Performance note has multiple score candidates - need to resolve
-                // Choose the candidate from the earliest window
-                const auto& perf_candidates = perf_to_score_candidates[perf_id];
-                int best_window = std::numeric_limits<int>::max();
-                std::string best_score;
-                for (const auto& [win_id, cand_score_id] : perf_candidates) {
-                    if (win_id < best_window && used_score_ids.find(cand_score_id) == used_score_ids.end()) {
-                        best_window = win_id;
-                        best_score = cand_score_id;
-                    }
-                }
-                if (!best_score.empty() && used_perf_ids.find(perf_id) == used_perf_ids.end()) {
-                    global_alignment.emplace_back(Alignment::Label::MATCH, best_score, perf_id);
-                    used_score_ids.insert(best_score);
-                    used_perf_ids.insert(perf_id);
-                }
-            }
-        } else {
-            // Score note has multiple performance candidates - choose the best one
-            // Find the candidate from the earliest window with an available performance note
-            int best_window = std::numeric_limits<int>::max();
-            std::string best_perf;
-            for (const auto& [window_id, perf_id] : candidates) {
-                if (window_id < best_window && used_perf_ids.find(perf_id) == used_perf_ids.end()) {
-                    // Also check if this performance note doesn't have a better score candidate
-                    bool is_best_for_perf = true;
-                    const auto& perf_candidates = perf_to_score_candidates[perf_id];
-                    for (const auto& [other_win_id, other_score_id] : perf_candidates) {
-                        if (other_win_id < window_id && used_score_ids.find(other_score_id) == used_score_ids.end()) {
-                            is_best_for_perf = false;
-                            break;
-                        }
-                    }
-                    if (is_best_for_perf) {
-                        best_window = window_id;
-                        best_perf = perf_id;
-                    }
-                }
-            }
-            if (!best_perf.empty() && used_score_ids.find(score_id) == used_score_ids.end()) {
-                global_alignment.emplace_back(Alignment::Label::MATCH, score_id, best_perf);
-                used_score_ids.insert(score_id);
-                used_perf_ids.insert(best_perf);
+    // Scan the onset columns only; rows are gathered once per window
+    std::vector<size_t> rows;
+    auto select_rows = [&rows](const std::vector<float>& onsets, float start, float end) -> const std::vector<size_t>& {
+        rows.clear();
+        for (size_t i = 0; i < onsets.size(); ++i) {
+            if (onsets[i] >= start && onsets[i] <= end) {
+                rows.push_back(i);
             }
         }
+        return rows;
+    };
+    
+    for (size_t i = 0; i < num_windows(alignment_times, window_size); ++i) {
+        auto window = window_bounds(alignment_times, i, sfuzziness, pfuzziness,
+                                    window_size, pfuzziness_relative_to_tempo);
+        score_tables.push_back(score_notes.select(select_rows(score_notes.onset, window.score_start, window.score_end)));
+        performance_tables.push_back(performance_notes.select(select_rows(performance_notes.onset, window.perf_start, window.perf_end)));
     }
     
-    // Add greedy fallback for unmatched notes with similar pitches nearby
-    SimplestGreedyMatcher greedy_fallback;
+    return {score_tables, performance_tables};
+}
+
+void cut_note_rows(
+    const std::vector<float>& performance_onsets,
+    const std::vector<float>& score_onsets,
+    const TimeAlignmentVector& alignment_times,
+    WindowRows& windows,
+    float sfuzziness,
+    float pfuzziness,
+    int window_size,
+    bool pfuzziness_relative_to_tempo) {
     
-    // Create arrays of unmatched notes
-    NoteArray unmatched_score_notes, unmatched_perf_notes;
-    for (const auto& note : score_notes) {
-        if (used_score_ids.find(note.id) == used_score_ids.end()) {
-            unmatched_score_notes.push_back(note);
-        }
-    }
-    for (const auto& note : performance_notes) {
-        if (used_perf_ids.find(note.id) == used_perf_ids.end()) {
-            unmatched_perf_notes.push_back(note);
-        }
-    }
+    windows.score_offsets.assign(1, 0);
+    windows.performance_offsets.assign(1, 0);
+    windows.score_rows.clear();
+    windows.performance_rows.clear();
     
-    // Try greedy matching on remaining notes
-    if (!unmatched_score_notes.empty() && !unmatched_perf_notes.empty()) {
-        auto fallback_alignment = greedy_fallback(unmatched_score_notes, unmatched_perf_notes);
-        for (const auto& align : fallback_alignment) {
-            if (align.label == Alignment::Label::MATCH) {
-                // Only add if both notes are still unmatched
-                if (used_score_ids.find(align.score_id) == used_score_ids.end() &&
-                    used_perf_ids.find(align.performance_id) == used_perf_ids.end()) {
-                    global_alignment.push_back(align);
-                    used_score_ids.insert(align.score_id);
-                    used_perf_ids.insert(align.performance_id);
-                }
+    auto select_rows = [](const std::vector<float>& onsets, float start, float end,
+                          std::vector<size_t>& rows, std::vector<size_t>& offsets) {
+        for (size_t i = 0; i < onsets.size(); ++i) {
+            if (onsets[i] >= start && onsets[i] <= end) {
+                rows.push_back(i);
             }
         }
-    }
+        offsets.push_back(rows.size());
+    };
     
-    // Add final deletions and insertions for truly unmatched notes
-    for (const auto& note : score_notes) {
-        if (used_score_ids.find(note.id) == used_score_ids.end()) {
-            global_alignment.emplace_back(Alignment::Label::DELETION, note.id);
-        }
+    if (alignment_times.size() < 2) {
+        // Not enough alignment points, one window with all rows
+        windows.score_rows.resize(score_onsets.size());
+        std::iota(windows.score_rows.begin(), windows.score_rows.end(), 0);
+        windows.score_offsets.push_back(score_onsets.size());
+        windows.performance_rows.resize(performance_onsets.size());
+        std::iota(windows.performance_rows.begin(), windows.performance_rows.end(), 0);
+        windows.performance_offsets.push_back(performance_onsets.size());
+        return;
     }
     
-    for (const auto& note : performance_notes) {
-        if (used_perf_ids.find(note.id) == used_perf_ids.end()) {
-            global_alignment.emplace_back(Alignment::Label::INSERTION, "", note.id);
-        }
+    for (size_t i = 0; i < num_windows(alignment_times, window_size); ++i) {
+        auto window = window_bounds(alignment_times, i, sfuzziness, pfuzziness,
+                                    window_size, pfuzziness_relative_to_tempo);
+        select_rows(score_onsets, window.score_start, window.score_end,
+                    windows.score_rows, windows.score_offsets);
+        select_rows(performance_onsets, window.perf_start, window.perf_end,
+                    windows.performance_rows, windows.performance_offsets);
     }
-    
-    return global_alignment;
 }
 
 // LinearInterpolator implementation
-LinearInterpolator::LinearInterpolator(const std::vector<float>& x, const std::vector<float>& y)
-    : x_vals(x), y_vals(y) {
+LinearInterpolator::LinearInterpolator(const std::vector<float>& x, const std::vector<float>& y) {
+    assign(x, y);
+}
+
+void LinearInterpolator::assign(const std::vector<float>& x, const std::vector<float>& y) {
     if (x.size() != y.size() || x.empty()) {
         throw std::invalid_argument("x and y must have the same non-zero size");
     }
     
     // Ensure x values are sorted
-    std::vector<size_t> indices(x.size());
-    std::iota(indices.begin(), indices.end(), 0);
-    std::sort(indices.begin(), indices.end(),
+    sort_order.resize(x.size());
+    std::iota(sort_order.begin(), sort_order.end(), 0);
+    std::sort(sort_order.begin(), sort_order.end(),
               [&x](size_t i, size_t j) { return x[i] < x[j]; });
     
-    std::vector<float> sorted_x(x.size()), sorted_y(x.size());
-    for (size_t i = 0; i < indices.size(); ++i) {
-        sorted_x[i] = x[indices[i]];
-        sorted_y[i] = y[indices[i]];
+    x_vals.resize(x.size());
+    y_vals.resize(x.size());
+    for (size_t i = 0; i < sort_order.size(); ++i) {
+        x_vals[i] = x[sort_order[i]];
+        y_vals[i] = y[sort_order[i]];
     }
-    
-    x_vals = std::move(sorted_x);
-    y_vals = std::move(sorted_y);
 }
 
 float LinearInterpolator::interpolate(float x) const {
@@ -351,13 +329,17 @@ float LinearInterpolator::interpolate(float x) const {
 
 std::vector<float> LinearInterpolator::interpolate(const std::vector<float>& x_points) const {
     std::vector<float> result;
+    interpolate(x_points, result);
+    return result;
+}
+
+void LinearInterpolator::interpolate(const std::vector<float>& x_points, std::vector<float>& result) const {
+    result.clear();
     result.reserve(x_points.size());
     
     for (float x : x_points) {
         result.push_back(interpolate(x));
     }
-    
-    return result;
 }
 
 } // namespace preprocessors
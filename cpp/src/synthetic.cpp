@@ -0,0 +1,267 @@
+#include <parangonar/synthetic.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace parangonar {
+namespace synthetic {
+
+namespace {
+
+constexpr double TWO_PI = 6.283185307179586;
+constexpr double TEMPO_REVERSION = 0.995;  // Pulls the log tempo walk back towards the base tempo
+constexpr int MAX_PITCH = 127;
+
+// Draws computed from the raw engine output, so sequences are reproducible
+// with any standard library
+class Random {
+private:
+    std::mt19937 gen_;
+    bool has_spare_ = false;
+    double spare_ = 0.0;
+    
+public:
+    explicit Random(unsigned int seed) : gen_(seed) {}
+    
+    // Uniform in [0, 1)
+    double uniform() { return gen_() * (1.0 / 4294967296.0); }
+    
+    // Uniform in [low, high]
+    int integer(int low, int high) { return low + static_cast<int>(uniform() * (high - low + 1)); }
+    
+    bool chance(double probability) { return uniform() < probability; }
+    
+    // Standard normal, Box-Muller
+    double normal() {
+        if (has_spare_) {
+            has_spare_ = false;
+            return spare_;
+        }
+        double radius = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+        double angle = TWO_PI * uniform();
+        spare_ = radius * std::sin(angle);
+        has_spare_ = true;
+        return radius * std::cos(angle);
+    }
+};
+
+struct PerformedNote {
+    int64_t onset_tick;
+    int64_t duration_tick;
+    int pitch;
+    int velocity;
+    int64_t score_index;  // -1 for inserted notes
+};
+
+void check_rate(float rate, const char* name) {
+    if (!(rate >= 0.0f && rate <= 1.0f)) {
+        throw std::invalid_argument(std::string("Synthetic performance ") + name + " must be in [0, 1]");
+    }
+}
+
+void validate(const PerformanceConfig& config) {
+    check_rate(config.deletion_rate, "deletion_rate");
+    check_rate(config.insertion_rate, "insertion_rate");
+    check_rate(config.repeated_note_rate, "repeated_note_rate");
+    check_rate(config.trill_rate, "trill_rate");
+    if (!(config.seconds_per_beat > 0.0f) || !(config.min_seconds_per_beat > 0.0f) ||
+        config.min_seconds_per_beat > config.max_seconds_per_beat) {
+        throw std::invalid_argument("Synthetic performance tempo must be positive with min <= max");
+    }
+    if (!(config.rubato_period > 0.0f) || config.tempo_drift < 0.0f || config.onset_jitter < 0.0f ||
+        config.chord_asynchrony < 0.0f || !(config.articulation > 0.0f) || !(config.trill_note_sec > 0.0f)) {
+        throw std::invalid_argument("Synthetic performance timing parameters must be non-negative");
+    }
+    if (config.trill_length < 2) {
+        throw std::invalid_argument("Synthetic performance trill_length must be at least 2");
+    }
+    if (config.min_velocity < 1 || config.max_velocity > 127 || config.min_velocity > config.max_velocity) {
+        throw std::invalid_argument("Synthetic performance velocities must satisfy 1 <= min <= max <= 127");
+    }
+    if (config.midi_clock_units <= 0 || config.midi_clock_rate <= 0) {
+        throw std::invalid_argument("Synthetic performance MIDI clock must be positive");
+    }
+}
+
+} // namespace
+
+NoteArray generate_score(const ScoreConfig& config) {
+    if (config.min_pitch < 0 || config.max_pitch > MAX_PITCH || config.min_pitch > config.max_pitch ||
+        config.max_chord_size < 1 || !(config.grid > 0.0f)) {
+        throw std::invalid_argument("Invalid synthetic score parameters");
+    }
+    
+    Random random(config.seed);
+    NoteArray notes;
+    notes.reserve(config.num_notes);
+    float onset = 0.0f;
+    int pitch = (config.min_pitch + config.max_pitch) / 2;
+    while (notes.size() < config.num_notes) {
+        pitch = std::clamp(pitch + random.integer(-4, 4), config.min_pitch, config.max_pitch);
+        int chord_size = random.integer(1, config.max_chord_size);
+        int chord_pitch = pitch;
+        for (int k = 0; k < chord_size && chord_pitch <= MAX_PITCH && notes.size() < config.num_notes; ++k) {
+            Note note;
+            note.onset_beat = onset;
+            note.duration_beat = config.grid * random.integer(1, 8);
+            note.onset_quarter = note.onset_beat;
+            note.duration_quarter = note.duration_beat;
+            note.onset_div = static_cast<int>(std::lround(note.onset_quarter * note.divs_pq));
+            note.duration_div = static_cast<int>(std::lround(note.duration_quarter * note.divs_pq));
+            note.pitch = chord_pitch;
+            note.id = "n" + std::to_string(notes.size());
+            notes.push_back(std::move(note));
+            chord_pitch += random.integer(3, 9);
+        }
+        onset += config.grid * random.integer(1, 4);
+    }
+    return notes;
+}
+
+SyntheticPerformance generate_performance(const NoteArray& score_notes, const PerformanceConfig& config) {
+    validate(config);
+    for (const auto& note : score_notes) {
+        if (note.id.empty()) {
+            throw std::invalid_argument("Score notes need ids for a ground truth alignment");
+        }
+    }
+    
+    // Score notes in onset order; equal onsets form a chord
+    std::vector<size_t> order(score_notes.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return score_notes[a].onset_beat < score_notes[b].onset_beat;
+    });
+    
+    Random random(config.seed);
+    double ticks_per_second = config.midi_clock_units * 1e6 / config.midi_clock_rate;
+    auto to_ticks = [ticks_per_second](double seconds) {
+        return static_cast<int64_t>(std::llround(seconds * ticks_per_second));
+    };
+    
+    std::vector<PerformedNote> performed;
+    performed.reserve(score_notes.size() + score_notes.size() / 8);
+    auto perform = [&](double onset_sec, double duration_sec, int pitch, int velocity, int64_t score_index) {
+        int64_t onset_tick = to_ticks(std::max(0.0, onset_sec));
+        performed.push_back({onset_tick, std::max<int64_t>(1, to_ticks(duration_sec)), pitch, velocity, score_index});
+    };
+    
+    double log_tempo = 0.0;
+    double seconds_per_beat = config.seconds_per_beat;
+    double time = 0.0;
+    size_t begin = 0;
+    while (begin < order.size()) {
+        float beat = score_notes[order[begin]].onset_beat;
+        size_t end = begin;
+        while (end < order.size() && score_notes[order[end]].onset_beat == beat) {
+            ++end;
+        }
+        
+        // Advance at the tempo of the previous onset, then update the tempo
+        if (begin > 0) {
+            time += (beat - score_notes[order[begin - 1]].onset_beat) * seconds_per_beat;
+            log_tempo = TEMPO_REVERSION * log_tempo + config.tempo_drift * random.normal();
+        }
+        double rubato = 1.0 + config.rubato_depth * std::sin(TWO_PI * beat / config.rubato_period);
+        seconds_per_beat = std::clamp(config.seconds_per_beat * std::exp(log_tempo) * rubato,
+                                      static_cast<double>(config.min_seconds_per_beat),
+                                      static_cast<double>(config.max_seconds_per_beat));
+        double chord_onset = time + config.onset_jitter * random.normal();
+        
+        for (size_t k = begin; k < end; ++k) {
+            const Note& score_note = score_notes[order[k]];
+            int64_t score_index = static_cast<int64_t>(order[k]);
+            if (random.chance(config.deletion_rate)) {
+                continue;
+            }
+            
+            double onset = chord_onset + config.chord_asynchrony * random.normal();
+            double duration = score_note.duration_beat * seconds_per_beat * config.articulation;
+            int velocity = random.integer(config.min_velocity, config.max_velocity);
+            
+            if (random.chance(config.trill_rate)) {
+                // Main note first, then alternating with the upper neighbour
+                int upper = std::min(score_note.pitch + 2, MAX_PITCH);
+                for (int t = 0; t < config.trill_length; ++t) {
+                    perform(onset + t * config.trill_note_sec, config.trill_note_sec,
+                            t % 2 ? upper : score_note.pitch, velocity, t == 0 ? score_index : -1);
+                }
+            } else if (random.chance(config.repeated_note_rate)) {
+                perform(onset, duration / 2, score_note.pitch, velocity, score_index);
+                perform(onset + duration / 2, duration / 2, score_note.pitch, velocity, -1);
+            } else {
+                perform(onset, duration, score_note.pitch, velocity, score_index);
+            }
+            
+            if (random.chance(config.insertion_rate)) {
+                int offset = random.integer(1, 2) * (random.chance(0.5) ? 1 : -1);
+                perform(onset + 0.02 + 0.08 * random.uniform(), duration,
+                        std::clamp(score_note.pitch + offset, 0, MAX_PITCH),
+                        random.integer(config.min_velocity, config.max_velocity), -1);
+            }
+        }
+        begin = end;
+    }
+    
+    std::stable_sort(performed.begin(), performed.end(), [](const PerformedNote& a, const PerformedNote& b) {
+        return a.onset_tick != b.onset_tick ? a.onset_tick < b.onset_tick : a.pitch < b.pitch;
+    });
+    if (!performed.empty() &&
+        performed.back().onset_tick + performed.back().duration_tick > std::numeric_limits<int>::max()) {
+        throw std::invalid_argument("Synthetic performance too long for the tick range");
+    }
+    
+    SyntheticPerformance result;
+    result.info.midi_clock_units = config.midi_clock_units;
+    result.info.midi_clock_rate = config.midi_clock_rate;
+    
+    // Seconds from ticks exactly as the match file parser computes them
+    float mpq = config.midi_clock_rate;
+    float ppq = config.midi_clock_units;
+    std::vector<int64_t> performance_of_score(score_notes.size(), -1);
+    size_t num_insertions = 0;
+    result.performance_notes.resize(performed.size());
+    for (size_t i = 0; i < performed.size(); ++i) {
+        const PerformedNote& source = performed[i];
+        Note& note = result.performance_notes[i];
+        note.onset_tick = static_cast<int>(source.onset_tick);
+        note.duration_tick = static_cast<int>(source.duration_tick);
+        note.onset_sec = (note.onset_tick * mpq / ppq) / 1000000.0f;
+        note.duration_sec = (note.duration_tick * mpq / ppq) / 1000000.0f;
+        note.pitch = source.pitch;
+        note.velocity = source.velocity;
+        note.id = "p" + std::to_string(i);
+        if (source.score_index >= 0) {
+            performance_of_score[source.score_index] = static_cast<int64_t>(i);
+        } else {
+            num_insertions++;
+        }
+    }
+    
+    result.alignment.reserve(score_notes.size() + num_insertions);
+    for (size_t s = 0; s < score_notes.size(); ++s) {
+        if (performance_of_score[s] >= 0) {
+            result.alignment.emplace_back(Alignment::Label::MATCH, score_notes[s].id,
+                                          result.performance_notes[performance_of_score[s]].id);
+        } else {
+            result.alignment.emplace_back(Alignment::Label::DELETION, score_notes[s].id);
+        }
+    }
+    for (size_t i = 0; i < performed.size(); ++i) {
+        if (performed[i].score_index < 0) {
+            result.alignment.emplace_back(Alignment::Label::INSERTION, "", result.performance_notes[i].id);
+        }
+    }
+    
+    return result;
+}
+
+} // namespace synthetic
+} // namespace parangonar
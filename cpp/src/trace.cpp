@@ -0,0 +1,212 @@
+#include <parangonar/trace.hpp>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(PARANGONAR_ENABLE_TRACING)
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace parangonar {
+namespace trace {
+
+#if defined(PARANGONAR_ENABLE_TRACING)
+
+namespace detail {
+std::atomic<bool> recording{false};
+}
+
+namespace {
+
+struct Event {
+    const char* name;
+    int64_t start_ns;
+    int64_t duration_ns;
+    detail::Arg args[detail::MAX_ARGS];
+    int num_args;
+};
+
+// Events of one thread; the lock is only contended while writing
+struct ThreadBuffer {
+    std::mutex mutex;
+    std::vector<Event> events;
+    size_t dropped = 0;
+    int tid = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;  // Outlive their threads until clear()
+    int next_tid = 1;
+    std::atomic<int64_t> epoch_ns{0};
+    std::atomic<size_t> max_events{DEFAULT_MAX_EVENTS_PER_THREAD};
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadBuffer& thread_buffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        buffer->tid = reg.next_tid++;
+        reg.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+// Minimal JSON string escaping for span names and argument keys
+void write_string(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) >= 0x20) {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+void detail::record(const char* name, int64_t start_ns, int64_t end_ns, const Arg* args, int num_args) {
+    ThreadBuffer& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() >= registry().max_events.load(std::memory_order_relaxed)) {
+        buffer.dropped++;
+        return;
+    }
+    Event event;
+    event.name = name;
+    event.start_ns = start_ns;
+    event.duration_ns = end_ns - start_ns;
+    event.num_args = num_args;
+    for (int i = 0; i < num_args; ++i) {
+        event.args[i] = args[i];
+    }
+    buffer.events.push_back(event);
+}
+
+void start(size_t max_events_per_thread) {
+    clear();
+    Registry& reg = registry();
+    reg.max_events.store(max_events_per_thread);
+    reg.epoch_ns.store(detail::now_ns());
+    detail::recording.store(true);
+}
+
+void stop() {
+    detail::recording.store(false);
+}
+
+void clear() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    // Only the registry still references buffers of exited threads
+    reg.buffers.erase(std::remove_if(reg.buffers.begin(), reg.buffers.end(),
+                                     [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                                         return buffer.use_count() == 1;
+                                     }),
+                      reg.buffers.end());
+    for (auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        std::vector<Event>().swap(buffer->events);  // Release the capacity too
+        buffer->dropped = 0;
+    }
+}
+
+size_t num_events() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t count = 0;
+    for (auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+size_t num_dropped_events() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t count = 0;
+    for (auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        count += buffer->dropped;
+    }
+    return count;
+}
+
+void write(std::ostream& out) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    const int64_t epoch_ns = reg.epoch_ns.load();
+    
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    size_t dropped = 0;
+    char number[64];
+    for (auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        dropped += buffer->dropped;
+        for (const auto& event : buffer->events) {
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            first = false;
+            write_string(out, event.name);
+            // Microsecond timestamps with nanosecond precision
+            std::snprintf(number, sizeof(number), "%.3f", (event.start_ns - epoch_ns) / 1e3);
+            out << ",\"cat\":\"parangonar\",\"ph\":\"X\",\"ts\":" << number;
+            std::snprintf(number, sizeof(number), "%.3f", event.duration_ns / 1e3);
+            out << ",\"dur\":" << number << ",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{";
+            for (int i = 0; i < event.num_args; ++i) {
+                if (i > 0) out << ',';
+                write_string(out, event.args[i].key);
+                out << ':' << event.args[i].value;
+            }
+            out << "}}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+}
+
+#else
+
+void start(size_t) {}
+void stop() {}
+void clear() {}
+
+size_t num_events() {
+    return 0;
+}
+
+size_t num_dropped_events() {
+    return 0;
+}
+
+void write(std::ostream& out) {
+    out << "{\"traceEvents\":[],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":0}}\n";
+}
+
+#endif
+
+void write_file(const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+    write(out);
+    if (!out) {
+        throw std::runtime_error("Failed writing trace file: " + filename);
+    }
+}
+
+} // namespace trace
+} // namespace parangonar
@@ -89,7 +89,8 @@ EMSCRIPTEN_BINDINGS(parangonar) {
         .property("window_size", &AutomaticNoteMatcherConfig::window_size)
         .property("pfuzziness_relative_to_tempo", &AutomaticNoteMatcherConfig::pfuzziness_relative_to_tempo)
         .property("shift_onsets", &AutomaticNoteMatcherConfig::shift_onsets)
-        .property("cap_combinations", &AutomaticNoteMatcherConfig::cap_combinations);
+        .property("cap_combinations", &AutomaticNoteMatcherConfig::cap_combinations)
+        .property("random_seed", &AutomaticNoteMatcherConfig::random_seed);
     
     // Register the Alignment enum and class
     enum_<Alignment::Label>("AlignmentLabel")
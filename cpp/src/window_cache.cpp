@@ -0,0 +1,70 @@
+#include <parangonar/window_cache.hpp>
+#include <stdexcept>
+
+namespace parangonar {
+
+WindowCache::WindowCache(size_t max_entries) : max_entries_(max_entries) {
+    if (max_entries == 0) {
+        throw std::invalid_argument("WindowCache needs room for at least one entry");
+    }
+}
+
+uint64_t WindowCache::hash(const Key& key) {
+    // 64-bit FNV-1a over the words, finished with a murmur mix
+    uint64_t h = 14695981039346656037ull;
+    for (uint32_t word : key) {
+        h = (h ^ word) * 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+bool WindowCache::lookup(uint64_t hash, const Key& key, Matches& matches) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(hash);
+    if (it == index_.end() || it->second->key != key) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    matches = it->second->matches;
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void WindowCache::insert(uint64_t hash, const Key& key, const Matches& matches) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(hash);
+    if (it != index_.end()) {
+        // Same window matched concurrently, or a colliding key taking the slot
+        it->second->key = key;
+        it->second->matches = matches;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+    if (entries_.size() >= max_entries_) {
+        index_.erase(entries_.back().hash);
+        entries_.pop_back();
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+    entries_.push_front(Entry{hash, key, matches});
+    index_.emplace(hash, entries_.begin());
+}
+
+size_t WindowCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void WindowCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    hits_.store(0);
+    misses_.store(0);
+    evictions_.store(0);
+}
+
+} // namespace parangonar
@@ -1,8 +1,18 @@
 #include <parangonar/matchers.hpp>
 #include <parangonar/note.hpp>
+#include <parangonar/match_parser.hpp>
+#include <parangonar/match_reader.hpp>
+#include <parangonar/midi_reader.hpp>
+#include <parangonar/match_writer.hpp>
+#include <parangonar/synthetic.hpp>
+#include <parangonar/trace.hpp>
 #include <iostream>
+#include <limits>
 #include <cassert>
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 
 using namespace parangonar;
 
@@ -61,6 +71,34 @@ AlignmentVector create_ground_truth_alignment() {
     return alignment;
 }
 
+bool same_alignment(const AlignmentVector& a, const AlignmentVector& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t k = 0; k < a.size(); ++k) {
+        if (a[k].label != b[k].label || a[k].score_id != b[k].score_id || a[k].performance_id != b[k].performance_id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Synthetic score of num_notes notes and a performance of it, both seeded
+struct SyntheticPair {
+    NoteArray score;
+    synthetic::SyntheticPerformance performance;
+};
+
+SyntheticPair synthetic_pair(size_t num_notes, unsigned int seed = 0) {
+    synthetic::ScoreConfig score_config;
+    score_config.num_notes = num_notes;
+    score_config.seed = seed;
+    synthetic::PerformanceConfig performance_config;
+    performance_config.seed = seed;
+    SyntheticPair pair;
+    pair.score = synthetic::generate_score(score_config);
+    pair.performance = synthetic::generate_performance(pair.score, performance_config);
+    return pair;
+}
+
 void test_note_array() {
     std::cout << "Testing NoteArray..." << std::endl;
     
@@ -82,9 +120,70 @@ void test_note_array() {
     assert(std::abs(onset_times[0] - 0.0f) < 1e-6f);
     assert(std::abs(onset_times[1] - 0.5f) < 1e-6f);
     
+    // Test pitch partitioning (groups ascending by pitch, sorted by onset)
+    NoteArray mixed = {
+        Note::score_note(2.0f, 0.5f, 64, "a"),
+        Note::score_note(1.0f, 0.5f, 60, "b"),
+        Note::score_note(0.0f, 0.5f, 64, "c"),
+        Note::score_note(0.5f, 0.5f, 60, "d")
+    };
+    auto partition = note_array::partition_by_pitch(mixed, note_array::onset_times_beat(mixed));
+    assert(partition.pitches.size() == 2);
+    assert(partition.pitches[0] == 60 && partition.pitches[1] == 64);
+    assert(partition.offsets.size() == 3 && partition.offsets[1] == 2);
+    assert(partition.indices[0] == 3 && partition.indices[1] == 1);
+    assert(partition.indices[2] == 2 && partition.indices[3] == 0);
+    
     std::cout << "NoteArray tests passed!" << std::endl;
 }
 
+void test_note_table() {
+    std::cout << "Testing NoteTable..." << std::endl;
+    
+    auto score_notes = create_test_score_notes();
+    auto perf_notes = create_test_performance_notes();
+    
+    auto score_table = NoteTable::from_score(score_notes);
+    auto perf_table = NoteTable::from_performance(perf_notes);
+    assert(score_table.size() == score_notes.size());
+    assert(perf_table.time_base == NoteTable::TimeBase::SECONDS);
+    
+    // Round trip back to a NoteArray
+    auto round_trip = perf_table.to_note_array();
+    assert(round_trip.size() == perf_notes.size());
+    assert(round_trip[3].id == perf_notes[3].id);
+    assert(round_trip[3].onset_sec == perf_notes[3].onset_sec);
+    assert(round_trip[3].velocity == perf_notes[3].velocity);
+    
+    // Piano roll matches the NoteArray version
+    auto roll = note_array::compute_pianoroll(score_table, 16);
+    auto array_roll = note_array::compute_pianoroll(score_notes, 16);
+    assert(roll == array_roll);
+    
+    // Window cutting selects the same notes
+    TimeAlignmentVector times = {{0.0f, 0.0f}, {2.0f, 2.4f}, {4.0f, 4.8f}};
+    auto [score_windows, perf_windows] = preprocessors::cut_note_arrays(perf_table, score_table, times, 0.5f, 0.5f);
+    auto [score_array_windows, perf_array_windows] = preprocessors::cut_note_arrays(perf_notes, score_notes, times, 0.5f, 0.5f);
+    assert(score_windows.size() == score_array_windows.size());
+    for (size_t w = 0; w < score_windows.size(); ++w) {
+        assert(score_windows[w].size() == score_array_windows[w].size());
+        assert(perf_windows[w].size() == perf_array_windows[w].size());
+        assert(score_windows[w].id_pool == score_table.id_pool);
+    }
+    
+    // Matchers give the same alignment on both layouts
+    SequenceAugmentedGreedyMatcher matcher;
+    auto table_alignment = matcher(score_table, perf_table, times);
+    auto array_alignment = matcher(score_notes, perf_notes, times);
+    assert(table_alignment.size() == array_alignment.size());
+    for (size_t i = 0; i < table_alignment.size(); ++i) {
+        assert(table_alignment[i].score_id == array_alignment[i].score_id);
+        assert(table_alignment[i].performance_id == array_alignment[i].performance_id);
+    }
+    
+    std::cout << "NoteTable tests passed!" << std::endl;
+}
+
 void test_dtw() {
     std::cout << "Testing DTW..." << std::endl;
     
@@ -126,6 +225,49 @@ void test_simple_greedy_matcher() {
     std::cout << "Simple greedy matcher found " << match_count << " matches" << std::endl;
     assert(match_count <= 8); // Should match all or some notes
     
+    // Repeated pitches are consumed in performance order
+    NoteArray repeated_score = {
+        Note::score_note(0.0f, 0.5f, 60, "s0"),
+        Note::score_note(0.5f, 0.5f, 62, "s1"),
+        Note::score_note(1.0f, 0.5f, 60, "s2"),
+        Note::score_note(1.5f, 0.5f, 60, "s3")
+    };
+    NoteArray repeated_perf = {
+        Note::performance_note(0.0f, 0.4f, 60, 70, "p0"),
+        Note::performance_note(0.5f, 0.4f, 64, 70, "p1"),
+        Note::performance_note(1.0f, 0.4f, 60, 70, "p2")
+    };
+    auto repeated_alignment = matcher(repeated_score, repeated_perf);
+    assert(repeated_alignment.size() == 5);
+    assert(repeated_alignment[0].performance_id == "p0");
+    assert(repeated_alignment[1].label == Alignment::Label::DELETION);
+    assert(repeated_alignment[2].performance_id == "p2");
+    assert(repeated_alignment[3].label == Alignment::Label::DELETION);
+    assert(repeated_alignment[4].label == Alignment::Label::INSERTION);
+    assert(repeated_alignment[4].performance_id == "p1");
+    
+    // Pitches outside MIDI still match; a range that would overflow int is rejected
+    NoteArray wide_perf = {
+        Note::performance_note(0.0f, 0.4f, -500, 70, "p0"),
+        Note::performance_note(0.5f, 0.4f, 60, 70, "p1"),
+        Note::performance_note(1.0f, 0.4f, 900, 70, "p2")
+    };
+    auto wide_alignment = matcher({Note::score_note(0.0f, 0.5f, 900, "s0")}, wide_perf);
+    if (wide_alignment.size() != 3 || wide_alignment[0].performance_id != "p2") {
+        throw std::runtime_error("greedy matcher lost a pitch outside the MIDI range");
+    }
+    wide_perf[0].pitch = std::numeric_limits<int>::min();
+    wide_perf[2].pitch = std::numeric_limits<int>::max();
+    bool threw = false;
+    try {
+        matcher(repeated_score, wide_perf);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    if (!threw) {
+        throw std::runtime_error("greedy matcher accepted a pitch range that overflows int");
+    }
+    
     std::cout << "SimplestGreedyMatcher tests passed!" << std::endl;
 }
 
@@ -174,6 +316,182 @@ void test_automatic_note_matcher() {
     std::cout << "AutomaticNoteMatcher tests passed!" << std::endl;
 }
 
+void test_seeded_combination_sampling() {
+    std::cout << "Testing seeded combination sampling..." << std::endl;
+    
+    // Many repeated score notes against few performance notes forces sampling
+    NoteArray score_notes, perf_notes;
+    for (int i = 0; i < 24; ++i) {
+        score_notes.push_back(Note::score_note(i * 0.5f, 0.4f, 60, "s" + std::to_string(i)));
+    }
+    for (int i = 0; i < 12; ++i) {
+        perf_notes.push_back(Note::performance_note(i * 1.1f, 0.4f, 60, 70, "p" + std::to_string(i)));
+    }
+    
+    TimeAlignmentVector times = {{0.0f, 0.0f}, {12.0f, 12.0f}};
+    
+    SequenceAugmentedGreedyMatcher matcher;
+    auto first = matcher(score_notes, perf_notes, times, false, 50, 7);
+    auto second = matcher(score_notes, perf_notes, times, false, 50, 7);
+    
+    assert(first.size() == second.size());
+    for (size_t i = 0; i < first.size(); ++i) {
+        assert(first[i].label == second[i].label);
+        assert(first[i].score_id == second[i].score_id);
+        assert(first[i].performance_id == second[i].performance_id);
+    }
+    
+    std::cout << "Seeded combination sampling tests passed!" << std::endl;
+}
+
+void test_match_parser() {
+    std::cout << "Testing match file parsing..." << std::endl;
+    
+    const std::string contents =
+        "info(matchFileVersion,5.0).\n"
+        "info(midiClockUnits,480).\r\n"
+        "info(keySignature,[C Maj/A min]).\n"
+        "snote(n1,[C,n],4,1:1,0,1/4,0.0,1.0,[])-note(n0,[C,n],4,480,960,960,64).\n"
+        "snote(n2,[E,b],4,1:2,1/8,3/8,1.5,3.0,[staccato,grace])-deletion.\n"
+        "insertion-note(n5,[F,#],5,1000,1100,1100,40).\n"
+        "sustain(3316,67).\n"
+        "meta(timeSignature,2/4,1,0.0).\n";
+    
+    auto data = MatchFileParser::parse_string(contents);
+    assert(data.info.midi_clock_units == 480);
+    assert(data.info.key_signature == "C Maj/A min");
+    assert(data.matches.size() == 3);
+    assert(data.sustain_pedal.size() == 1 && data.sustain_pedal[0].second == 67);
+    
+    const auto& deletion = data.matches[1];
+    assert(deletion.type == MatchLine::DELETION);
+    assert(deletion.score_note.measure == "1:2");
+    assert(std::abs(deletion.score_note.duration - 0.375f) < 1e-6f);
+    assert(deletion.score_note.attributes.size() == 2);
+    assert(deletion.score_note.attributes[1] == "grace");
+    (void)deletion;
+    
+    auto [score_notes, perf_notes] = MatchFileParser::to_note_arrays(data);
+    assert(score_notes.size() == 2 && perf_notes.size() == 2);
+    assert(score_notes[1].pitch == 63);
+    assert(perf_notes[1].pitch == 78);
+    
+    // Streaming through a buffer smaller than a line gives the same notes
+    std::istringstream stream(contents);
+    MatchStreamReader reader(16);
+    NoteArrayBuilder builder;
+    reader.read_stream(stream, builder);
+    assert(builder.score_notes.size() == score_notes.size());
+    assert(builder.performance_notes.size() == perf_notes.size());
+    for (size_t i = 0; i < perf_notes.size(); ++i) {
+        assert(builder.score_notes[i].id == score_notes[i].id);
+        assert(builder.score_notes[i].pitch == score_notes[i].pitch);
+        assert(builder.performance_notes[i].onset_sec == perf_notes[i].onset_sec);
+    }
+    assert(builder.alignment.size() == 3);
+    assert(builder.alignment[2].label == Alignment::Label::INSERTION);
+    assert(builder.sustain_pedal.size() == 1);
+    
+    // Fused loader matches the three-pass conversion
+    auto fused = MatchFileParser::load_notes_string(contents, true);
+    assert(fused.score_notes.size() == 2 && fused.performance_notes.size() == 2);
+    assert(fused.score_notes[1].pitch == 63);
+    assert(fused.performance_notes[0].onset_sec == perf_notes[0].onset_sec);
+    assert(fused.alignment.size() == 3);
+    assert(fused.score_attributes.size() == 2 && fused.score_attributes[1][0] == "staccato");
+    assert(MatchFileParser::load_notes_string(contents).score_attributes.empty());
+    
+    NoteTableBuilder table_builder;
+    MatchStreamReader::read_string(contents, table_builder);
+    assert(table_builder.score_notes.size() == 2);
+    assert(table_builder.performance_notes.id_str(1) == "n5");
+    
+    // Clock info after the notes applies to all of them, as in to_note_arrays
+    const std::string late_info = contents + "info(midiClockRate,250000).\n";
+    auto late_arrays = MatchFileParser::to_note_arrays(MatchFileParser::parse_string(late_info)).second;
+    auto late_fused = MatchFileParser::load_notes_string(late_info).performance_notes;
+    NoteTableBuilder late_table;
+    MatchStreamReader::read_string(late_info, late_table);
+    assert(late_arrays[0].onset_sec != perf_notes[0].onset_sec);
+    for (size_t i = 0; i < late_arrays.size(); ++i) {
+        assert(late_fused[i].onset_sec == late_arrays[i].onset_sec);
+        assert(late_fused[i].duration_sec == late_arrays[i].duration_sec);
+        assert(late_table.performance_notes.onset[i] == late_arrays[i].onset_sec);
+        assert(late_table.performance_notes.duration[i] == late_arrays[i].duration_sec);
+    }
+    
+    std::cout << "Match file parsing tests passed!" << std::endl;
+}
+
+void test_midi_reader() {
+    std::cout << "Testing MIDI file reading..." << std::endl;
+    
+    auto chunk = [](const char* id, const std::vector<unsigned char>& body) {
+        std::string bytes(id, 4);
+        uint32_t length = static_cast<uint32_t>(body.size());
+        for (int shift = 24; shift >= 0; shift -= 8) bytes += static_cast<char>((length >> shift) & 0xFF);
+        bytes.append(body.begin(), body.end());
+        return bytes;
+    };
+    
+    // Format 1, 480 ticks per quarter: a tempo track and a note track
+    std::string midi = chunk("MThd", {0, 1, 0, 2, 0x01, 0xE0});
+    midi += chunk("MTrk", {
+        0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20,     // 120 BPM
+        0x83, 0x60, 0xFF, 0x51, 0x03, 0x0F, 0x42, 0x40, // 60 BPM at tick 480
+        0x00, 0xFF, 0x2F, 0x00});
+    midi += chunk("MTrk", {
+        0x00, 0x91, 60, 100,          // Note on, channel 1
+        0x00, 64, 90,                 // Running status
+        0x00, 0xB1, 64, 127,          // Sustain down
+        0x83, 0x60, 0x91, 60, 0,      // Velocity 0 note off at tick 480
+        0x83, 0x60, 0x81, 64, 0,      // Note off at tick 960
+        0x00, 0xFF, 0x2F, 0x00});
+    
+    auto data = MidiFileReader::parse(midi);
+    assert(data.format == 1 && data.num_tracks == 2);
+    assert(data.ticks_per_quarter == 480);
+    assert(data.tempo_map.size() == 2);
+    assert(data.notes.size() == 2);
+    assert(data.sustain_pedal.size() == 1 && data.sustain_pedal[0].second == 127);
+    
+    const Note& c4 = data.notes[0];
+    assert(c4.pitch == 60 && c4.velocity == 100 && c4.track == 1 && c4.channel == 1);
+    assert(c4.onset_tick == 0 && c4.duration_tick == 480);
+    
+    // The second half of the E4 is at 60 BPM
+    const Note& e4 = data.notes[1];
+    assert(e4.pitch == 64 && e4.duration_tick == 960);
+    if (std::abs(c4.duration_sec - 0.5f) > 1e-6f || std::abs(e4.duration_sec - 1.5f) > 1e-6f) {
+        throw std::runtime_error("format 1 notes not timed by the global tempo map");
+    }
+    
+    // Format 2: each track is timed by its own tempo changes
+    std::string patterns = chunk("MThd", {0, 2, 0, 2, 0x01, 0xE0});
+    patterns += chunk("MTrk", {
+        0x00, 0xFF, 0x51, 0x03, 0x0F, 0x42, 0x40,     // 60 BPM
+        0x00, 0x90, 60, 100,
+        0x83, 0x60, 0x80, 60, 0,                      // One quarter: 1 s
+        0x00, 0xFF, 0x2F, 0x00});
+    patterns += chunk("MTrk", {
+        0x00, 0x90, 67, 100,
+        0x83, 0x60, 0x80, 67, 0,                      // One quarter at 120 BPM: 0.5 s
+        0x00, 0xFF, 0x2F, 0x00});
+    auto pattern_data = MidiFileReader::parse(patterns);
+    if (pattern_data.format != 2 || pattern_data.tempo_map.size() != 2 || pattern_data.notes.size() != 2 ||
+        pattern_data.tempo_map[1].track != 1 || pattern_data.tempo_map[1].microseconds_per_quarter != 500000) {
+        throw std::runtime_error("format 2 tempo maps are not per track");
+    }
+    for (const Note& note : pattern_data.notes) {
+        float expected = note.track == 0 ? 1.0f : 0.5f;
+        if (note.onset_sec != 0.0f || std::abs(note.duration_sec - expected) > 1e-6f) {
+            throw std::runtime_error("format 2 note timed with another track's tempo");
+        }
+    }
+    
+    std::cout << "MIDI file reading tests passed!" << std::endl;
+}
+
 void test_evaluation() {
     std::cout << "Testing evaluation functions..." << std::endl;
     
@@ -202,18 +520,410 @@ void test_evaluation() {
     std::cout << "Imperfect alignment F-score: " << imperfect_result.f_score << std::endl;
     assert(imperfect_result.f_score < 1.0); // Should be less than perfect
     
+    // Batch evaluation matches the single-pair results
+    auto batch = evaluation::fscore_matches_batch({perfect_pred, imperfect_pred}, {perfect_gt, perfect_gt}, 2);
+    assert(batch.size() == 2);
+    assert(std::abs(batch[0].f_score - result.f_score) < 1e-12);
+    assert(std::abs(batch[1].f_score - imperfect_result.f_score) < 1e-12);
+    assert(batch[1].n_predicted == 2 && batch[1].n_ground_truth == 2);
+    
+    // Micro-average over the exact counts: 3 of 4 predictions are correct
+    auto total = evaluation::micro_average(batch);
+    if (total.n_correct != 3 || total.n_predicted != 4 || total.precision != 0.75 || total.recall != 0.75) {
+        throw std::runtime_error("micro-average does not sum the exact counts");
+    }
+    
     std::cout << "Evaluation tests passed!" << std::endl;
 }
 
+void test_synthetic_performance() {
+    std::cout << "Testing synthetic performances..." << std::endl;
+    
+    synthetic::ScoreConfig score_config;
+    score_config.num_notes = 400;
+    score_config.seed = 3;
+    NoteArray score = synthetic::generate_score(score_config);
+    assert(score.size() == 400);
+    
+    synthetic::PerformanceConfig config;
+    config.seed = 5;
+    config.repeated_note_rate = 0.02f;
+    config.trill_rate = 0.02f;
+    auto first = synthetic::generate_performance(score, config);
+    auto second = synthetic::generate_performance(score, config);
+    assert(first.performance_notes.size() == second.performance_notes.size());
+    for (size_t i = 0; i < first.performance_notes.size(); ++i) {
+        assert(first.performance_notes[i].onset_tick == second.performance_notes[i].onset_tick);
+        assert(first.performance_notes[i].pitch == second.performance_notes[i].pitch);
+    }
+    
+    // Ground truth accounts for every score and performance note once
+    size_t matches = 0, deletions = 0, insertions = 0;
+    for (const auto& align : first.alignment) {
+        matches += align.label == Alignment::Label::MATCH;
+        deletions += align.label == Alignment::Label::DELETION;
+        insertions += align.label == Alignment::Label::INSERTION;
+    }
+    assert(matches + deletions == score.size());
+    assert(matches + insertions == first.performance_notes.size());
+    assert(deletions > 0 && insertions > 0);
+    
+    // Survives a match file round trip
+    std::string text = MatchFileWriter().to_string(first.info, score, first.performance_notes, first.alignment);
+    auto loaded = MatchFileParser::load_notes_string(text);
+    assert(loaded.performance_notes.size() == first.performance_notes.size());
+    for (const auto& note : loaded.performance_notes) {
+        const Note& original = first.performance_notes[std::stoul(note.id.substr(1))];
+        assert(note.onset_sec == original.onset_sec && note.duration_sec == original.duration_sec);
+        (void)original;
+    }
+    assert(evaluation::fscore_matches(loaded.alignment, first.alignment).f_score == 1.0);
+    
+    // With timing noise only, the matcher recovers the ground truth
+    synthetic::PerformanceConfig timing_only;
+    timing_only.deletion_rate = 0.0f;
+    timing_only.insertion_rate = 0.0f;
+    auto clean = synthetic::generate_performance(score, timing_only);
+    AutomaticNoteMatcher matcher;
+    auto result = evaluation::fscore_matches(matcher(score, clean.performance_notes), clean.alignment);
+    std::cout << "Synthetic performance F-score: " << result.f_score << std::endl;
+    assert(result.f_score > 0.95);
+    
+    std::cout << "Synthetic performance tests passed!" << std::endl;
+}
+
+void test_align_batch() {
+    std::cout << "Testing batch alignment..." << std::endl;
+    
+    // Pairs of very different sizes, so windows of the large ones get stolen
+    std::vector<NoteArray> scores;
+    std::vector<NoteArray> performances;
+    for (size_t num_notes : {1500, 40, 600, 0, 200}) {
+        auto pair = synthetic_pair(num_notes, static_cast<unsigned int>(num_notes));
+        scores.push_back(std::move(pair.score));
+        performances.push_back(std::move(pair.performance.performance_notes));
+    }
+    std::vector<AlignmentPair> pairs;
+    for (size_t i = 0; i < scores.size(); ++i) {
+        pairs.push_back({&scores[i], &performances[i]});
+    }
+    
+    AutomaticNoteMatcher matcher;
+    std::vector<AlignmentVector> results(pairs.size());
+    std::vector<int> delivered(pairs.size(), 0);
+    matcher.align_batch(pairs, [&](size_t index, AlignmentVector&& alignment) {
+        delivered[index]++;
+        results[index] = std::move(alignment);
+    }, 3);
+    
+    // Same alignments as one pair at a time
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (delivered[i] != 1 || !same_alignment(results[i], matcher(scores[i], performances[i]))) {
+            throw std::runtime_error("batch alignment of pair " + std::to_string(i) + " differs");
+        }
+    }
+    
+    std::cout << "Batch alignment tests passed!" << std::endl;
+}
+
+void test_prepared_score() {
+    std::cout << "Testing prepared scores..." << std::endl;
+    
+    const NoteArray score = synthetic_pair(500).score;
+    AutomaticNoteMatcher matcher;
+    const PreparedScore prepared = matcher.prepare_score(score);
+    const PreparedScore other_resolution(score, {8});
+    if (prepared.notes().size() != score.size() || prepared.capacity_bytes() == 0) {
+        throw std::runtime_error("prepared score does not hold the score");
+    }
+    
+    AlignmentWorkspace workspace;
+    for (unsigned int seed = 0; seed < 3; ++seed) {
+        synthetic::PerformanceConfig config;
+        config.seed = seed;
+        auto performance = synthetic::generate_performance(score, config).performance_notes;
+        auto expected = matcher(score, performance);
+        
+        // Same alignment with a prepared roll, and without one for s_time_div
+        for (const auto* source : {&prepared, &other_resolution}) {
+            if (!same_alignment(matcher.align(*source, performance, workspace), expected)) {
+                throw std::runtime_error("prepared score alignment differs for seed " + std::to_string(seed));
+            }
+        }
+    }
+    
+    std::cout << "Prepared score tests passed!" << std::endl;
+}
+
+void test_public_pipeline() {
+    std::cout << "Testing the public preprocessing pipeline..." << std::endl;
+    
+    const auto [score, synthetic_performance] = synthetic_pair(400);
+    const NoteArray& performance = synthetic_performance.performance_notes;
+    
+    // The preprocessors chained as the matcher once did share its piano
+    // rolls and mending, so they must give its alignment
+    for (const char* alignment_type : {"dtw", "greedy"}) {
+        AutomaticNoteMatcher::Config config = AutomaticNoteMatcher().get_config();
+        config.alignment_type = alignment_type;
+        const DynamicTimeWarping dtw;
+        
+        auto init_times = preprocessors::alignment_times_from_dtw(score, performance, dtw, 4.0f,
+                                                                  config.s_time_div, config.p_time_div);
+        auto [score_windows, performance_windows] = preprocessors::cut_note_arrays(
+            performance, score, init_times, config.sfuzziness, config.pfuzziness, config.window_size,
+            config.pfuzziness_relative_to_tempo);
+        
+        std::vector<AlignmentVector> window_alignments;
+        for (size_t w = 0; w < score_windows.size(); ++w) {
+            if (config.alignment_type == "greedy") {
+                window_alignments.push_back(SimplestGreedyMatcher()(score_windows[w], performance_windows[w]));
+                continue;
+            }
+            TimeAlignmentVector times;
+            if (!score_windows[w].empty() && !performance_windows[w].empty()) {
+                times = preprocessors::alignment_times_from_dtw(score_windows[w], performance_windows[w], dtw,
+                                                                config.score_fine_node_length,
+                                                                config.s_time_div, config.p_time_div);
+            }
+            window_alignments.push_back(SequenceAugmentedGreedyMatcher()(
+                score_windows[w], performance_windows[w], times, config.shift_onsets, config.cap_combinations,
+                config.random_seed));
+        }
+        auto mended = preprocessors::mend_note_alignments(window_alignments, performance, score, init_times);
+        
+        if (!same_alignment(mended, AutomaticNoteMatcher(config)(score, performance))) {
+            throw std::runtime_error(std::string("Public pipeline differs from the matcher for ") + alignment_type);
+        }
+    }
+    
+    std::cout << "Public pipeline tests passed!" << std::endl;
+}
+
+void test_incremental_alignment() {
+    std::cout << "Testing incremental alignment..." << std::endl;
+    
+    const auto [score, synthetic_performance] = synthetic_pair(600);
+    const NoteArray& performance = synthetic_performance.performance_notes;
+    
+    // Narrow windows, so one note lies in only some of them
+    AutomaticNoteMatcher::Config config;
+    config.sfuzziness = 1.0f;
+    config.pfuzziness = 1.0f;
+    AutomaticNoteMatcher matcher(config);
+    const PreparedScore prepared = matcher.prepare_score(score);
+    IncrementalAlignment incremental(matcher, prepared, performance);
+    const AlignmentVector original = incremental.alignment();
+    if (!same_alignment(original, matcher.align(prepared, performance)) ||
+        incremental.last_recomputed_windows() != incremental.num_windows()) {
+        throw std::runtime_error("incremental alignment differs from a full run");
+    }
+    
+    // Fix a wrong pitch: only the windows holding the note are matched
+    // again, and the result equals a full run on the edited notes
+    const size_t row = 4;
+    NoteArray edited_performance = performance;
+    edited_performance[row].pitch += 1;
+    const AlignmentVector edited = incremental.replace_notes(row, 1, {edited_performance[row]});
+    if (incremental.last_recomputed_windows() == 0 ||
+        incremental.last_recomputed_windows() >= incremental.num_windows()) {
+        throw std::runtime_error("a pitch fix recomputed " + std::to_string(incremental.last_recomputed_windows()) +
+                                 " of " + std::to_string(incremental.num_windows()) + " windows");
+    }
+    if (!same_alignment(edited, matcher.align(prepared, edited_performance))) {
+        throw std::runtime_error("incremental alignment after an edit differs from a full run");
+    }
+    
+    // Same after an inserted note
+    Note inserted = performance[row];
+    inserted.id = "inserted";
+    incremental.replace_notes(row, 1, {performance[row]});
+    const AlignmentVector with_insertion = incremental.replace_notes(row, 0, {inserted});
+    NoteArray inserted_performance = performance;
+    inserted_performance.insert(inserted_performance.begin() + row, inserted);
+    if (incremental.performance_notes().size() != performance.size() + 1 ||
+        !same_alignment(with_insertion, matcher.align(prepared, inserted_performance))) {
+        throw std::runtime_error("incremental alignment after an insertion differs from a full run");
+    }
+    
+    // Undoing the edits restores the original alignment
+    incremental.replace_notes(row, 1, {});
+    if (!same_alignment(incremental.alignment(), original)) {
+        throw std::runtime_error("undoing the edits did not restore the alignment");
+    }
+    
+    bool threw = false;
+    try {
+        incremental.replace_notes(performance.size(), 1, {});
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    if (!threw) {
+        throw std::runtime_error("replace_notes past the end did not throw");
+    }
+    
+    std::cout << "Incremental alignment tests passed!" << std::endl;
+}
+
+void test_window_cache() {
+    std::cout << "Testing window cache..." << std::endl;
+    
+    const auto [score, synthetic_performance] = synthetic_pair(300);
+    const NoteArray& performance = synthetic_performance.performance_notes;
+    
+    AutomaticNoteMatcher matcher;
+    const AlignmentVector uncached = matcher(score, performance);
+    auto cache = std::make_shared<WindowCache>();
+    matcher.set_window_cache(cache);
+    const AlignmentVector first = matcher(score, performance);
+    assert(same_alignment(first, uncached));
+    assert(cache->misses() > 0);
+    
+    // A second run is served entirely from the cache
+    const uint64_t hits = cache->hits();
+    const uint64_t misses = cache->misses();
+    const AlignmentVector second = matcher(score, performance);
+    assert(same_alignment(second, uncached));
+    if (cache->hits() <= hits || cache->misses() != misses) {
+        throw std::runtime_error("second run was not served from the window cache");
+    }
+    
+    // Fuzziness only changes the windows, so other settings share the cache
+    AutomaticNoteMatcher::Config config;
+    config.sfuzziness = 6.0f;
+    AutomaticNoteMatcher wider(config);
+    const AlignmentVector wider_uncached = wider(score, performance);
+    wider.set_window_cache(cache);
+    const AlignmentVector wider_cached = wider(score, performance);
+    assert(same_alignment(wider_cached, wider_uncached));
+    
+    auto small = std::make_shared<WindowCache>(2);
+    matcher.set_window_cache(small);
+    const AlignmentVector evicting = matcher(score, performance);
+    assert(same_alignment(evicting, uncached));
+    if (small->size() != 2 || small->evictions() == 0) {
+        throw std::runtime_error("a full window cache did not evict");
+    }
+    
+    std::cout << "Window cache tests passed!" << std::endl;
+}
+
+void test_sweep() {
+    std::cout << "Testing parameter sweeps..." << std::endl;
+    
+    std::vector<NoteArray> scores;
+    std::vector<synthetic::SyntheticPerformance> performances;
+    for (unsigned int seed = 1; seed <= 2; ++seed) {
+        auto pair = synthetic_pair(150 * seed, seed);
+        scores.push_back(std::move(pair.score));
+        performances.push_back(std::move(pair.performance));
+    }
+    std::vector<sweep::Piece> pieces;
+    for (size_t i = 0; i < scores.size(); ++i) {
+        pieces.push_back({&scores[i], &performances[i].performance_notes, &performances[i].alignment});
+    }
+    
+    sweep::Grid grid;
+    grid.alignment_types = {"dtw", "greedy"};
+    grid.s_time_divs = {8, 16};
+    grid.sfuzziness = {2.0f, 8.0f};
+    grid.cap_combinations = {100, 10000};
+    const auto configs = grid.configs();
+    assert(configs.size() == 16);
+    assert(configs[0].alignment_type == "dtw" && configs.back().alignment_type == "greedy");
+    
+    sweep::Stats stats;
+    const auto results = sweep::run(pieces, configs, stats, 2);
+    assert(stats.coarse_alignments == 2 * pieces.size());
+    assert(stats.window_cuts == 4 * pieces.size());
+    assert(stats.alignments == 16 * pieces.size());
+    
+    // Same scores as aligning with each config on its own
+    for (size_t c = 0; c < configs.size(); ++c) {
+        AutomaticNoteMatcher matcher(configs[c]);
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            auto expected = evaluation::fscore_matches(matcher(scores[i], performances[i].performance_notes),
+                                                       performances[i].alignment);
+            if (results[c].pieces[i].n_predicted != expected.n_predicted ||
+                results[c].pieces[i].f_score != expected.f_score) {
+                throw std::runtime_error("sweep result differs from aligning config " + std::to_string(c));
+            }
+        }
+        assert(results[c].total.n_ground_truth ==
+               results[c].pieces[0].n_ground_truth + results[c].pieces[1].n_ground_truth);
+    }
+    
+    bool threw = false;
+    try {
+        sweep::run({{&scores[0], &performances[0].performance_notes, nullptr}}, configs);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    if (!threw) {
+        throw std::runtime_error("sweep without ground truth did not throw");
+    }
+    
+    std::cout << "Parameter sweep tests passed!" << std::endl;
+}
+
+void test_tracing() {
+    std::cout << "Testing trace spans..." << std::endl;
+    
+    const auto [score, performance] = synthetic_pair(200);
+    
+    AutomaticNoteMatcher matcher;
+    trace::start();
+    auto traced = matcher(score, performance.performance_notes);
+    trace::stop();
+    
+    // Tracing never changes the result
+    auto untraced = matcher(score, performance.performance_notes);
+    assert(traced.size() == untraced.size());
+    
+    std::ostringstream json;
+    trace::write(json);
+    assert(json.str().find("\"traceEvents\"") != std::string::npos);
+    if (trace::compiled_in) {
+        assert(trace::num_events() > 4);
+        assert(json.str().find("\"coarse_dtw\"") != std::string::npos);
+        assert(json.str().find("\"symbolic_match\"") != std::string::npos);
+    } else {
+        assert(trace::num_events() == 0);
+    }
+    trace::clear();
+    
+    // Events of an exited thread stay readable until the next clear()
+    trace::start();
+    std::thread([&]() { matcher(score, performance.performance_notes); }).join();
+    trace::stop();
+    assert(trace::compiled_in == (trace::num_events() > 0));
+    trace::clear();
+    assert(trace::num_events() == 0);
+    
+    std::cout << "Trace span tests passed!" << std::endl;
+}
+
 int main() {
     std::cout << "Starting parangonar C++ tests..." << std::endl;
     
     try {
         test_note_array();
+        test_note_table();
         test_dtw();
         test_simple_greedy_matcher();
         test_automatic_note_matcher();
+        test_seeded_combination_sampling();
+        test_match_parser();
+        test_midi_reader();
         test_evaluation();
+        test_synthetic_performance();
+        test_align_batch();
+        test_prepared_score();
+        test_public_pipeline();
+        test_incremental_alignment();
+        test_window_cache();
+        test_sweep();
+        test_tracing();
         
         std::cout << std::endl << "All tests passed successfully!" << std::endl;
         return 0;
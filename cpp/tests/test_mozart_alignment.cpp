@@ -1,9 +1,17 @@
 #include <parangonar/matchers.hpp>
 #include <parangonar/note.hpp>
 #include <parangonar/match_parser.hpp>
+#include <parangonar/corpus.hpp>
+#include <parangonar/binary_cache.hpp>
+#include <parangonar/match_writer.hpp>
+#include <parangonar/parallel.hpp>
 #include <iostream>
 #include <cassert>
+#include <cmath>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 
 using namespace parangonar;
@@ -21,6 +29,9 @@ public:
         
         try {
             load_mozart_data();
+            test_corpus_loader();
+            test_binary_cache();
+            test_match_writer();
             test_data_quality();
             test_simple_greedy_matcher();
             test_automatic_note_matcher();
@@ -35,6 +46,7 @@ public:
     }
     
 private:
+    std::string match_file_path;
     MatchFileData mozart_data;
     NoteArray score_notes;
     NoteArray performance_notes;
@@ -51,7 +63,6 @@ private:
             "mozart_k265_var1.match"
         };
         
-        std::string match_file_path;
         for (const auto& path : possible_paths) {
             if (std::filesystem::exists(path)) {
                 match_file_path = path;
@@ -88,6 +99,195 @@ private:
         std::cout << "  Sustain pedal events: " << mozart_data.sustain_pedal.size() << std::endl;
     }
     
+    void test_corpus_loader() {
+        std::cout << "\n--- Testing Parallel Corpus Loader ---" << std::endl;
+        
+        // Load the test data directory plus one missing file
+        auto directory = std::filesystem::path(match_file_path).parent_path().string();
+        auto files = CorpusLoader::list_files(directory);
+        files.push_back(directory + "/does_not_exist.match");
+        
+        size_t delivered = 0;
+        CorpusOptions options;
+        options.num_threads = 2;
+        auto summary = CorpusLoader::load(files, [&](CorpusEntry&& entry) {
+            delivered++;
+            if (entry.path == files.front()) {
+                assert(entry.score_notes.size() == score_notes.size());
+                assert(entry.alignment.size() == ground_truth_alignment.size());
+            }
+        }, options);
+        
+        std::cout << "  Files: " << summary.files_total << ", loaded: " << summary.files_loaded
+                  << ", failed: " << summary.files_failed << std::endl;
+        std::cout << "  Wall time: " << summary.wall_sec << " sec" << std::endl;
+        
+        assert(delivered == summary.files_loaded);
+        assert(summary.files_failed == 1);
+        assert(!summary.files.back().ok && !summary.files.back().error.empty());
+        
+        // Malformed lines are left out of a loaded file and counted in its report
+        auto malformed_path = std::filesystem::temp_directory_path() / "parangonar_malformed.match";
+        {
+            std::ofstream out(malformed_path);
+            out << "info(midiClockUnits,480).\n"
+                << "snote(n1,[C,n],4,1:1,0,1/4,0.0,1.0,[])-note(n1,[C,n],4,100,200,200,64).\n"
+                << "snote(n2,[D,n],4,1:2,0,1/4,1.0,2.0,[])-note(n2,[D,n],4,300,400).\n"
+                << "snote(n3,[E,n],4,1:3,0,1/4,2.0,3.0,[]\n";
+        }
+        for (bool keep_match_data : {false, true}) {
+            CorpusOptions malformed_options;
+            malformed_options.keep_match_data = keep_match_data;
+            auto malformed = CorpusLoader::load({malformed_path.string()}, nullptr, malformed_options);
+            const CorpusFileReport& report = malformed.files.front();
+            if (!report.ok || report.num_score_notes != 1 || report.skipped_lines != 2 ||
+                report.first_skipped_line.rfind("snote(n2,", 0) != 0) {
+                throw std::runtime_error("corpus report does not record the skipped lines");
+            }
+        }
+        std::filesystem::remove(malformed_path);
+        
+        std::cout << "Corpus loader test passed!" << std::endl;
+    }
+    
+    void test_binary_cache() {
+        std::cout << "\n--- Testing Binary Match Cache ---" << std::endl;
+        
+        auto cache_dir = std::filesystem::temp_directory_path() / "parangonar_test_cache";
+        std::filesystem::remove_all(cache_dir);
+        
+        binary_cache::MatchCache cache(cache_dir.string());
+        bool hit = true;
+        auto first = cache.load(match_file_path, &hit);
+        assert(!hit);
+        auto second = cache.load(match_file_path, &hit);
+        assert(hit);
+        
+        // The cached bundle must reproduce the parsed data exactly
+        for (const auto* bundle : {&first, &second}) {
+            assert(bundle->info.key_signature == mozart_data.info.key_signature);
+            assert(bundle->score_notes.size() == score_notes.size());
+            assert(bundle->performance_notes.size() == performance_notes.size());
+            assert(bundle->sustain_pedal == mozart_data.sustain_pedal);
+            for (size_t i = 0; i < score_notes.size(); ++i) {
+                assert(bundle->score_notes[i].id == score_notes[i].id);
+                assert(bundle->score_notes[i].onset_beat == score_notes[i].onset_beat);
+                assert(bundle->score_notes[i].pitch == score_notes[i].pitch);
+            }
+            for (size_t i = 0; i < performance_notes.size(); ++i) {
+                assert(bundle->performance_notes[i].id == performance_notes[i].id);
+                assert(bundle->performance_notes[i].onset_sec == performance_notes[i].onset_sec);
+                assert(bundle->performance_notes[i].velocity == performance_notes[i].velocity);
+            }
+            assert(bundle->alignment.size() == ground_truth_alignment.size());
+            for (size_t i = 0; i < ground_truth_alignment.size(); ++i) {
+                assert(bundle->alignment[i].label == ground_truth_alignment[i].label);
+                assert(bundle->alignment[i].score_id == ground_truth_alignment[i].score_id);
+                assert(bundle->alignment[i].performance_id == ground_truth_alignment[i].performance_id);
+            }
+            (void)bundle;
+        }
+        
+        // Columns are readable in place
+        binary_cache::BinaryMatchView view(cache.entry_path(match_file_path));
+        assert(view.num_score_notes() == score_notes.size());
+        assert(view.score_pitch()[0] == score_notes[0].pitch);
+        assert(view.string(view.performance_id()[0]) == performance_notes[0].id);
+        
+        // A note id past the string table is rejected, and the entry rebuilt
+        const auto id_offset = static_cast<std::streamoff>(view.file_offset(view.score_id()));
+        {
+            std::fstream entry(cache.entry_path(match_file_path), std::ios::in | std::ios::out | std::ios::binary);
+            const uint32_t bad_id = 0xFFFFFFFFu;
+            entry.seekp(id_offset);
+            entry.write(reinterpret_cast<const char*>(&bad_id), sizeof(bad_id));
+        }
+        bool rejected = false;
+        try {
+            binary_cache::BinaryMatchView corrupt(cache.entry_path(match_file_path));
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        auto rebuilt = cache.load(match_file_path, &hit);
+        if (!rejected || hit || rebuilt.score_notes[0].id != score_notes[0].id) {
+            throw std::runtime_error("Corrupt cache entry was not rejected and rebuilt");
+        }
+        
+        // Concurrent writers of one entry each write their own temporary file
+        const std::string shared_entry = (cache_dir / "shared.pbin").string();
+        parallel::parallel_for(8, 4, [&](size_t) { binary_cache::write(shared_entry, first); });
+        size_t leftover_files = 0;
+        for (const auto& file : std::filesystem::directory_iterator(cache_dir)) {
+            leftover_files += file.path().extension() == ".tmp";
+        }
+        if (binary_cache::BinaryMatchView(shared_entry).num_score_notes() != score_notes.size() || leftover_files) {
+            throw std::runtime_error("Concurrent cache writes left a bad entry or temporary files");
+        }
+        
+        std::filesystem::remove_all(cache_dir);
+        std::cout << "Binary cache test passed!" << std::endl;
+    }
+    
+    void test_match_writer() {
+        std::cout << "\n--- Testing Match File Writer ---" << std::endl;
+        
+        MatchFileWriter writer;
+        std::string text = writer.to_string(mozart_data.info, score_notes, performance_notes,
+                                            ground_truth_alignment, mozart_data.sustain_pedal);
+        std::cout << "  Written size: " << text.size() << " bytes" << std::endl;
+        
+        // Reading the output back reproduces notes, alignment and pedal
+        auto reloaded = MatchFileParser::load_notes_string(text);
+        assert(reloaded.info.time_signature == mozart_data.info.time_signature);
+        assert(reloaded.score_notes.size() == score_notes.size());
+        assert(reloaded.performance_notes.size() == performance_notes.size());
+        assert(reloaded.sustain_pedal == mozart_data.sustain_pedal);
+        for (size_t i = 0; i < score_notes.size(); ++i) {
+            assert(reloaded.score_notes[i].id == score_notes[i].id);
+            assert(reloaded.score_notes[i].pitch == score_notes[i].pitch);
+            assert(reloaded.score_notes[i].onset_beat == score_notes[i].onset_beat);
+        }
+        for (size_t i = 0; i < performance_notes.size(); ++i) {
+            assert(reloaded.performance_notes[i].id == performance_notes[i].id);
+            assert(reloaded.performance_notes[i].pitch == performance_notes[i].pitch);
+            assert(reloaded.performance_notes[i].onset_tick == performance_notes[i].onset_tick);
+            assert(reloaded.performance_notes[i].velocity == performance_notes[i].velocity);
+        }
+        auto fscore = evaluation::fscore_alignments(reloaded.alignment, ground_truth_alignment,
+                                                  {Alignment::Label::MATCH, Alignment::Label::DELETION, Alignment::Label::INSERTION});
+        if (std::abs(fscore.f_score - 1.0) > 1e-9) {
+            throw std::runtime_error("Written match file does not reproduce the alignment");
+        }
+        
+        // Score positions are written as in the original: bar:beat, then
+        // offset and duration as fractions of a whole note
+        auto score_position = [](const std::string& contents, const std::string& id) {
+            std::string prefix = "snote(" + id + ",";
+            size_t start = contents.find(prefix);
+            if (start == std::string::npos) return std::string();
+            size_t field_start = contents.find("],", start) + 2;  // Past the spelling
+            field_start = contents.find(',', field_start) + 1;   // Past the octave
+            size_t field_end = field_start;
+            for (int field = 0; field < 3; ++field) {
+                field_end = contents.find(',', field_end) + 1;
+            }
+            return contents.substr(field_start, field_end - field_start);
+        };
+        std::ifstream original_file(match_file_path);
+        const std::string original((std::istreambuf_iterator<char>(original_file)), std::istreambuf_iterator<char>());
+        if (score_position(text, "n9") != "1:1,0,1/4,") {
+            throw std::runtime_error("Unexpected score position for n9: " + score_position(text, "n9"));
+        }
+        for (const auto& note : score_notes) {
+            if (score_position(text, note.id) != score_position(original, note.id)) {
+                throw std::runtime_error("Score position of " + note.id + " differs: " +
+                                         score_position(text, note.id) + " vs " + score_position(original, note.id));
+            }
+        }
+        
+        std::cout << "Match file writer test passed!" << std::endl;
+    }
+    
     void test_data_quality() {
         std::cout << "\n--- Testing Data Quality ---" << std::endl;
         
@@ -240,6 +440,53 @@ private:
                       << "). This may indicate alignment issues with longer/complex pieces." << std::endl;
         }
         
+        // A caller-provided workspace gives the same alignment on every call
+        AlignmentWorkspace workspace;
+        for (int i = 0; i < 2; ++i) {
+            auto reused_alignment = matcher(score_notes, performance_notes, workspace);
+            assert(reused_alignment.size() == predicted_alignment.size());
+            for (size_t j = 0; j < reused_alignment.size(); ++j) {
+                assert(reused_alignment[j].label == predicted_alignment[j].label);
+                assert(reused_alignment[j].score_id == predicted_alignment[j].score_id);
+                assert(reused_alignment[j].performance_id == predicted_alignment[j].performance_id);
+            }
+        }
+        assert(workspace.capacity_bytes() > 0);
+        workspace.release();
+        assert(workspace.capacity_bytes() == 0);
+        
+        // One const matcher shared by concurrent calls
+        const AutomaticNoteMatcher& shared_matcher = matcher;
+        std::vector<AlignmentVector> concurrent_alignments(4);
+        parallel::parallel_for(concurrent_alignments.size(), 4, [&](size_t i) {
+            concurrent_alignments[i] = shared_matcher(score_notes, performance_notes);
+        });
+        for (const auto& concurrent_alignment : concurrent_alignments) {
+            if (evaluation::fscore_alignments(concurrent_alignment, predicted_alignment,
+                    {Alignment::Label::MATCH, Alignment::Label::DELETION, Alignment::Label::INSERTION}).f_score != 1.0) {
+                throw std::runtime_error("Concurrent alignment differs from the sequential one");
+            }
+        }
+        
+        // Per-stage measurements
+        AlignmentStats stats;
+        auto measured_alignment = matcher(score_notes, performance_notes, stats);
+        assert(measured_alignment.size() == predicted_alignment.size());
+        assert(stats.stages[AlignmentStats::COARSE_DTW].dtw_cells > 0);
+        assert(stats.stages[AlignmentStats::COARSE_DTW].peak_matrix_bytes > 0);
+        assert(stats.num_windows > 0);
+        assert(stats.window_score_notes.size() == stats.num_windows);
+        assert(stats.window_performance_notes.size() == stats.num_windows);
+        assert(stats.total_ns() > 0);
+        for (int stage = 0; stage < AlignmentStats::NUM_STAGES; ++stage) {
+            std::cout << "  " << AlignmentStats::stage_name(static_cast<AlignmentStats::Stage>(stage)) << ": "
+                      << stats.stages[stage].wall_ns << " ns, "
+                      << stats.stages[stage].dtw_cells << " DTW cells" << std::endl;
+        }
+        std::cout << "  Windows: " << stats.num_windows
+                  << ", combinations: " << stats.combinations_evaluated
+                  << ", fallback matches: " << stats.fallback_greedy_matches << std::endl;
+        
         std::cout << "AutomaticNoteMatcher test completed!" << std::endl;
     }
     
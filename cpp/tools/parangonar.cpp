@@ -0,0 +1,454 @@
+#include <parangonar/corpus.hpp>
+#include <parangonar/match_parser.hpp>
+#include <parangonar/match_writer.hpp>
+#include <parangonar/matchers.hpp>
+#include <parangonar/midi_reader.hpp>
+#include <parangonar/parallel.hpp>
+#include <parangonar/trace.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace parangonar;
+namespace fs = std::filesystem;
+
+namespace {
+
+void print_usage() {
+    std::cerr
+        << "Usage:\n"
+        << "  parangonar [options] FILE.match                 Re-align a match file and evaluate against it\n"
+        << "  parangonar [options] --score S --performance P  Align a score and a performance\n"
+        << "  parangonar [options] --corpus DIR               Align and evaluate every match file in DIR\n"
+        << "\n"
+        << "Scores are read from .match, .mid/.midi or .csv files, performances likewise.\n"
+        << "CSV files need a header; score columns: onset_beat, duration_beat, pitch[, id],\n"
+        << "performance columns: onset_sec, duration_sec, pitch[, velocity, id].\n"
+        << "\n"
+        << "Options:\n"
+        << "  -o, --output FILE     Write the alignment: a match file for .match, CSV otherwise\n"
+        << "                        (default: CSV on stdout)\n"
+        << "  --ground-truth FILE   Evaluate against the alignment of a match file\n"
+        << "  --output-dir DIR      Corpus mode: write alignments to DIR as <path>.csv, keeping\n"
+        << "                        the subdirectories of the corpus\n"
+        << "  --recursive           Corpus mode: include subdirectories\n"
+        << "  -j, --jobs N          Threads (default: all cores)\n"
+        << "  --alignment-type T    dtw or greedy (default dtw)\n"
+        << "  --sfuzziness X        Score window margin in beats (default 8)\n"
+        << "  --pfuzziness X        Performance window margin (default 8)\n"
+        << "  --cap-combinations N  Omission combinations evaluated per window (default 10000)\n"
+        << "  --trace FILE          Write Chrome trace events (needs PARANGONAR_ENABLE_TRACING)\n";
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string extension_of(const std::string& path) {
+    std::string extension = fs::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+std::vector<std::string> split_csv_line(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    std::istringstream stream(line);
+    while (std::getline(stream, field, ',')) {
+        size_t begin = field.find_first_not_of(" \t\r\"");
+        size_t end = field.find_last_not_of(" \t\r\"");
+        fields.push_back(begin == std::string::npos ? "" : field.substr(begin, end - begin + 1));
+    }
+    return fields;
+}
+
+// Note array from a CSV file with a header of Note field names
+NoteArray read_csv_notes(const std::string& path, bool score) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    std::string line;
+    if (!std::getline(in, line)) {
+        throw std::runtime_error("Empty CSV file: " + path);
+    }
+    std::vector<std::string> header = split_csv_line(line);
+    auto column = [&](const char* name) -> std::optional<size_t> {
+        auto it = std::find(header.begin(), header.end(), name);
+        if (it == header.end()) return std::nullopt;
+        return static_cast<size_t>(it - header.begin());
+    };
+    
+    auto pitch = column("pitch");
+    auto onset = column(score ? "onset_beat" : "onset_sec");
+    auto duration = column(score ? "duration_beat" : "duration_sec");
+    if (!pitch || !onset || !duration) {
+        throw std::runtime_error(path + ": CSV needs pitch, " + (score ? "onset_beat, duration_beat" :
+                                 "onset_sec, duration_sec") + " columns");
+    }
+    auto id = column("id");
+    auto velocity = column("velocity");
+    
+    NoteArray notes;
+    size_t line_number = 1;
+    while (std::getline(in, line)) {
+        line_number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        std::vector<std::string> fields = split_csv_line(line);
+        auto field = [&](std::optional<size_t> index) -> const std::string& {
+            if (*index >= fields.size()) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": missing column");
+            }
+            return fields[*index];
+        };
+        try {
+            Note note;
+            note.pitch = std::stoi(field(pitch));
+            note.id = id ? field(id) : (score ? "n" : "p") + std::to_string(notes.size());
+            if (score) {
+                note.onset_beat = std::stof(field(onset));
+                note.duration_beat = std::stof(field(duration));
+                note.onset_quarter = note.onset_beat;
+                note.duration_quarter = note.duration_beat;
+                note.onset_div = static_cast<int>(std::lround(note.onset_quarter * note.divs_pq));
+                note.duration_div = static_cast<int>(std::lround(note.duration_quarter * note.divs_pq));
+            } else {
+                note.onset_sec = std::stof(field(onset));
+                note.duration_sec = std::stof(field(duration));
+                note.velocity = velocity ? std::stoi(field(velocity)) : 64;
+            }
+            notes.push_back(std::move(note));
+        } catch (const std::logic_error&) {
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid number");
+        }
+    }
+    return notes;
+}
+
+// MIDI notes as score notes, one beat per quarter
+NoteArray midi_score_notes(const std::string& path) {
+    MidiFileData midi = MidiFileReader::read_file(path);
+    if (midi.ticks_per_quarter <= 0) {
+        throw std::runtime_error(path + ": SMPTE time division cannot be read as a score");
+    }
+    for (auto& note : midi.notes) {
+        note.onset_quarter = static_cast<float>(note.onset_tick) / midi.ticks_per_quarter;
+        note.duration_quarter = static_cast<float>(note.duration_tick) / midi.ticks_per_quarter;
+        note.onset_beat = note.onset_quarter;
+        note.duration_beat = note.duration_quarter;
+        note.onset_div = static_cast<int>(std::lround(note.onset_quarter * note.divs_pq));
+        note.duration_div = static_cast<int>(std::lround(note.duration_quarter * note.divs_pq));
+    }
+    return std::move(midi.notes);
+}
+
+NoteArray read_notes(const std::string& path, bool score) {
+    std::string extension = extension_of(path);
+    if (extension == ".match") {
+        MatchNotes match = MatchFileParser::load_notes(path);
+        return score ? std::move(match.score_notes) : std::move(match.performance_notes);
+    }
+    if (extension == ".mid" || extension == ".midi") {
+        return score ? midi_score_notes(path) : MidiFileReader::read_notes(path);
+    }
+    if (extension == ".csv") {
+        return read_csv_notes(path, score);
+    }
+    throw std::runtime_error("Unknown file type (expected .match, .mid, .midi or .csv): " + path);
+}
+
+const char* label_name(Alignment::Label label) {
+    switch (label) {
+        case Alignment::Label::MATCH: return "match";
+        case Alignment::Label::INSERTION: return "insertion";
+        case Alignment::Label::DELETION: return "deletion";
+    }
+    return "";
+}
+
+void write_alignment_csv(std::ostream& out, const AlignmentVector& alignment) {
+    out << "label,score_id,performance_id\n";
+    for (const auto& align : alignment) {
+        out << label_name(align.label) << ',' << align.score_id << ',' << align.performance_id << '\n';
+    }
+}
+
+void write_alignment_csv(const std::string& path, const AlignmentVector& alignment) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot write file: " + path);
+    }
+    write_alignment_csv(out, alignment);
+    if (!out) {
+        throw std::runtime_error("Failed writing file: " + path);
+    }
+}
+
+// Performance ticks consistent with the seconds under the info's MIDI clock
+void set_ticks_from_seconds(NoteArray& performance_notes, const MatchFileInfo& info) {
+    double ticks_per_second = info.midi_clock_units * 1e6 / info.midi_clock_rate;
+    for (auto& note : performance_notes) {
+        note.onset_tick = static_cast<int>(std::llround(note.onset_sec * ticks_per_second));
+        note.duration_tick = static_cast<int>(std::llround(note.duration_sec * ticks_per_second));
+    }
+}
+
+void print_fscore(const char* label, const evaluation::FScoreResult& result) {
+    std::fprintf(stderr, "%s: precision %.4f, recall %.4f, F-score %.4f (%zu predicted, %zu ground truth matches)\n",
+                 label, result.precision, result.recall, result.f_score, result.n_predicted, result.n_ground_truth);
+}
+
+struct Options {
+    std::string match_file;
+    std::string score_path;
+    std::string performance_path;
+    std::string corpus_dir;
+    std::string output;
+    std::string output_dir;
+    std::string ground_truth;
+    std::string trace_file;
+    bool recursive = false;
+    unsigned int num_threads = 0;
+};
+
+int align_pair(const AutomaticNoteMatcher& matcher, const Options& options) {
+    auto start = std::chrono::steady_clock::now();
+    MatchFileInfo info;
+    NoteArray score_notes;
+    NoteArray performance_notes;
+    AlignmentVector ground_truth;
+    bool from_match = false;
+    if (!options.match_file.empty()) {
+        MatchNotes match = MatchFileParser::load_notes(options.match_file);
+        info = match.info;
+        score_notes = std::move(match.score_notes);
+        performance_notes = std::move(match.performance_notes);
+        ground_truth = std::move(match.alignment);
+        from_match = true;
+    } else {
+        score_notes = read_notes(options.score_path, true);
+        performance_notes = read_notes(options.performance_path, false);
+        if (extension_of(options.performance_path) == ".match") {
+            info = MatchFileParser::load_notes(options.performance_path).info;
+            from_match = true;
+        }
+    }
+    if (!options.ground_truth.empty()) {
+        ground_truth = MatchFileParser::load_notes(options.ground_truth).alignment;
+    }
+    double load_sec = seconds_since(start);
+    
+    start = std::chrono::steady_clock::now();
+    AlignmentVector alignment = matcher(score_notes, performance_notes);
+    double align_sec = seconds_since(start);
+    
+    if (options.output.empty()) {
+        write_alignment_csv(std::cout, alignment);
+    } else if (extension_of(options.output) == ".match") {
+        if (!from_match) {
+            set_ticks_from_seconds(performance_notes, info);
+        }
+        MatchFileWriter().write_file(options.output, info, score_notes, performance_notes, alignment);
+    } else {
+        write_alignment_csv(options.output, alignment);
+    }
+    
+    size_t num_notes = score_notes.size() + performance_notes.size();
+    std::fprintf(stderr, "%zu score notes, %zu performance notes: loaded in %.3f s, aligned in %.3f s (%.0f notes/s)\n",
+                 score_notes.size(), performance_notes.size(), load_sec, align_sec,
+                 align_sec > 0.0 ? num_notes / align_sec : 0.0);
+    if (!ground_truth.empty()) {
+        print_fscore("Matches", evaluation::fscore_matches(alignment, ground_truth));
+    }
+    return 0;
+}
+
+// Files parsed and aligned together; bounds memory to one chunk of the corpus
+constexpr size_t CORPUS_CHUNK_FILES = 256;
+
+int align_corpus(const AutomaticNoteMatcher& matcher, const Options& options) {
+    CorpusOptions corpus_options;
+    corpus_options.num_threads = options.num_threads;
+    corpus_options.recursive = options.recursive;
+    std::vector<std::string> files = CorpusLoader::list_files(options.corpus_dir, corpus_options);
+    if (files.empty()) {
+        throw std::runtime_error("No match files in " + options.corpus_dir);
+    }
+    if (!options.output_dir.empty()) {
+        fs::create_directories(options.output_dir);
+    }
+    
+    // Per file in path order, then micro-averaged over all matches
+    std::vector<evaluation::FScoreResult> file_results;
+    double f_score_sum = 0.0;
+    size_t num_notes = 0, num_aligned = 0, files_failed = 0, bytes_total = 0;
+    double load_sec = 0.0, align_sec = 0.0;
+    
+    // Stream the corpus in chunks; each chunk is parsed, then balanced over
+    // all threads by align_batch, and freed before the next one is loaded
+    for (size_t first = 0; first < files.size(); first += CORPUS_CHUNK_FILES) {
+        std::vector<std::string> chunk(files.begin() + first,
+                                       files.begin() + std::min(files.size(), first + CORPUS_CHUNK_FILES));
+        std::vector<CorpusEntry> entries;
+        CorpusSummary summary = CorpusLoader::load(chunk, [&](CorpusEntry&& entry) {
+            entries.push_back(std::move(entry));
+        }, corpus_options);
+        for (const auto& file : summary.files) {
+            if (!file.ok) {
+                std::fprintf(stderr, "%s: %s\n", file.path.c_str(), file.error.c_str());
+            } else if (file.skipped_lines > 0) {
+                std::fprintf(stderr, "%s: skipped %zu malformed line%s, first: %s\n", file.path.c_str(),
+                             file.skipped_lines, file.skipped_lines == 1 ? "" : "s", file.first_skipped_line.c_str());
+            }
+        }
+        files_failed += summary.files_failed;
+        bytes_total += summary.bytes_total;
+        load_sec += summary.wall_sec;
+        std::sort(entries.begin(), entries.end(),
+                  [](const CorpusEntry& a, const CorpusEntry& b) { return a.path < b.path; });
+        
+        std::vector<AlignmentPair> pairs;
+        pairs.reserve(entries.size());
+        for (const auto& entry : entries) {
+            pairs.push_back({&entry.score_notes, &entry.performance_notes});
+            num_notes += entry.score_notes.size() + entry.performance_notes.size();
+        }
+        
+        std::vector<evaluation::FScoreResult> results(entries.size());
+        auto start = std::chrono::steady_clock::now();
+        matcher.align_batch(pairs, [&](size_t index, AlignmentVector&& alignment) {
+            const CorpusEntry& entry = entries[index];
+            results[index] = evaluation::fscore_matches(alignment, entry.alignment);
+            if (!options.output_dir.empty()) {
+                // Mirror the corpus layout so same-named files in subdirectories stay apart
+                fs::path output = fs::path(options.output_dir) /
+                    fs::path(entry.path).lexically_relative(options.corpus_dir);
+                fs::create_directories(output.parent_path());
+                write_alignment_csv(output.replace_extension(".csv").string(), alignment);
+            }
+        }, options.num_threads);
+        align_sec += seconds_since(start);
+        
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const auto& result = results[i];
+            std::printf("%-48s %7zu %7zu  P %.4f  R %.4f  F %.4f\n", entries[i].path.c_str(),
+                        entries[i].score_notes.size(), entries[i].performance_notes.size(),
+                        result.precision, result.recall, result.f_score);
+            f_score_sum += result.f_score;
+        }
+        file_results.insert(file_results.end(), results.begin(), results.end());
+        num_aligned += entries.size();
+    }
+    
+    const evaluation::FScoreResult total = evaluation::micro_average(file_results);
+    
+    std::fflush(stdout);
+    unsigned int threads = options.num_threads ? options.num_threads : parallel::default_thread_count();
+    std::fprintf(stderr, "\n%zu files (%zu failed), %zu notes, %u threads\n",
+                 files.size(), files_failed, num_notes, threads);
+    std::fprintf(stderr, "Loaded in %.3f s (%.1f MB/s), aligned in %.3f s (%.0f notes/s, %.2f files/s)\n",
+                 load_sec, load_sec > 0.0 ? bytes_total / 1e6 / load_sec : 0.0,
+                 align_sec, align_sec > 0.0 ? num_notes / align_sec : 0.0,
+                 align_sec > 0.0 ? num_aligned / align_sec : 0.0);
+    print_fscore("All matches", total);
+    std::fprintf(stderr, "Mean F-score per file: %.4f\n", num_aligned ? f_score_sum / num_aligned : 0.0);
+    return files_failed ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    AutomaticNoteMatcher::Config config = AutomaticNoteMatcher().get_config();
+    
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                print_usage();
+                return 0;
+            }
+            if (arg == "--recursive") {
+                options.recursive = true;
+                continue;
+            }
+            if (arg.empty() || arg[0] != '-') {
+                options.match_file = arg;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                print_usage();
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--score") {
+                options.score_path = value;
+            } else if (arg == "--performance") {
+                options.performance_path = value;
+            } else if (arg == "--corpus") {
+                options.corpus_dir = value;
+            } else if (arg == "--output" || arg == "-o") {
+                options.output = value;
+            } else if (arg == "--output-dir") {
+                options.output_dir = value;
+            } else if (arg == "--ground-truth") {
+                options.ground_truth = value;
+            } else if (arg == "--jobs" || arg == "-j") {
+                options.num_threads = static_cast<unsigned int>(std::stoul(value));
+            } else if (arg == "--alignment-type") {
+                config.alignment_type = value;
+            } else if (arg == "--sfuzziness") {
+                config.sfuzziness = std::stof(value);
+            } else if (arg == "--pfuzziness") {
+                config.pfuzziness = std::stof(value);
+            } else if (arg == "--cap-combinations") {
+                config.cap_combinations = std::stoi(value);
+            } else if (arg == "--trace") {
+                options.trace_file = value;
+            } else {
+                print_usage();
+                return 1;
+            }
+        }
+        
+        int modes = !options.match_file.empty() + !options.corpus_dir.empty() +
+                    (!options.score_path.empty() || !options.performance_path.empty());
+        bool pair_incomplete = options.score_path.empty() != options.performance_path.empty();
+        if (modes != 1 || pair_incomplete) {
+            print_usage();
+            return 1;
+        }
+        if (config.alignment_type != "dtw" && config.alignment_type != "greedy") {
+            throw std::invalid_argument("Unknown alignment type: " + config.alignment_type);
+        }
+        if (!options.trace_file.empty() && !trace::compiled_in) {
+            std::cerr << "Warning: built without PARANGONAR_ENABLE_TRACING, the trace will be empty" << std::endl;
+        }
+        
+        const AutomaticNoteMatcher matcher(config);
+        if (!options.trace_file.empty()) {
+            trace::start();
+        }
+        int status = options.corpus_dir.empty() ? align_pair(matcher, options) : align_corpus(matcher, options);
+        if (!options.trace_file.empty()) {
+            trace::stop();
+            trace::write_file(options.trace_file);
+        }
+        return status;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
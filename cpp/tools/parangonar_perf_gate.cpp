@@ -0,0 +1,461 @@
+#include <parangonar/matchers.hpp>
+#include <parangonar/match_parser.hpp>
+#include <parangonar/corpus.hpp>
+#include <parangonar/synthetic.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace parangonar;
+
+// Live heap tracking through the replaceable global operator new; every
+// block carries its size in a header so deletes can be accounted for
+namespace {
+constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+std::atomic<int64_t> g_live_bytes{0};
+std::atomic<int64_t> g_peak_bytes{0};
+
+void* tracked_alloc(std::size_t size) {
+    auto* block = static_cast<unsigned char*>(std::malloc(size + HEADER_SIZE));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<std::size_t*>(block) = size;
+    int64_t live = g_live_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + size;
+    int64_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !g_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return block + HEADER_SIZE;
+}
+
+void tracked_free(void* ptr) noexcept {
+    if (!ptr) {
+        return;
+    }
+    auto* block = static_cast<unsigned char*>(ptr) - HEADER_SIZE;
+    g_live_bytes.fetch_sub(static_cast<int64_t>(*reinterpret_cast<std::size_t*>(block)), std::memory_order_relaxed);
+    std::free(block);
+}
+}
+
+void* operator new(std::size_t size) { return tracked_alloc(size); }
+void* operator new[](std::size_t size) { return tracked_alloc(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return tracked_alloc(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr) noexcept { tracked_free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { tracked_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { tracked_free(ptr); }
+
+namespace {
+
+long peak_rss_kb() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+struct GateCase {
+    std::string name;
+    NoteArray score_notes;
+    NoteArray performance_notes;
+    AlignmentVector ground_truth;
+};
+
+struct CaseResult {
+    std::string name;
+    size_t score_notes = 0;
+    size_t performance_notes = 0;
+    size_t repetitions = 0;
+    double p50_ms = 0.0;
+    double p90_ms = 0.0;
+    double p99_ms = 0.0;
+    double notes_per_sec = 0.0;
+    double peak_heap_bytes = 0.0;  // Over a first call with a fresh workspace
+    double f_score = 0.0;
+};
+
+struct GateOptions {
+    std::string data_dir;
+    std::string baseline;
+    std::string output;
+    size_t max_notes = 100000;
+    size_t repetitions = 5;           // At least this many timed runs per case
+    double min_time = 0.5;            // Seconds per case
+    double time_tolerance = 0.25;     // Allowed relative p50 slowdown
+    double memory_tolerance = 0.25;   // Allowed relative peak heap growth
+    double fscore_tolerance = 0.002;  // Allowed absolute F-score drop
+};
+
+// Fixed corpus: synthetic pieces of growing size, then the match files of the data directory.
+// With 2% deletions and insertions the coarse alignment drifts on long pieces
+// and the F-score mostly reflects the greedy fallback; the clean pieces (no
+// deletions or insertions) gate the accuracy of the full pipeline
+std::vector<GateCase> build_cases(const GateOptions& options) {
+    struct SyntheticSpec {
+        const char* family;
+        size_t notes;
+        float edits;  // Deletion and insertion rate
+        float repeats;
+        float trills;
+    };
+    const SyntheticSpec specs[] = {
+        {"synthetic", 1000, 0.02f, 0.0f, 0.0f},
+        {"synthetic", 10000, 0.02f, 0.0f, 0.0f},
+        {"synthetic", 100000, 0.02f, 0.0f, 0.0f},
+        {"synthetic_ornaments", 10000, 0.02f, 0.02f, 0.02f},
+        {"synthetic_clean", 1000, 0.0f, 0.0f, 0.0f},
+        {"synthetic_clean", 10000, 0.0f, 0.0f, 0.0f},
+        {"synthetic_clean", 100000, 0.0f, 0.0f, 0.0f},
+    };
+    
+    std::vector<GateCase> cases;
+    for (const auto& spec : specs) {
+        if (spec.notes > options.max_notes) continue;
+        synthetic::ScoreConfig score_config;
+        score_config.num_notes = spec.notes;
+        score_config.seed = 1;
+        synthetic::PerformanceConfig config;
+        config.seed = 2;
+        config.deletion_rate = spec.edits;
+        config.insertion_rate = spec.edits;
+        config.repeated_note_rate = spec.repeats;
+        config.trill_rate = spec.trills;
+        
+        GateCase gate_case;
+        gate_case.name = std::string(spec.family) + "/notes:" + std::to_string(spec.notes);
+        gate_case.score_notes = synthetic::generate_score(score_config);
+        auto performance = synthetic::generate_performance(gate_case.score_notes, config);
+        gate_case.performance_notes = std::move(performance.performance_notes);
+        gate_case.ground_truth = std::move(performance.alignment);
+        cases.push_back(std::move(gate_case));
+    }
+    
+    if (!options.data_dir.empty()) {
+        for (const auto& path : CorpusLoader::list_files(options.data_dir)) {
+            MatchNotes match = MatchFileParser::load_notes(path);
+            GateCase gate_case;
+            gate_case.name = "match/" + path.substr(path.find_last_of("/\\") + 1);
+            gate_case.score_notes = std::move(match.score_notes);
+            gate_case.performance_notes = std::move(match.performance_notes);
+            gate_case.ground_truth = std::move(match.alignment);
+            cases.push_back(std::move(gate_case));
+        }
+    }
+    return cases;
+}
+
+// Nearest-rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double fraction) {
+    size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+CaseResult run_case(const GateCase& gate_case, const AutomaticNoteMatcher& matcher, const GateOptions& options) {
+    using clock = std::chrono::steady_clock;
+    CaseResult result;
+    result.name = gate_case.name;
+    result.score_notes = gate_case.score_notes.size();
+    result.performance_notes = gate_case.performance_notes.size();
+    
+    std::vector<double> latencies_ms;
+    {
+        // First call on a fresh workspace: accuracy and memory footprint
+        int64_t live_before = g_live_bytes.load();
+        g_peak_bytes.store(live_before);
+        AlignmentWorkspace workspace;
+        AlignmentVector alignment = matcher(gate_case.score_notes, gate_case.performance_notes, workspace);
+        result.peak_heap_bytes = static_cast<double>(g_peak_bytes.load() - live_before);
+        result.f_score = evaluation::fscore_matches(alignment, gate_case.ground_truth).f_score;
+        
+        double total_sec = 0.0;
+        while (latencies_ms.size() < options.repetitions || total_sec < options.min_time) {
+            auto start = clock::now();
+            alignment = matcher(gate_case.score_notes, gate_case.performance_notes, workspace);
+            double sec = std::chrono::duration<double>(clock::now() - start).count();
+            total_sec += sec;
+            latencies_ms.push_back(sec * 1e3);
+        }
+        result.notes_per_sec = result.score_notes * latencies_ms.size() / total_sec;
+    }
+    
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+    result.repetitions = latencies_ms.size();
+    result.p50_ms = percentile(latencies_ms, 0.50);
+    result.p90_ms = percentile(latencies_ms, 0.90);
+    result.p99_ms = percentile(latencies_ms, 0.99);
+    return result;
+}
+
+// JSON string contents; case names come from corpus file paths
+std::string json_escape(std::string_view text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned char>(c));
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+void write_json(std::ostream& out, const std::vector<CaseResult>& results) {
+    out << "{\n  \"schema\": 1,\n  \"cases\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        // Only numbers go through the fixed buffer; their width is bounded
+        char metrics[384];
+        std::snprintf(metrics, sizeof(metrics),
+            "\"score_notes\": %zu, \"performance_notes\": %zu, \"repetitions\": %zu, "
+            "\"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"notes_per_sec\": %.0f, "
+            "\"peak_heap_bytes\": %.0f, \"f_score\": %.6f",
+            r.score_notes, r.performance_notes, r.repetitions, r.p50_ms, r.p90_ms, r.p99_ms,
+            r.notes_per_sec, r.peak_heap_bytes, r.f_score);
+        out << "    {\"name\": \"" << json_escape(r.name) << "\", " << metrics << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"peak_rss_kb\": " << peak_rss_kb() << "\n}\n";
+}
+
+// "key": value pairs of a JSON object written on a single line (as write_json does)
+std::map<std::string, std::string> parse_flat_object(std::string_view line) {
+    std::map<std::string, std::string> fields;
+    size_t pos = 0;
+    while ((pos = line.find('"', pos)) != std::string_view::npos) {
+        size_t key_end = line.find('"', pos + 1);
+        size_t colon = line.find(':', key_end);
+        if (key_end == std::string_view::npos || colon == std::string_view::npos) break;
+        std::string key(line.substr(pos + 1, key_end - pos - 1));
+        
+        size_t value_begin = line.find_first_not_of(" \t", colon + 1);
+        if (value_begin == std::string_view::npos) break;
+        size_t value_end;
+        if (line[value_begin] == '"') {
+            // String with the escapes json_escape writes
+            std::string value;
+            for (value_end = value_begin + 1; value_end < line.size() && line[value_end] != '"'; ++value_end) {
+                if (line[value_end] == '\\' && value_end + 1 < line.size()) {
+                    char escape = line[++value_end];
+                    if (escape == 'u' && value_end + 4 < line.size()) {
+                        value += static_cast<char>(std::stoi(std::string(line.substr(value_end + 1, 4)), nullptr, 16));
+                        value_end += 4;
+                    } else {
+                        value += escape;
+                    }
+                } else {
+                    value += line[value_end];
+                }
+            }
+            if (value_end >= line.size()) break;
+            fields[key] = std::move(value);
+            ++value_end;
+        } else {
+            value_end = std::min(line.find_first_of(",}", value_begin), line.size());
+            fields[key] = std::string(line.substr(value_begin, value_end - value_begin));
+        }
+        pos = value_end;
+    }
+    return fields;
+}
+
+std::map<std::string, std::map<std::string, std::string>> load_baseline(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        throw std::runtime_error("Cannot read baseline: " + path);
+    }
+    std::map<std::string, std::map<std::string, std::string>> cases;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find("\"name\"") == std::string::npos) continue;
+        auto fields = parse_flat_object(line);
+        cases[fields["name"]] = std::move(fields);
+    }
+    return cases;
+}
+
+double field(const std::map<std::string, std::string>& fields, const char* key) {
+    auto it = fields.find(key);
+    if (it == fields.end()) {
+        throw std::runtime_error(std::string("Baseline case without ") + key);
+    }
+    return std::stod(it->second);
+}
+
+// Prints one row per gated metric; returns the number of regressions
+int compare(const std::vector<CaseResult>& results,
+            const std::map<std::string, std::map<std::string, std::string>>& baseline,
+            const GateOptions& options) {
+    int regressions = 0;
+    std::printf("%-32s %-16s %14s %14s %9s\n", "case", "metric", "baseline", "current", "change");
+    auto row = [&](const std::string& name, const char* metric, int decimals, double base, double current,
+                   bool failed, const std::string& limit) {
+        double change = base != 0.0 ? (current - base) / base * 100.0 : 0.0;
+        std::printf("%-32s %-16s %14.*f %14.*f %+8.1f%%%s\n", name.c_str(), metric, decimals, base, decimals,
+                    current, change, failed ? ("  FAIL (" + limit + ")").c_str() : "");
+        regressions += failed;
+    };
+    
+    for (const auto& r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end()) {
+            std::printf("%-32s not in baseline\n", r.name.c_str());
+            continue;
+        }
+        const auto& base = it->second;
+        char limit[64];
+        
+        double base_p50 = field(base, "p50_ms");
+        std::snprintf(limit, sizeof(limit), "> +%.0f%%", options.time_tolerance * 100.0);
+        row(r.name, "p50_ms", 3, base_p50, r.p50_ms, r.p50_ms > base_p50 * (1.0 + options.time_tolerance), limit);
+        row(r.name, "p90_ms", 3, field(base, "p90_ms"), r.p90_ms, false, "");
+        row(r.name, "notes_per_sec", 0, field(base, "notes_per_sec"), r.notes_per_sec, false, "");
+        
+        double base_heap = field(base, "peak_heap_bytes");
+        std::snprintf(limit, sizeof(limit), "> +%.0f%%", options.memory_tolerance * 100.0);
+        row(r.name, "peak_heap_bytes", 0, base_heap, r.peak_heap_bytes,
+            r.peak_heap_bytes > base_heap * (1.0 + options.memory_tolerance), limit);
+        
+        double base_fscore = field(base, "f_score");
+        std::snprintf(limit, sizeof(limit), "drop > %g", options.fscore_tolerance);
+        row(r.name, "f_score", 4, base_fscore, r.f_score, r.f_score < base_fscore - options.fscore_tolerance, limit);
+    }
+    
+    for (const auto& [name, fields] : baseline) {
+        bool present = std::any_of(results.begin(), results.end(),
+                                   [&](const CaseResult& r) { return r.name == name; });
+        if (!present) {
+            std::printf("%-32s not run\n", name.c_str());
+        }
+    }
+    return regressions;
+}
+
+void print_usage() {
+    std::cerr << "Usage: parangonar_perf_gate [--data DIR] [--baseline FILE] [--output FILE]\n"
+              << "                            [--time-tolerance F] [--memory-tolerance F] [--fscore-tolerance F]\n"
+              << "                            [--repetitions N] [--min-time SECONDS] [--max-notes N]\n"
+              << "Aligns a fixed synthetic corpus plus the match files of DIR and compares\n"
+              << "latency, peak heap and F-score with the baseline. Exit status 1 on regression.\n"
+              << "Without --baseline, only writes results (to stdout, or FILE with --output).\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    GateOptions options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                print_usage();
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                print_usage();
+                return 2;
+            }
+            std::string value = argv[++i];
+            if (arg == "--data") {
+                options.data_dir = value;
+            } else if (arg == "--baseline") {
+                options.baseline = value;
+            } else if (arg == "--output") {
+                options.output = value;
+            } else if (arg == "--time-tolerance") {
+                options.time_tolerance = std::stod(value);
+            } else if (arg == "--memory-tolerance") {
+                options.memory_tolerance = std::stod(value);
+            } else if (arg == "--fscore-tolerance") {
+                options.fscore_tolerance = std::stod(value);
+            } else if (arg == "--repetitions") {
+                options.repetitions = std::max<size_t>(1, std::stoul(value));
+            } else if (arg == "--min-time") {
+                options.min_time = std::stod(value);
+            } else if (arg == "--max-notes") {
+                options.max_notes = std::stoul(value);
+            } else {
+                print_usage();
+                return 2;
+            }
+        }
+        
+        const AutomaticNoteMatcher matcher;
+        std::vector<CaseResult> results;
+        for (const auto& gate_case : build_cases(options)) {
+            results.push_back(run_case(gate_case, matcher, options));
+            const auto& r = results.back();
+            std::fprintf(stderr, "%-32s p50 %10.3f ms  p90 %10.3f ms  heap %12.0f B  F %.4f\n",
+                         r.name.c_str(), r.p50_ms, r.p90_ms, r.peak_heap_bytes, r.f_score);
+        }
+        
+        if (!options.output.empty()) {
+            std::ofstream out(options.output);
+            if (!out.is_open()) {
+                throw std::runtime_error("Cannot write file: " + options.output);
+            }
+            write_json(out, results);
+        } else if (options.baseline.empty()) {
+            write_json(std::cout, results);
+        }
+        
+        if (!options.baseline.empty()) {
+            int regressions = compare(results, load_baseline(options.baseline), options);
+            if (regressions > 0) {
+                std::printf("\nPerformance gate failed: %d regression%s against %s\n", regressions,
+                            regressions == 1 ? "" : "s", options.baseline.c_str());
+                return 1;
+            }
+            std::printf("\nPerformance gate passed against %s\n", options.baseline.c_str());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <parangonar/synthetic.hpp>
+#include <parangonar/match_parser.hpp>
+#include <parangonar/match_writer.hpp>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace parangonar;
+
+namespace {
+
+void print_usage() {
+    std::cerr
+        << "Usage: parangonar_synth [options] --output FILE.match\n"
+        << "Writes synthetic performances with ground truth alignments as match files.\n"
+        << "\n"
+        << "Score (one of):\n"
+        << "  --score FILE          Use the score notes of a match file\n"
+        << "  --notes N             Generate a random score of N notes (default 1000)\n"
+        << "\n"
+        << "Performance:\n"
+        << "  --seed S              Random seed (default 0)\n"
+        << "  --count K             Write K performances with seeds S..S+K-1 to FILE_<i>.match\n"
+        << "  --tempo SEC           Seconds per beat (default 0.5)\n"
+        << "  --tempo-drift X       Std dev of log tempo steps (default 0.004)\n"
+        << "  --rubato X            Relative depth of sinusoidal rubato (default 0)\n"
+        << "  --rubato-period B     Rubato period in beats (default 16)\n"
+        << "  --jitter SEC          Onset jitter std dev (default 0.015)\n"
+        << "  --asynchrony SEC      Chord asynchrony std dev (default 0.01)\n"
+        << "  --deletions P         Deletion rate (default 0.02)\n"
+        << "  --insertions P        Insertion rate (default 0.02)\n"
+        << "  --repeats P           Repeated note rate (default 0)\n"
+        << "  --trills P            Trill rate (default 0)\n"
+        << "  --trill-length N      Notes per trill (default 6)\n";
+}
+
+// "out.match" -> "out_3.match"
+std::string numbered_path(const std::string& path, int index) {
+    size_t dot = path.rfind('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return path + "_" + std::to_string(index);
+    }
+    return path.substr(0, dot) + "_" + std::to_string(index) + path.substr(dot);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string score_path;
+    std::string output;
+    synthetic::ScoreConfig score_config;
+    synthetic::PerformanceConfig config;
+    int count = 1;
+    
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                print_usage();
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                print_usage();
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--score") {
+                score_path = value;
+            } else if (arg == "--notes") {
+                score_config.num_notes = std::stoul(value);
+            } else if (arg == "--output" || arg == "-o") {
+                output = value;
+            } else if (arg == "--seed") {
+                config.seed = static_cast<unsigned int>(std::stoul(value));
+            } else if (arg == "--count") {
+                count = std::stoi(value);
+            } else if (arg == "--tempo") {
+                config.seconds_per_beat = std::stof(value);
+            } else if (arg == "--tempo-drift") {
+                config.tempo_drift = std::stof(value);
+            } else if (arg == "--rubato") {
+                config.rubato_depth = std::stof(value);
+            } else if (arg == "--rubato-period") {
+                config.rubato_period = std::stof(value);
+            } else if (arg == "--jitter") {
+                config.onset_jitter = std::stof(value);
+            } else if (arg == "--asynchrony") {
+                config.chord_asynchrony = std::stof(value);
+            } else if (arg == "--deletions") {
+                config.deletion_rate = std::stof(value);
+            } else if (arg == "--insertions") {
+                config.insertion_rate = std::stof(value);
+            } else if (arg == "--repeats") {
+                config.repeated_note_rate = std::stof(value);
+            } else if (arg == "--trills") {
+                config.trill_rate = std::stof(value);
+            } else if (arg == "--trill-length") {
+                config.trill_length = std::stoi(value);
+            } else {
+                print_usage();
+                return 1;
+            }
+        }
+        if (output.empty() || count < 1) {
+            print_usage();
+            return 1;
+        }
+        
+        MatchFileInfo info;
+        NoteArray score_notes;
+        if (!score_path.empty()) {
+            MatchNotes match = MatchFileParser::load_notes(score_path);
+            info = match.info;
+            score_notes = std::move(match.score_notes);
+        } else {
+            score_config.seed = config.seed;
+            score_notes = synthetic::generate_score(score_config);
+            info.time_signature = "4/4";
+        }
+        
+        MatchFileWriter writer;
+        unsigned int first_seed = config.seed;
+        for (int k = 0; k < count; ++k) {
+            config.seed = first_seed + static_cast<unsigned int>(k);
+            auto performance = synthetic::generate_performance(score_notes, config);
+            info.midi_clock_units = performance.info.midi_clock_units;
+            info.midi_clock_rate = performance.info.midi_clock_rate;
+            
+            std::string path = count > 1 ? numbered_path(output, k) : output;
+            writer.write_file(path, info, score_notes, performance.performance_notes, performance.alignment);
+            std::fprintf(stderr, "%s: %zu score notes, %zu performance notes, seed %u\n", path.c_str(),
+                         score_notes.size(), performance.performance_notes.size(), config.seed);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}